@@ -1,13 +1,16 @@
 // Standard C++ includes
 #include <algorithm>
 #include <bitset>
+#include <chrono>
 #include <fstream>
 #include <future>
 #include <iostream>
 #include <limits>
+#include <memory>
 #include <random>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <vector>
 
@@ -32,7 +35,9 @@
 #include "GeNNHelperKrnls.h"
 
 // Common includes
+#include "../common/bounded_queue.h"
 #include "../common/connectors.h"
+#include "../common/debug_writer.h"
 #include "../common/spike_csv_recorder.h"
 #include "../common/timer.h"
 
@@ -41,10 +46,13 @@
 
 // Antworld includes
 #include "common.h"
+#include "headless_context.h"
 #include "parameters.h"
+#include "pixel_buffer_ring.h"
 #include "render_mesh.h"
 #include "route.h"
 #include "snapshot_processor.h"
+#include "software_renderer.h"
 #include "perfect_memory.h"
 #include "world.h"
 
@@ -219,7 +227,8 @@ void generateCubeFaceLookAtMatrices(GLfloat (&matrices)[6][16])
 //----------------------------------------------------------------------------
 void renderAntView(float antX, float antY, float antHeading,
                    const World &world, const RenderMesh &renderMesh,
-                   GLuint cubemapFBO, GLuint cubemapTexture, const GLfloat (&cubeFaceLookAtMatrices)[6][16])
+                   GLuint cubemapFBO, GLuint cubemapTexture, const GLfloat (&cubeFaceLookAtMatrices)[6][16],
+                   GLuint screenFBO)
 {
     // Configure viewport to cubemap-sized square
     glViewport(0, 0, 256, 256);
@@ -265,8 +274,8 @@ void renderAntView(float antX, float antY, float antHeading,
         world.render(false);
     }
 
-    // Unbind the FBO for onscreen rendering
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // Bind the window (or headless framebuffer) for onscreen rendering
+    glBindFramebuffer(GL_FRAMEBUFFER, screenFBO);
 
     // Set viewport to strip at stop of window
     glViewport(0, displayRenderWidth + 10,
@@ -492,75 +501,477 @@ std::tuple<unsigned int, unsigned int, unsigned int> presentToMB(float *inputDat
     return std::make_tuple(numPNSpikes, numKCSpikes, numENSpikes);
 }
 //----------------------------------------------------------------------------
-void handleGLFWError(int errorNumber, const char *message)
+std::vector<unsigned int> presentScanToMB(const cv::Mat &panorama, SnapshotProcessor &snapshotProcessor,
+                                          unsigned int numSteps, double stepDegrees)
 {
-    std::cerr << "GLFW error number:" << errorNumber << ", message:" << message << std::endl;
+    Timer<> timer("\tScan simulation:");
+
+    // Loop through headings in scan, turning right from panorama's heading
+    std::vector<unsigned int> numENSpikes;
+    numENSpikes.reserve(numSteps);
+    cv::Mat rotated;
+    for(unsigned int s = 0; s < numSteps; s++) {
+        // Synthesise and process view at this heading
+        rotatePanorama(panorama, (double)s * stepDegrees, rotated);
+        float *inputData;
+        unsigned int inputDataStep;
+        std::tie(inputData, inputDataStep) = snapshotProcessor.process(rotated);
+
+        // Present it to the mushroom body without reward
+        numENSpikes.push_back(std::get<2>(presentToMB(inputData, inputDataStep, false)));
+    }
+    return numENSpikes;
 }
-}   // anonymous namespace
 //----------------------------------------------------------------------------
-int main(int argc, char *argv[])
+// MBPipeline
+//----------------------------------------------------------------------------
+//! Presents processed snapshots to the mushroom body on a background thread, in
+//! the order they were submitted. Up to maxPending snapshots can be waiting for
+//! or undergoing simulation, so when the next poses are known, upcoming snapshots
+//! can be rendered and processed while the current one is simulated. Snapshots
+//! are copied into a fixed pool of buffers which are recycled once simulated
+class MBPipeline
 {
-    std::mt19937 gen;
+public:
+    typedef std::tuple<unsigned int, unsigned int, unsigned int> Result;
 
-    // Set GLFW error callback
-    glfwSetErrorCallback(handleGLFWError);
+    MBPipeline(unsigned int maxPending, unsigned int width, unsigned int height)
+    :   m_MaxPending(maxPending), m_NumPending(0), m_NumCompleted(0),
+        m_FreeSnapshots(maxPending), m_Jobs(maxPending), m_Results(maxPending)
+    {
+        for(unsigned int i = 0; i < maxPending; i++) {
+            m_FreeSnapshots.push(cv::Mat(height, width, CV_32FC1));
+        }
 
-    // Initialize the library
-    if(!glfwInit()) {
-        throw std::runtime_error("Failed to initialize GLFW");
+        m_Thread = std::thread(&MBPipeline::simulateThreadHandler, this, width, height);
     }
 
-    // Prevent window being resized
-    glfwWindowHint(GLFW_RESIZABLE, false);
+    ~MBPipeline()
+    {
+        // Close job queue so simulation thread exits once it has simulated any remaining snapshots
+        m_Jobs.close();
+        m_Thread.join();
+    }
 
-    // Create a windowed mode window and its OpenGL context
-    GLFWwindow *window = glfwCreateWindow(displayRenderWidth, displayRenderHeight + displayRenderWidth + 10,
-                                          "Ant World", nullptr, nullptr);
-    if(!window)
+    //------------------------------------------------------------------------
+    // Public API
+    //------------------------------------------------------------------------
+    //! Queue copy of normalised snapshot to be presented, with reward if training
+    //! **NOTE** should only be called if pipeline isn't full
+    void submit(const cv::Mat &snapshot, bool reward)
     {
-        glfwTerminate();
-        throw std::runtime_error("Failed to create window");
+        Job job;
+        m_FreeSnapshots.pop(job.snapshot);
+        snapshot.copyTo(job.snapshot);
+        job.reward = reward;
+
+        m_Jobs.push(std::move(job));
+        m_NumPending++;
     }
 
-    // Make the window's context current
-    glfwMakeContextCurrent(window);
+    //! If oldest submitted snapshot has been simulated, get its result and return true
+    bool tryGetResult(Result &result)
+    {
+        if(m_NumPending > 0 && m_Results.tryPop(result)) {
+            m_NumPending--;
+            m_NumCompleted++;
+            return true;
+        }
+        else {
+            return false;
+        }
+    }
 
-    // Initialize GLEW
-    if(glewInit() != GLEW_OK) {
-        throw std::runtime_error("Failed to initialize GLEW");
+    //! Wait for oldest submitted snapshot to be simulated and get its result
+    Result getResult()
+    {
+        Result result;
+        m_Results.pop(result);
+        m_NumPending--;
+        m_NumCompleted++;
+        return result;
     }
 
-    // Enable VSync
-    glfwSwapInterval(2);
+    //! Number of snapshots submitted whose results haven't been retrieved
+    unsigned int getNumPending() const{ return m_NumPending; }
+    bool isFull() const{ return (m_NumPending >= m_MaxPending); }
+    bool hasRoomFor(unsigned int numSnapshots) const{ return ((m_NumPending + numSnapshots) <= m_MaxPending); }
 
-    // Set clear colour to match matlab and enable depth test
-    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-    glEnable(GL_DEPTH_TEST);
-    glLineWidth(4.0);
-    glPointSize(4.0);
+    //! Number of snapshots whose results have been retrieved
+    unsigned int getNumCompleted() const{ return m_NumCompleted; }
 
-    // Create key bitset and setc it as window user pointer
-    KeyBitset keybits;
-    glfwSetWindowUserPointer(window, &keybits);
+private:
+    //------------------------------------------------------------------------
+    // Job
+    //------------------------------------------------------------------------
+    struct Job
+    {
+        cv::Mat snapshot;
+        bool reward;
+    };
+
+    //------------------------------------------------------------------------
+    // Private methods
+    //------------------------------------------------------------------------
+    void simulateThreadHandler(unsigned int width, unsigned int height)
+    {
+#ifndef CPU_ONLY
+        // Snapshots are uploaded here so the GPU copy isn't overwritten until its simulation completes
+        cv::cuda::GpuMat snapshotGPU(height, width, CV_32FC1);
+#else
+        (void)width;
+        (void)height;
+#endif
+
+        Job job;
+        while(m_Jobs.pop(job)) {
+#ifdef CPU_ONLY
+            float *inputData = job.snapshot.ptr<float>();
+            const unsigned int inputDataStep = job.snapshot.step / sizeof(float);
+#else
+            snapshotGPU.upload(job.snapshot);
+            auto snapshotPtrStep = (cv::cuda::PtrStep<float>)snapshotGPU;
+            float *inputData = snapshotPtrStep.data;
+            const unsigned int inputDataStep = snapshotPtrStep.step / sizeof(float);
+#endif
+            const Result result = presentToMB(inputData, inputDataStep, job.reward);
+
+            // Recycle snapshot buffer and publish result
+            m_FreeSnapshots.push(std::move(job.snapshot));
+            m_Results.push(result);
+        }
+    }
 
-    // Set key callback
-    glfwSetKeyCallback(window, keyCallback);
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    const unsigned int m_MaxPending;
+
+    // Only accessed from submitting thread
+    unsigned int m_NumPending;
+    unsigned int m_NumCompleted;
+
+    BoundedQueue<cv::Mat> m_FreeSnapshots;
+    BoundedQueue<Job> m_Jobs;
+    BoundedQueue<Result> m_Results;
+
+    std::thread m_Thread;
+};
+//----------------------------------------------------------------------------
+// PMComparison
+//----------------------------------------------------------------------------
+//! Compares the best matches found by perfect memory's configured search
+//! against the exhaustive search and accumulates accuracy and timing
+class PMComparison
+{
+public:
+    PMComparison() : m_NumTests(0), m_NumExact(0), m_NumSnapshotMatches(0), m_SumHeadingError(0.0),
+        m_MaxHeadingError(0.0), m_SumRelativeError(0.0), m_SearchTime(0.0), m_ExhaustiveTime(0.0)
+    {
+    }
+
+    void compare(PerfectMemory &pm, const cv::Mat &view)
+    {
+        // Time both searches
+        const auto searchStart = std::chrono::high_resolution_clock::now();
+        const cv::Point best = pm.getRIDF(view, m_RIDF);
+        const auto exhaustiveStart = std::chrono::high_resolution_clock::now();
+        const cv::Point exhaustiveBest = pm.getExhaustiveRIDF(view, m_RIDF);
+        const auto exhaustiveEnd = std::chrono::high_resolution_clock::now();
+        m_SearchTime += std::chrono::duration<double, std::milli>(exhaustiveStart - searchStart).count();
+        m_ExhaustiveTime += std::chrono::duration<double, std::milli>(exhaustiveEnd - exhaustiveStart).count();
+
+        // Calculate circular heading error
+        const int numRotations = view.cols;
+        const int rotationError = std::abs(best.y - exhaustiveBest.y) % numRotations;
+        const double headingError = 360.0 * (double)std::min(rotationError, numRotations - rotationError) / (double)numRotations;
+
+        // Calculate how much worse match found was than best (using full RIDF from exhaustive search)
+        const double bestValue = m_RIDF.at<double>(exhaustiveBest.y, exhaustiveBest.x);
+        const double value = m_RIDF.at<double>(best.y, best.x);
+
+        m_NumTests++;
+        m_NumExact += (best == exhaustiveBest) ? 1 : 0;
+        m_NumSnapshotMatches += (best.x == exhaustiveBest.x) ? 1 : 0;
+        m_SumHeadingError += headingError;
+        m_MaxHeadingError = std::max(m_MaxHeadingError, headingError);
+        m_SumRelativeError += (bestValue == 0.0) ? 0.0 : ((value - bestValue) / bestValue);
+
+        std::cout << "\tExhaustive search: heading " << 360.0 * (double)exhaustiveBest.y / (double)numRotations
+            << " deg, snapshot " << exhaustiveBest.x << ", heading error " << headingError << " deg" << std::endl;
+    }
+
+    void printReport() const
+    {
+        if(m_NumTests == 0) {
+            return;
+        }
+
+        const double numTests = (double)m_NumTests;
+        std::cout << "Perfect memory search vs exhaustive search over " << m_NumTests << " tests:" << std::endl;
+        std::cout << "\tSame snapshot and heading: " << 100.0 * (double)m_NumExact / numTests << "%, same snapshot: "
+            << 100.0 * (double)m_NumSnapshotMatches / numTests << "%" << std::endl;
+        std::cout << "\tHeading error: mean " << m_SumHeadingError / numTests << " deg, max " << m_MaxHeadingError << " deg" << std::endl;
+        std::cout << "\tMean relative excess of match value: " << 100.0 * m_SumRelativeError / numTests << "%" << std::endl;
+        std::cout << "\tSearch time: " << m_SearchTime / numTests << "ms, exhaustive: " << m_ExhaustiveTime / numTests
+            << "ms (" << m_ExhaustiveTime / m_SearchTime << "x speedup)" << std::endl;
+    }
+
+private:
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    cv::Mat m_RIDF;
+
+    unsigned int m_NumTests;
+    unsigned int m_NumExact;
+    unsigned int m_NumSnapshotMatches;
+    double m_SumHeadingError;
+    double m_MaxHeadingError;
+    double m_SumRelativeError;
+    double m_SearchTime;
+    double m_ExhaustiveTime;
+};
+//----------------------------------------------------------------------------
+// RenderComparison
+//----------------------------------------------------------------------------
+//! Compares snapshots rendered by the software renderer against those read back from OpenGL
+class RenderComparison
+{
+public:
+    RenderComparison() : m_NumTests(0), m_SumMeanDifference(0.0), m_MaxDifference(0.0), m_SumDifferentFraction(0.0), m_SoftwareTime(0.0)
+    {
+    }
+
+    void compare(const cv::Mat &glSnapshot, const cv::Mat &softwareSnapshot, double softwareTime)
+    {
+        // Downsample OpenGL snapshot to the software renderer's resolution in the same way as SnapshotProcessor
+        cv::resize(glSnapshot, m_Resized, softwareSnapshot.size());
+
+        // Find largest difference of any channel at each pixel
+        cv::absdiff(m_Resized, softwareSnapshot, m_Difference);
+        cv::reduce(m_Difference.reshape(1, (int)m_Difference.total()), m_PixelDifference, 1, CV_REDUCE_MAX);
+
+        const cv::Scalar channelMeans = cv::mean(m_Difference);
+        const double meanDifference = (channelMeans[0] + channelMeans[1] + channelMeans[2]) / 3.0;
+        double maxDifference;
+        cv::minMaxLoc(m_PixelDifference, nullptr, &maxDifference);
+        const double differentFraction = (double)cv::countNonZero(m_PixelDifference > differenceThreshold) / (double)m_PixelDifference.total();
+
+        m_NumTests++;
+        m_SumMeanDifference += meanDifference;
+        m_MaxDifference = std::max(m_MaxDifference, maxDifference);
+        m_SumDifferentFraction += differentFraction;
+        m_SoftwareTime += softwareTime;
+
+        std::cout << "\tSoftware render: mean difference " << meanDifference << ", " << 100.0 * differentFraction
+            << "% pixels differ by more than " << differenceThreshold << std::endl;
+    }
+
+    void printReport() const
+    {
+        if(m_NumTests == 0) {
+            return;
+        }
+
+        const double numTests = (double)m_NumTests;
+        std::cout << "Software render vs OpenGL over " << m_NumTests << " snapshots:" << std::endl;
+        std::cout << "\tMean difference: " << m_SumMeanDifference / numTests << ", max: " << m_MaxDifference << std::endl;
+        std::cout << "\tPixels differing by more than " << differenceThreshold << ": " << 100.0 * m_SumDifferentFraction / numTests << "%" << std::endl;
+        std::cout << "\tSoftware render time: " << m_SoftwareTime / numTests << "ms" << std::endl;
+    }
+
+private:
+    // Difference (out of 255) above which a pixel is counted as different
+    static constexpr int differenceThreshold = 32;
+
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    cv::Mat m_Resized;
+    cv::Mat m_Difference;
+    cv::Mat m_PixelDifference;
+
+    unsigned int m_NumTests;
+    double m_SumMeanDifference;
+    double m_MaxDifference;
+    double m_SumDifferentFraction;
+    double m_SoftwareTime;
+};
+//----------------------------------------------------------------------------
+void handleGLFWError(int errorNumber, const char *message)
+{
+    std::cerr << "GLFW error number:" << errorNumber << ", message:" << message << std::endl;
+}
+}   // anonymous namespace
+//----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    std::mt19937 gen;
 
-    // Create route object
-    Route route(0.2f);
     Model model = ModelMB;
+    RIDFMethod ridfMethod = RIDFMethod::SAD;
+    unsigned int pmSnapshotWindow = 0;
+    bool pmCompare = false;
+    std::string pmSaveFilename;
+    std::string pmLoadFilename;
+    bool headless = false;
+    bool spinExperiment = false;
+    bool softwareRender = false;
+    bool renderCompare = false;
+    bool renderOnce = false;
+    bool syncReadback = false;
+    double debugDumpIntervalMs = -1.0;
+    unsigned int pipelineDepth = 4;
+    std::string routeFilename;
     // If the program is run with the --pm argument we're using the PM model.
+    // --pm-fft uses the PM model with the FFT-based sum of squared differences RIDF and
+    // --pm-simd uses the PM model with the multithreaded SIMD sum of absolute differences RIDF.
+    // --pm-coarse uses the PM model with coarse-to-fine search and --pm-window N also restricts
+    // this search to N snapshots either side of the previous best match.
+    // --pm-compare reports the accuracy and speed of the PM model against the exhaustive search.
+    // --pm-save FILE saves the PM model's snapshots after training and --pm-load FILE
+    // memory-maps previously saved snapshots and skips training.
+    // --headless renders offscreen without a window or vsync and exits when the experiment
+    // completes. --experiment route (the default) trains and tests on the route and
+    // --experiment spin trains the MB model at the start of the route and then spins on the spot.
+    // --software-render renders snapshots on the CPU, directly at the resolution they are processed at,
+    // and --render-compare reports how snapshots rendered this way differ from those rendered with OpenGL.
+    // --render-once renders a single panorama at each position tested by the MB model and
+    // simulates all the headings in its scan (or spin) by rotating it.
+    // --sync-readback reads snapshots back from OpenGL with a blocking glReadPixels
+    // rather than asynchronously through a ring of pixel buffer objects.
+    // --debug-dump MS writes processed snapshots and PM logs (if compiled with PM_LOG) into debug_dump/
+    // on a background thread, at most once every MS milliseconds from each source.
+    // --pipeline-depth N lets up to N snapshots (default 4) be queued for or undergoing MB simulation
+    // so, while training and scanning, upcoming snapshots are rendered while the current one is simulated.
     // Any other params are assumed to be the route file name.
     for (int i = 1; i < argc; i++) {
         // flag to run the program with the perfect memory model
         if (strcmp(argv[i],"--pm") == 0) {
             model = ModelPM;  
+        } else if (strcmp(argv[i],"--pm-fft") == 0) {
+            model = ModelPM;
+            ridfMethod = RIDFMethod::FFT;
+        } else if (strcmp(argv[i],"--pm-simd") == 0) {
+            model = ModelPM;
+            ridfMethod = RIDFMethod::SIMD;
+        } else if (strcmp(argv[i],"--pm-coarse") == 0) {
+            model = ModelPM;
+            ridfMethod = RIDFMethod::CoarseToFine;
+        } else if (strcmp(argv[i],"--pm-window") == 0 && (i + 1) < argc) {
+            model = ModelPM;
+            ridfMethod = RIDFMethod::CoarseToFine;
+            pmSnapshotWindow = (unsigned int)std::stoul(argv[++i]);
+        } else if (strcmp(argv[i],"--pm-compare") == 0) {
+            pmCompare = true;
+        } else if (strcmp(argv[i],"--pm-save") == 0 && (i + 1) < argc) {
+            pmSaveFilename = argv[++i];
+        } else if (strcmp(argv[i],"--pm-load") == 0 && (i + 1) < argc) {
+            pmLoadFilename = argv[++i];
+        } else if (strcmp(argv[i],"--headless") == 0) {
+            headless = true;
+        } else if (strcmp(argv[i],"--software-render") == 0) {
+            softwareRender = true;
+        } else if (strcmp(argv[i],"--render-compare") == 0) {
+            renderCompare = true;
+        } else if (strcmp(argv[i],"--render-once") == 0) {
+            renderOnce = true;
+        } else if (strcmp(argv[i],"--sync-readback") == 0) {
+            syncReadback = true;
+        } else if (strcmp(argv[i],"--debug-dump") == 0 && (i + 1) < argc) {
+            debugDumpIntervalMs = std::stod(argv[++i]);
+        } else if (strcmp(argv[i],"--pipeline-depth") == 0 && (i + 1) < argc) {
+            pipelineDepth = (unsigned int)std::stoul(argv[++i]);
+        } else if (strcmp(argv[i],"--experiment") == 0 && (i + 1) < argc) {
+            i++;
+            if (strcmp(argv[i],"spin") == 0) {
+                spinExperiment = true;
+            } else if (strcmp(argv[i],"route") != 0) {
+                throw std::runtime_error("Unknown experiment '" + std::string(argv[i]) + "'");
+            }
         } else {
-            // otherwise load route file specified by command line
-            route.load(argv[i], Parameters::snapshotDistance);
+            // otherwise route file is specified by command line
+            routeFilename = argv[i];
         }
     }
 
+    if (spinExperiment && model != ModelMB) {
+        throw std::runtime_error("Spin experiment is only supported by the MB model");
+    }
+    if (renderOnce && model != ModelMB) {
+        throw std::runtime_error("--render-once is only supported by the MB model");
+    }
+    if (headless && routeFilename.empty()) {
+        throw std::runtime_error("Headless mode requires a route");
+    }
+    if (pipelineDepth == 0) {
+        throw std::runtime_error("Pipeline depth must be at least 1");
+    }
+
+    // Create either an offscreen context or a window with its own OpenGL context
+    const unsigned int windowWidth = displayRenderWidth;
+    const unsigned int windowHeight = displayRenderHeight + displayRenderWidth + 10;
+    std::unique_ptr<HeadlessContext> headlessContext;
+    GLFWwindow *window = nullptr;
+    GLuint screenFBO = 0;
+    if (headless) {
+        headlessContext.reset(new HeadlessContext(windowWidth, windowHeight));
+        screenFBO = headlessContext->getFramebuffer();
+    }
+    else {
+        // Set GLFW error callback
+        glfwSetErrorCallback(handleGLFWError);
+
+        // Initialize the library
+        if(!glfwInit()) {
+            throw std::runtime_error("Failed to initialize GLFW");
+        }
+
+        // Prevent window being resized
+        glfwWindowHint(GLFW_RESIZABLE, false);
+
+        // Create a windowed mode window and its OpenGL context
+        window = glfwCreateWindow(windowWidth, windowHeight, "Ant World", nullptr, nullptr);
+        if(!window)
+        {
+            glfwTerminate();
+            throw std::runtime_error("Failed to create window");
+        }
+
+        // Make the window's context current
+        glfwMakeContextCurrent(window);
+
+        // Initialize GLEW
+        if(glewInit() != GLEW_OK) {
+            throw std::runtime_error("Failed to initialize GLEW");
+        }
+
+        // Enable VSync
+        glfwSwapInterval(2);
+    }
+
+    // Set clear colour to match matlab and enable depth test
+    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+    glEnable(GL_DEPTH_TEST);
+    glLineWidth(4.0);
+    glPointSize(4.0);
+
+    // Create key bitset and, if there is a window, set it as window user pointer
+    KeyBitset keybits;
+    if (window) {
+        glfwSetWindowUserPointer(window, &keybits);
+
+        // Set key callback
+        glfwSetKeyCallback(window, keyCallback);
+    }
+
+    // Create route object and load route file (if specified)
+    Route route(0.2f);
+    if (!routeFilename.empty()) {
+        route.load(routeFilename, Parameters::snapshotDistance);
+    }
+
     // Load world into OpenGL
     World world("world5000_gray.bin", worldColour, groundColour);
 
@@ -610,7 +1021,7 @@ int main(int argc, char *argv[])
 
     // Unbind cube map and frame buffer
     glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, screenFBO);
 
     // Pre-generate lookat matrices to point at cubemap faces
     GLfloat cubeFaceLookAtMatrices[6][16];
@@ -622,9 +1033,43 @@ int main(int argc, char *argv[])
     // Host OpenCV array to hold pixels read from screen
     cv::Mat snapshot(displayRenderHeight, displayRenderWidth, CV_8UC3);
 
+    // Unless disabled, create ring of pixel buffers to read snapshots back asynchronously
+    // **NOTE** while training, processing of each snapshot is deferred until the next has been rendered
+    std::unique_ptr<PixelBufferRing> pixelBufferRing;
+    if (!syncReadback) {
+        pixelBufferRing.reset(new PixelBufferRing(0, displayRenderWidth + 10, displayRenderWidth, displayRenderHeight, 3));
+    }
+
+    // If required, create software renderer to render snapshots at intermediate resolution
+    // **NOTE** elevation range and far plane match render mesh and cubemap projection
+    std::unique_ptr<SoftwareRenderer> softwareRenderer;
+    cv::Mat softwareSnapshot(intermediateSnapshowHeight, intermediateSnapshotWidth, CV_8UC3);
+    if (softwareRender || renderCompare) {
+        softwareRenderer.reset(new SoftwareRenderer("world5000_gray.bin", worldColour, groundColour,
+                                                    intermediateSnapshotWidth, intermediateSnapshowHeight,
+                                                    -15.0f, 60.0f, 14.0f));
+    }
+    RenderComparison renderComparison;
+
+    // If scans are rendered once in software, render panoramas at screen resolution so they can be finely rotated
+    std::unique_ptr<SoftwareRenderer> panoramaRenderer;
+    cv::Mat panorama(displayRenderHeight, displayRenderWidth, CV_8UC3);
+    if (renderOnce && softwareRender) {
+        panoramaRenderer.reset(new SoftwareRenderer("world5000_gray.bin", worldColour, groundColour,
+                                                    displayRenderWidth, displayRenderHeight,
+                                                    -15.0f, 60.0f, 14.0f));
+    }
+
+    // If requested, create writer to dump debug images and logs in the background
+    std::unique_ptr<DebugWriter> debugWriter;
+    if (debugDumpIntervalMs >= 0.0) {
+        debugWriter.reset(new DebugWriter("debug_dump", debugDumpIntervalMs));
+    }
+
     // Create snapshot processor to perform image processing on snapshot
     SnapshotProcessor snapshotProcessor(intermediateSnapshotWidth, intermediateSnapshowHeight,
                                         Parameters::inputWidth, Parameters::inputHeight);
+    snapshotProcessor.setDebugWriter(debugWriter.get());
 
     // Initialize ant position
     float antX = 5.0f;
@@ -635,20 +1080,42 @@ int main(int argc, char *argv[])
     }
 
     // If a route is loaded, start in training mode, otherwise idle
-    State state = (route.size() > 0) ? State::Training : State::Idle;
+    // **NOTE** the spin experiment starts idle, at the start of the route, and then spins as if key was pressed
+    State state = (route.size() > 0 && !spinExperiment) ? State::Training : State::Idle;
+    bool spinPending = spinExperiment;
     //State state = State::RandomWalk;
 
     unsigned int trainPoint = 0;
 
     unsigned int testingScan = 0;
 
+    // Number of snapshots of current MB scan (or spin) which have been taken
+    unsigned int numScanSnapshots = 0;
+
     unsigned int numErrors = 0;
 
     float bestHeading = 0.0f;
     unsigned int bestTestENSpikes = std::numeric_limits<unsigned int>::max();
 
     // Create PerfectMemory object to handle training/testing with snapshot inputs
-    PerfectMemory pm(Parameters::inputWidth, Parameters::inputHeight);
+    PerfectMemory pm(Parameters::inputWidth, Parameters::inputHeight, ridfMethod);
+    pm.setDebugWriter(debugWriter.get());
+    if (ridfMethod == RIDFMethod::CoarseToFine) {
+        pm.setCoarseToFine(Parameters::pmCoarseScale, Parameters::pmNumCandidates, pmSnapshotWindow);
+    }
+
+    // If requested, compare against exhaustive search (which requires packed snapshots)
+    if (pmCompare && ridfMethod != RIDFMethod::SIMD && ridfMethod != RIDFMethod::CoarseToFine) {
+        throw std::runtime_error("--pm-compare requires --pm-simd, --pm-coarse or --pm-window");
+    }
+    PMComparison pmComparison;
+
+    // If snapshots have been saved, load them and skip straight to the end of training
+    if (model == ModelPM && !pmLoadFilename.empty()) {
+        pm.load(pmLoadFilename);
+        trainPoint = route.size();
+    }
+
     // Stores result of PerfectMemory::getHeading(), includes heading and other info
     PerfectMemoryResult res;
 
@@ -665,25 +1132,90 @@ int main(int argc, char *argv[])
 
     std::ofstream spin;
 
-    std::future<std::tuple<unsigned int, unsigned int, unsigned int>> gennResult;
-    while (!glfwWindowShouldClose(window)) {
-        // If there is no valid result (GeNN process has never run), we are ready to take a snapshot
+    // Create pipeline to simulate MB model in the background
+    std::unique_ptr<MBPipeline> mbPipeline;
+    if (model == ModelMB) {
+        mbPipeline.reset(new MBPipeline(pipelineDepth, Parameters::inputWidth, Parameters::inputHeight));
+    }
+
+    std::future<std::vector<unsigned int>> scanResult;
+    // Run until window is closed or, if headless, until experiment is complete
+    unsigned int numFrames = 0;
+    bool snapshotSubmitted = false;
+
+    // Training snapshots are processed once the following snapshot's readback has started (unless they are
+    // rendered in software or compared against the software renderer, in which case they are needed immediately)
+    const bool deferTrainingSnapshots = pixelBufferRing && !softwareRender && !renderCompare;
+
+    // Process training snapshots still being read back and add them to PM or submit them to MB, leaving the newest numToLeave in flight
+    auto addPendingTrainingSnapshots =
+        [&pixelBufferRing, &snapshotProcessor, &pm, &mbPipeline, &snapshotSubmitted, model](unsigned int numToLeave)
+        {
+            while (pixelBufferRing && pixelBufferRing->getNumPending() > numToLeave) {
+                const cv::Mat &finalSnapshotFloat = snapshotProcessor.processToHost(pixelBufferRing->mapOldest());
+                pixelBufferRing->releaseOldest();
+                if (model == ModelPM) {
+                    pm.addSnapshot(snapshotProcessor.m_FinalSnapshot);
+                }
+                else {
+                    mbPipeline->submit(finalSnapshotFloat, true);
+                    snapshotSubmitted = true;
+                }
+            }
+        };
+
+    const auto runStart = std::chrono::high_resolution_clock::now();
+    while (window ? !glfwWindowShouldClose(window) : (state != State::Idle || spinPending)) {
+        // If GeNN has room in its pipeline, we are ready to take a snapshot
         // Note: readyForNextSnapshot is always true for PM, so I changed some of the code around here but the logic is still the same - Alex
         bool readyForNextSnapshot = true;
+        bool readyForNextTrainingSnapshot = true;
         bool resultsAvailable = false;
         unsigned int numPNSpikes;
         unsigned int numKCSpikes;
         unsigned int numENSpikes;
-        if(model == ModelMB && gennResult.valid()) {
-            // GeNN has run and the result is ready for us, s
-            if(gennResult.wait_for(std::chrono::seconds(0)) == future_status::ready) {
-                std::tie(numPNSpikes, numKCSpikes, numENSpikes) = gennResult.get();
+        if(model == ModelMB && mbPipeline->getNumPending() > 0) {
+            // If headless and no more snapshots can be submitted, there is nothing to do while GeNN runs so wait for it
+            MBPipeline::Result result;
+            if(!window && (mbPipeline->isFull() || !snapshotSubmitted)) {
+                result = mbPipeline->getResult();
+                resultsAvailable = true;
+            }
+            // Otherwise, if GeNN has finished simulating oldest snapshot, the result is ready for us
+            else {
+                resultsAvailable = mbPipeline->tryGetResult(result);
+            }
+
+            if(resultsAvailable) {
+                std::tie(numPNSpikes, numKCSpikes, numENSpikes) = result;
                 std::cout << "\t" << numPNSpikes << " PN spikes, " << numKCSpikes << " KC spikes, " << numENSpikes << " EN spikes" << std::endl;
+            }
+        }
 
-                resultsAvailable = true;
+        // Training snapshots still being read back are submitted before the next snapshot so, as well as
+        // the next snapshot (unless it is itself a deferred training snapshot), they need room in the pipeline
+        const unsigned int numDeferredSnapshots = pixelBufferRing ? pixelBufferRing->getNumPending() : 0;
+        if(model == ModelMB) {
+            readyForNextSnapshot = mbPipeline->hasRoomFor(numDeferredSnapshots + 1);
+            readyForNextTrainingSnapshot = mbPipeline->hasRoomFor(numDeferredSnapshots + (deferTrainingSnapshots ? 0 : 1));
+        }
+        snapshotSubmitted = false;
+
+        // Likewise, if GeNN has been simulating a whole scan, check if it has finished
+        bool scanResultsAvailable = false;
+        std::vector<unsigned int> scanENSpikes;
+        if(scanResult.valid()) {
+            if(!window) {
+                scanResult.wait();
+            }
+
+            if(scanResult.wait_for(std::chrono::seconds(0)) == future_status::ready) {
+                scanENSpikes = scanResult.get();
+                scanResultsAvailable = true;
             }
             else {
                 readyForNextSnapshot = false;
+                readyForNextTrainingSnapshot = false;
             }
         }
 
@@ -714,7 +1246,12 @@ int main(int argc, char *argv[])
                 antHeading = 270.0f;
             }
         }
-        if(keybits.test(KeySpin) && state == State::Idle) {
+        // **NOTE** spin training takes the next result as its own so, with the
+        // MB model, wait until any other snapshots have been simulated first
+        const bool readyForSpin = readyForNextSnapshot
+            && (model == ModelPM || (mbPipeline->getNumPending() == 0 && !resultsAvailable));
+        if((keybits.test(KeySpin) || spinPending) && state == State::Idle && readyForSpin) {
+            spinPending = false;
             trainSnapshot = true;
             state = State::SpinningTrain;
         }
@@ -729,14 +1266,15 @@ int main(int argc, char *argv[])
 
         // If we're training
         if(state == State::Training) {
-            // If results from previous training snapshot are available, mark them on route
+            // If results from a previous training snapshot are available, mark them on route
+            // **NOTE** snapshots of the following route points may still be in the pipeline or being read back
             if(resultsAvailable) {
-                route.setWaypointFamiliarity(trainPoint - 1,
+                route.setWaypointFamiliarity(trainPoint - 1 - numDeferredSnapshots - mbPipeline->getNumPending(),
                                              (double)numENSpikes / 20.0);
             }
 
             // If GeNN is free to process next snapshot
-            if(readyForNextSnapshot) {
+            if(readyForNextTrainingSnapshot) {
                 // If GeNN isn't training and we have more route points to train
                 if(trainPoint < route.size()) {
                     // Snap ant to next snapshot point
@@ -744,7 +1282,9 @@ int main(int argc, char *argv[])
 
                     // Update window title
                     std::string windowTitle = "Ant World - Training snaphot " + std::to_string(trainPoint) + "/" + std::to_string(route.size());
-                    glfwSetWindowTitle(window, windowTitle.c_str());
+                    if (window) {
+                        glfwSetWindowTitle(window, windowTitle.c_str());
+                    }
 
                     // Set flag to train this snapshot
                     trainSnapshot = true;
@@ -752,116 +1292,152 @@ int main(int argc, char *argv[])
                     // Go onto next training point
                     trainPoint++;
                 }
-                // Otherwise, if we've reached end of route
+                // Otherwise, we've reached end of route
                 else {
-                    std::cout << "Training complete (" << route.size() << " snapshots)" << std::endl;
+                    // Add or submit any training snapshots which are still being read back
+                    addPendingTrainingSnapshots(0);
+
+                    // If all training snapshots have been simulated
+                    if(model == ModelPM || mbPipeline->getNumPending() == 0) {
+                        const double trainingSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - runStart).count();
+                        std::cout << "Training complete (" << route.size() << " snapshots in " << trainingSeconds << "s, "
+                            << (double)route.size() / trainingSeconds << " snapshots/s)" << std::endl;
+
+                        // Save trained perfect memory if requested (and it wasn't loaded)
+                        if (model == ModelPM && !pmSaveFilename.empty() && pmLoadFilename.empty()) {
+                            pm.save(pmSaveFilename);
+                        }
 
-                    // Go to testing state
-                    state = State::Testing;
+                        // Go to testing state
+                        state = State::Testing;
 
-                    // Snap ant back to start of route, facing in starting scan direction
-                    std::tie(antX, antY, antHeading) = route[0];
-                    antHeading -= halfScanAngle;
+                        // Snap ant back to start of route, facing in starting scan direction
+                        std::tie(antX, antY, antHeading) = route[0];
+                        antHeading -= halfScanAngle;
 
-                    // Reset scan
-                    testingScan = 0;
-                    bestTestENSpikes = std::numeric_limits<unsigned int>::max();
+                        // Reset scan
+                        testingScan = 0;
+                        numScanSnapshots = 1;
+                        bestTestENSpikes = std::numeric_limits<unsigned int>::max();
 
-                    // Take snapshot
-                    testSnapshot = true;
+                        // Take snapshot
+                        testSnapshot = true;
+                    }
                 }
             }
         }
         // Otherwise, if we're testing
         else if(state == State::Testing) {
-            if (model == ModelPM || resultsAvailable) {
-                // Flag which indicates that the ant's position should be updated.
-                // This is a bad hack until we can find a better way of merging the two models!
-                bool antMove = false;
-                
-                // mushroom body
-                if (model == ModelMB) {
+            // Flag which indicates that the ant's position should be updated.
+            // This is a bad hack until we can find a better way of merging the two models!
+            bool antMove = false;
+
+            // mushroom body
+            if (model == ModelMB) {
+                // If whole scan has been simulated, find most familiar of its headings
+                if(scanResultsAvailable) {
+                    for(unsigned int s = 0; s < scanENSpikes.size(); s++) {
+                        if(scanENSpikes[s] < bestTestENSpikes) {
+                            bestHeading = antHeading + ((float)s * Parameters::scanStep);
+                            bestTestENSpikes = scanENSpikes[s];
+                        }
+                    }
+
+                    testingScan = numScanSteps;
+                }
+                // Otherwise, if next heading in scan has been simulated
+                else if(resultsAvailable) {
+                    // Ant may already have scanned past this heading to take later snapshots
+                    const float resultHeading = antHeading - ((float)(numScanSnapshots - 1 - testingScan) * Parameters::scanStep);
+
                     // If this is an improvement on previous best spike count
                     if(numENSpikes < bestTestENSpikes) {
-                        bestHeading = antHeading;
+                        bestHeading = resultHeading;
                         bestTestENSpikes = numENSpikes;
 
                         std::cout << "\tUpdated result: " << bestHeading << " is most familiar heading with " << bestTestENSpikes << " spikes" << std::endl;
                     }
 
-                    // Update window title
+                    testingScan++;
+                }
+
+                // Update window title
+                if (window && (resultsAvailable || scanResultsAvailable)) {
                     std::string windowTitle = "Ant World - Testing with " + std::to_string(numErrors) + " errors";
                     glfwSetWindowTitle(window, windowTitle.c_str());
-                
-                    // Go onto next scan
-                    testingScan++;
+                }
 
-                    // If scan isn't complete
-                    if(testingScan < numScanSteps) {
-                        // Scan right
-                        antHeading += Parameters::scanStep;
+                // If whole scan has been simulated
+                if(testingScan == numScanSteps) {
+                    std::cout << "Scan complete: " << bestHeading << " is most familiar heading with " << bestTestENSpikes << " spikes" << std::endl;
 
-                        // Take test snapshot
-                        testSnapshot = true;
-                    }
-                    else {
-                        std::cout << "Scan complete: " << bestHeading << " is most familiar heading with " << bestTestENSpikes << " spikes" << std::endl;
+                    // Snap ant to it's best heading
+                    antHeading = bestHeading;
+                    antMove = true;
+                }
+                // Otherwise, if there are more headings to take snapshots at (rather than synthesise from
+                // the panorama) and GeNN has room for another, scan right and take test snapshot
+                else if(!renderOnce && numScanSnapshots < numScanSteps && readyForNextSnapshot) {
+                    antHeading += Parameters::scanStep;
+                    testSnapshot = true;
+                    numScanSnapshots++;
+                }
+            }
+            // perfect memory
+            else {
+                // Note that we are adding to the heading, not replacing it, as the heading angle is relative to the current view
+                antHeading += res.heading;
+                antMove = true;
+            }
+
+            // If we need to move forward - always true for PM model, only true after scan for MB
+            if (antMove) {
+                // Move ant forward by snapshot distance
+                antX += Parameters::snapshotDistance * sin(antHeading * degreesToRadians);
+                antY += Parameters::snapshotDistance * cos(antHeading * degreesToRadians);
+
+                replay << antX << "," << antY << "," << antHeading << std::endl;
 
-                        // Snap ant to it's best heading
-                        antHeading = bestHeading;
-                        antMove = true;
+                // If we've reached destination, reset state to idle
+                if(route.atDestination(antX, antY, Parameters::errorDistance)) {
+                    std::cout << "Destination reached with " << numErrors << " errors" << std::endl;
+                    state = State::Idle;
+
+                    if (pmCompare) {
+                        pmComparison.printReport();
                     }
                 }
-                // perfect memory
+                // Otherwise
                 else {
-                    // Note that we are adding to the heading, not replacing it, as the heading angle is relative to the current view
-                    antHeading += res.heading;
-                }
-                
-                // If we need to move forward - always true for PM model, only true after scan for MB
-                if (model == ModelPM || antMove) {
-                    // Move ant forward by snapshot distance
-                    antX += Parameters::snapshotDistance * sin(antHeading * degreesToRadians);
-                    antY += Parameters::snapshotDistance * cos(antHeading * degreesToRadians);
-
-                    replay << antX << "," << antY << "," << antHeading << std::endl;
-
-                    // If we've reached destination, reset state to idle
-                    if(route.atDestination(antX, antY, Parameters::errorDistance)) {
-                        std::cout << "Destination reached with " << numErrors << " errors" << std::endl;
-                        state = State::Idle;
+                    // Calculate distance to route
+                    float distanceToRoute;
+                    size_t nearestRouteSegment;
+                    std::tie(distanceToRoute, nearestRouteSegment) = route.getDistanceToRoute(antX, antY);
+                    std::cout << "\tDistance to route: " << distanceToRoute * 100.0f << "cm" << std::endl;
+
+                    // If we are further away than error threshold
+                    if(distanceToRoute > Parameters::errorDistance) {
+                        cout << "\tRESETTING ANT'S POSITION" << endl;
+
+                        // Snap ant to next snapshot position
+                        // **HACK** this is dubious but looks very much like what the original model was doing in figure 1i
+                        std::tie(antX, antY, antHeading) = route[nearestRouteSegment + 1];
+
+                        // Increment error counter
+                        numErrors++;
                     }
-                    // Otherwise
-                    else {
-                        // Calculate distance to route
-                        float distanceToRoute;
-                        size_t nearestRouteSegment;
-                        std::tie(distanceToRoute, nearestRouteSegment) = route.getDistanceToRoute(antX, antY);
-                        std::cout << "\tDistance to route: " << distanceToRoute * 100.0f << "cm" << std::endl;
-
-                        // If we are further away than error threshold
-                        if(distanceToRoute > Parameters::errorDistance) {
-                            cout << "\tRESETTING ANT'S POSITION" << endl;
-
-                            // Snap ant to next snapshot position
-                            // **HACK** this is dubious but looks very much like what the original model was doing in figure 1i
-                            std::tie(antX, antY, antHeading) = route[nearestRouteSegment + 1];
-
-                            // Increment error counter
-                            numErrors++;
-                        }
-                        
-                        // This only needs to be done for MB model
-                        if (model == ModelMB) {
-                            // Reset scan
-                            antHeading -= halfScanAngle;
-                            testingScan = 0;
-                            bestTestENSpikes = std::numeric_limits<unsigned int>::max();
-                        }
-
-                        // Take snapshot
-                        testSnapshot = true;
+                    
+                    // This only needs to be done for MB model
+                    if (model == ModelMB) {
+                        // Reset scan
+                        antHeading -= halfScanAngle;
+                        testingScan = 0;
+                        numScanSnapshots = 1;
+                        bestTestENSpikes = std::numeric_limits<unsigned int>::max();
                     }
+
+                    // Take snapshot
+                    testSnapshot = true;
                 }
             }
         }
@@ -906,47 +1482,68 @@ int main(int argc, char *argv[])
                 state = State::SpinningTest;
                 antHeading -= halfScanAngle;
                 testingScan = 0;
+                numScanSnapshots = 1;
                 testSnapshot = true;
             }
         }
         else if(state == State::SpinningTest) {
-            if(resultsAvailable) {
-                   // Write heading and number of spikes to file
-                spin << antHeading << "," << numENSpikes << std::endl;
-
-                // Go onto next scan
-                testingScan++;
+            // If whole spin has been simulated, write heading and number of spikes for each step to file
+            if(scanResultsAvailable) {
+                for(unsigned int s = 0; s < scanENSpikes.size(); s++) {
+                    spin << antHeading + ((float)s * Parameters::spinStep) << "," << scanENSpikes[s] << std::endl;
+                }
+                spin.close();
 
-                // If scan isn't complete
-                if(testingScan < numSpinSteps) {
-                    // Scan right
-                    antHeading += Parameters::spinStep;
+                state = State::Idle;
+            }
+            else {
+                if(resultsAvailable) {
+                    // Write heading and number of spikes to file
+                    // **NOTE** ant may already have spun past this heading to take later snapshots
+                    spin << antHeading - ((float)(numScanSnapshots - 1 - testingScan) * Parameters::spinStep) << "," << numENSpikes << std::endl;
 
-                    // Take test snapshot
-                    testSnapshot = true;
+                    // Go onto next scan
+                    testingScan++;
                 }
-                else {
+
+                // If spin is complete
+                if(testingScan == numSpinSteps) {
                     spin.close();
 
                     state = State::Idle;
                 }
+                // Otherwise, if there are more headings to take snapshots at and GeNN has room for another
+                else if(!renderOnce && numScanSnapshots < numSpinSteps && readyForNextSnapshot) {
+                    // Spin right
+                    antHeading += Parameters::spinStep;
+
+                    // Take test snapshot
+                    testSnapshot = true;
+                    numScanSnapshots++;
+                }
             }
         }
 
-        // Clear colour and depth buffer
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // If there's a window or we need a snapshot from OpenGL, render a frame
+        if(window || ((trainSnapshot || testSnapshot) && (!softwareRender || renderCompare))) {
+            // Clear colour and depth buffer
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // Render ant's eye view at top of the screen
-        renderAntView(antX, antY, antHeading,
-                      world, renderMesh,
-                      fbo, cubemap, cubeFaceLookAtMatrices);
+            // Render ant's eye view at top of the screen
+            renderAntView(antX, antY, antHeading,
+                          world, renderMesh,
+                          fbo, cubemap, cubeFaceLookAtMatrices, screenFBO);
 
-        // Render top-down view at bottom of the screen
-        renderTopDownView(antX, antY, antHeading,
-                          world, route);
+            // Render top-down view at bottom of the screen
+            renderTopDownView(antX, antY, antHeading,
+                              world, route);
 
-        // Swap front and back buffers
-        glfwSwapBuffers(window);
+            // Swap front and back buffers
+            if (window) {
+                glfwSwapBuffers(window);
+            }
+            numFrames++;
+        }
 
         // If we should take a snapshot
         if(trainSnapshot || testSnapshot) {
@@ -954,35 +1551,108 @@ int main(int argc, char *argv[])
 
             std::cout << "Snapshot at (" << antX << "," << antY << "," << antHeading << ")" << std::endl;
 
-            // Read pixels from framebuffer
-            // **TODO** it should be theoretically possible to go directly from frame buffer to GpuMat
-            glReadPixels(0, displayRenderWidth + 10, displayRenderWidth, displayRenderHeight,
-                         GL_BGR, GL_UNSIGNED_BYTE, snapshot.data);
-
-            // Process snapshot
-            float *finalSnapshotData;
-            unsigned int finalSnapshotStep;
-            std::tie(finalSnapshotData, finalSnapshotStep) = snapshotProcessor.process(snapshot);
+            // If we're testing the MB model and scans are rendered once, simulate whole scan from panorama at this heading
+            if (renderOnce && testSnapshot && (state == State::Testing || state == State::SpinningTest)) {
+                if (softwareRender) {
+                    panoramaRenderer->render(antX, antY, antHeading, panorama.data, panorama.step);
+                }
+                else {
+                    glReadPixels(0, displayRenderWidth + 10, displayRenderWidth, displayRenderHeight,
+                                 GL_BGR, GL_UNSIGNED_BYTE, panorama.data);
+                }
 
-            // using perfect memory model
-            if (model == ModelPM) {
-                if (trainSnapshot)
-                    pm.addSnapshot(snapshotProcessor.m_FinalSnapshot);
-                else
-                    pm.getHeading(snapshotProcessor.m_FinalSnapshot, res);
+                const bool spinning = (state == State::SpinningTest);
+                scanResult = std::async(std::launch::async, presentScanToMB,
+                                        std::cref(panorama), std::ref(snapshotProcessor),
+                                        spinning ? numSpinSteps : numScanSteps,
+                                        spinning ? Parameters::spinStep : Parameters::scanStep);
             }
-            // using mushroom body model
             else {
-                // Start simulation, applying reward if we are training
-                gennResult = std::async(std::launch::async, presentToMB,
-                                        finalSnapshotData, finalSnapshotStep, trainSnapshot);
+                // Read pixels from framebuffer
+                // **TODO** it should be theoretically possible to go directly from frame buffer to GpuMat
+                cv::Mat glSnapshot = snapshot;
+                bool glSnapshotMapped = false;
+                bool deferred = false;
+                if (!softwareRender || renderCompare) {
+                    if (pixelBufferRing) {
+                        // Start reading snapshot back and process any previous training snapshots while it completes
+                        pixelBufferRing->startRead();
+                        addPendingTrainingSnapshots(1);
+
+                        // If we're training, process snapshot after the next one has been rendered
+                        if (deferTrainingSnapshots && trainSnapshot && state == State::Training) {
+                            deferred = true;
+                        }
+                        // Otherwise, wait for readback
+                        else {
+                            glSnapshot = pixelBufferRing->mapOldest();
+                            glSnapshotMapped = true;
+                        }
+                    }
+                    else {
+                        glReadPixels(0, displayRenderWidth + 10, displayRenderWidth, displayRenderHeight,
+                                     GL_BGR, GL_UNSIGNED_BYTE, snapshot.data);
+                    }
+                }
+
+                // Render snapshot in software and, if required, compare to OpenGL
+                if (softwareRenderer) {
+                    double softwareTime = 0.0;
+                    {
+                        TimerAccumulate<> softwareTimer(softwareTime);
+                        softwareRenderer->render(antX, antY, antHeading, softwareSnapshot.data, softwareSnapshot.step);
+                    }
+
+                    if (renderCompare) {
+                        renderComparison.compare(glSnapshot, softwareSnapshot, softwareTime);
+                    }
+                }
+
+                // Process snapshot, unless this has been deferred
+                if (!deferred) {
+                    const cv::Mat &finalSnapshotFloat = snapshotProcessor.processToHost(softwareRender ? softwareSnapshot : glSnapshot);
+                    if (glSnapshotMapped) {
+                        pixelBufferRing->releaseOldest();
+                    }
+
+                    // using perfect memory model
+                    if (model == ModelPM) {
+                        if (trainSnapshot)
+                            pm.addSnapshot(snapshotProcessor.m_FinalSnapshot);
+                        else {
+                            if (pmCompare) {
+                                pmComparison.compare(pm, snapshotProcessor.m_FinalSnapshot);
+                            }
+                            pm.getHeading(snapshotProcessor.m_FinalSnapshot, res);
+                        }
+                    }
+                    // using mushroom body model
+                    else {
+                        // Queue simulation, applying reward if we are training
+                        mbPipeline->submit(finalSnapshotFloat, trainSnapshot);
+                        snapshotSubmitted = true;
+                    }
+                }
             }
         }
 
         // Poll for and process events
-        glfwPollEvents();
+        if (window) {
+            glfwPollEvents();
+        }
     }
 
-    glfwTerminate();
+    renderComparison.printReport();
+    snapshotProcessor.printTimes();
+
+    const double runSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - runStart).count();
+    std::cout << "Rendered " << numFrames << " frames in " << runSeconds << "s (" << (double)numFrames / runSeconds << " FPS)" << std::endl;
+    if (mbPipeline) {
+        std::cout << "Simulated " << mbPipeline->getNumCompleted() << " snapshots (" << (double)mbPipeline->getNumCompleted() / runSeconds << " snapshots/s)" << std::endl;
+    }
+
+    if (window) {
+        glfwTerminate();
+    }
     return 0;
 }
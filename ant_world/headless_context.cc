@@ -0,0 +1,155 @@
+#include "headless_context.h"
+
+// Standard C++ includes
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+// Standard C includes
+#include <cstring>
+
+// EGL includes
+#include <EGL/eglext.h>
+
+//----------------------------------------------------------------------------
+// Anonymous namespace
+//----------------------------------------------------------------------------
+namespace
+{
+bool hasExtension(const char *extensions, const char *extension)
+{
+    // Search space-separated extension string for whole extension name
+    const size_t length = strlen(extension);
+    for(const char *e = extensions; e != nullptr && (e = strstr(e, extension)) != nullptr; e += length) {
+        if((e == extensions || e[-1] == ' ') && (e[length] == ' ' || e[length] == '\0')) {
+            return true;
+        }
+    }
+    return false;
+}
+}   // anonymous namespace
+
+//----------------------------------------------------------------------------
+// HeadlessContext
+//----------------------------------------------------------------------------
+HeadlessContext::HeadlessContext(unsigned int width, unsigned int height)
+:   m_Display(EGL_NO_DISPLAY), m_Context(EGL_NO_CONTEXT), m_Surface(EGL_NO_SURFACE),
+    m_FBO(0), m_ColourBuffer(0), m_DepthBuffer(0)
+{
+    // If available, use Mesa's surfaceless platform, which requires no window system or GPU
+    const char *clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+    if(hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+        auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if(getPlatformDisplay != nullptr) {
+            m_Display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        }
+    }
+#endif
+    // Otherwise, fall back to default display
+    if(m_Display == EGL_NO_DISPLAY) {
+        m_Display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    if(m_Display == EGL_NO_DISPLAY || !eglInitialize(m_Display, nullptr, nullptr)) {
+        throw std::runtime_error("Failed to initialize EGL display");
+    }
+
+    // If contexts can be made current without a surface, we don't need a pbuffer
+    const bool surfaceless = hasExtension(eglQueryString(m_Display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+
+    // Choose configuration for desktop OpenGL (rendering is to framebuffer object, so buffer sizes don't matter)
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE};
+    EGLConfig config;
+    EGLint numConfigs;
+    if(!eglChooseConfig(m_Display, configAttributes, &config, 1, &numConfigs) || numConfigs == 0) {
+        eglTerminate(m_Display);
+        throw std::runtime_error("No suitable EGL configuration");
+    }
+
+    // Create context using default (compatibility) profile as fixed-function pipeline is used
+    if(!eglBindAPI(EGL_OPENGL_API)) {
+        eglTerminate(m_Display);
+        throw std::runtime_error("EGL does not support desktop OpenGL");
+    }
+    m_Context = eglCreateContext(m_Display, config, EGL_NO_CONTEXT, nullptr);
+    if(m_Context == EGL_NO_CONTEXT) {
+        eglTerminate(m_Display);
+        throw std::runtime_error("Failed to create EGL context");
+    }
+
+    // If required, create a minimal pbuffer to make context current with
+    if(!surfaceless) {
+        const EGLint pbufferAttributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+        m_Surface = eglCreatePbufferSurface(m_Display, config, pbufferAttributes);
+        if(m_Surface == EGL_NO_SURFACE) {
+            eglDestroyContext(m_Display, m_Context);
+            eglTerminate(m_Display);
+            throw std::runtime_error("Failed to create EGL pbuffer surface");
+        }
+    }
+    if(!eglMakeCurrent(m_Display, m_Surface, m_Surface, m_Context)) {
+        if(m_Surface != EGL_NO_SURFACE) {
+            eglDestroySurface(m_Display, m_Surface);
+        }
+        eglDestroyContext(m_Display, m_Context);
+        eglTerminate(m_Display);
+        throw std::runtime_error("Failed to make EGL context current");
+    }
+
+    // Initialize GLEW
+    // **NOTE** GLEW 2.x built for GLX also tries to load GLX extensions and reports
+    // that there's no GLX display, but has loaded the OpenGL entry points by then
+    glewExperimental = GL_TRUE;
+    const GLenum glewStatus = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    if(glewStatus != GLEW_OK && glewStatus != GLEW_ERROR_NO_GLX_DISPLAY) {
+#else
+    if(glewStatus != GLEW_OK) {
+#endif
+        throw std::runtime_error("Failed to initialize GLEW");
+    }
+
+    std::cout << "Headless OpenGL renderer: " << glGetString(GL_RENDERER) << " (" << glGetString(GL_VERSION) << ")" << std::endl;
+
+    // Create colour and depth render buffers
+    glGenRenderbuffers(1, &m_ColourBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_ColourBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGB8, width, height);
+
+    glGenRenderbuffers(1, &m_DepthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_DepthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    // Attach them to framebuffer
+    glGenFramebuffers(1, &m_FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_ColourBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_DepthBuffer);
+
+    // Check frame buffer is created correctly
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        throw std::runtime_error("Headless frame buffer not complete");
+    }
+
+    // Leave it bound, in place of window
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+}
+//----------------------------------------------------------------------------
+HeadlessContext::~HeadlessContext()
+{
+    glDeleteFramebuffers(1, &m_FBO);
+    glDeleteRenderbuffers(1, &m_ColourBuffer);
+    glDeleteRenderbuffers(1, &m_DepthBuffer);
+
+    eglMakeCurrent(m_Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if(m_Surface != EGL_NO_SURFACE) {
+        eglDestroySurface(m_Display, m_Surface);
+    }
+    eglDestroyContext(m_Display, m_Context);
+    eglTerminate(m_Display);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+// OpenGL includes
+#include <GL/glew.h>
+
+// EGL includes
+#include <EGL/egl.h>
+
+//----------------------------------------------------------------------------
+// HeadlessContext
+//----------------------------------------------------------------------------
+//! Offscreen OpenGL context, created with EGL so no window system is required
+//! (on Mesa this runs on llvmpipe without a GPU), with a framebuffer object
+//! of the given size which stands in for the window's default framebuffer
+class HeadlessContext
+{
+public:
+    HeadlessContext(unsigned int width, unsigned int height);
+    ~HeadlessContext();
+
+    //------------------------------------------------------------------------
+    // Public API
+    //------------------------------------------------------------------------
+    //! Get framebuffer to render into instead of the window
+    GLuint getFramebuffer() const{ return m_FBO; }
+
+private:
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    EGLDisplay m_Display;
+    EGLContext m_Context;
+    EGLSurface m_Surface;
+
+    GLuint m_FBO;
+    GLuint m_ColourBuffer;
+    GLuint m_DepthBuffer;
+};
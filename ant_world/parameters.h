@@ -19,6 +19,13 @@ namespace Parameters
     constexpr double snapshotDistance = 10.0 / 100.0;
     constexpr double errorDistance = 20.0 / 100.0;
 
+    // Perfect memory coarse-to-fine search parameters
+    // Factor views are downsampled by to calculate coarse RIDF
+    constexpr unsigned int pmCoarseScale = 2;
+
+    // How many of the lowest (snapshot, rotation) pairs in coarse RIDF are refined at full resolution
+    constexpr unsigned int pmNumCandidates = 8;
+
     // Network dimensions
     constexpr unsigned int inputWidth = 36;
     constexpr unsigned int inputHeight = 10;
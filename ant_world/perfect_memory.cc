@@ -1,122 +1,282 @@
 #include "perfect_memory.h"
 
 // For file IO
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
 #include <iostream>
+#include <algorithm>
 #include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef PM_LOG
+// Common includes
+#include "../common/debug_writer.h"
+#endif
 
 using namespace cv;
 using namespace std;
 
+namespace
+{
+// Snapshot file format - header followed, at dataOffset, by snapshots packed for SADKernel
+const char fileMagic[8] = {'P', 'M', 'S', 'N', 'A', 'P', 'S', '\0'};
+const uint32_t fileVersion = 1;
+
+// Offset of snapshot data is aligned to cache lines (which also suits SIMD loads)
+const uint64_t fileAlignment = 64;
+
+struct FileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t packedSize;
+    uint64_t numSnapshots;
+    uint64_t dataOffset;
+};
+
+// Check view can be compared against packed snapshots
+void checkPackable(const Mat &view, const SADKernel &kernel)
+{
+    if (view.type() != CV_8UC1 || (unsigned int)view.cols != kernel.getWidth()
+        || (unsigned int)view.rows != kernel.getHeight())
+    {
+        throw runtime_error("SIMD perfect memory requires 8-bit greyscale views of the output size");
+    }
+}
+}   // anonymous namespace
+
 // Create PM model for images with specified width and height (after processing)
-PerfectMemory::PerfectMemory(unsigned int outputWidth, unsigned int outputHeight)
-:   m_diff(outputWidth, outputHeight, CV_32FC1),
+PerfectMemory::PerfectMemory(unsigned int outputWidth, unsigned int outputHeight, RIDFMethod method,
+                             unsigned int numThreads)
+:   m_Method(method),
+    m_SADKernel(outputWidth, outputHeight), m_PackedSnapshotData(nullptr), m_Mapping(nullptr), m_MappingSize(0),
+    m_CoarseScale(0), m_NumCandidates(0), m_SnapshotWindow(0), m_PreviousSnapshot(-1),
+    m_diff(outputWidth, outputHeight, CV_32FC1),
     m_tmp1(outputWidth, outputHeight, CV_32FC1),
     m_tmp2(outputWidth, outputHeight, CV_16UC1)
 {
-#ifdef PM_LOG
-    // Check if log directory exists and exit if so
-    struct stat sb;
-    if (stat(PM_LOG_DIR, &sb) == 0 && S_ISDIR(sb.st_mode))
-        return;
+    // Create thread pool and per-thread scratch space for SIMD methods
+    if (isPacked()) {
+        m_ThreadPool.reset(new ThreadPool(numThreads));
+        m_ThreadSAD.resize(m_ThreadPool->getNumThreads() * outputWidth);
+        m_ThreadBest.resize(m_ThreadPool->getNumThreads());
+    }
 
-    // Otherwise create directory with usual permissions
-    const int dir_err = mkdir(PM_LOG_DIR, S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
-    if (dir_err < 0) {
-        cout << "Error creating directory: " << dir_err << endl;
-        exit(1);
+    // By default, search all snapshots at half resolution
+    if (m_Method == RIDFMethod::CoarseToFine) {
+        setCoarseToFine(2, 8, 0);
+    }
+}
+
+PerfectMemory::~PerfectMemory()
+{
+    if (m_Mapping != nullptr) {
+        munmap(m_Mapping, m_MappingSize);
     }
-#endif
 }
 
 // Add a new snapshot to memory
 void PerfectMemory::addSnapshot(Mat &current)
 {
+#ifdef PM_LOG
     cout << "\tAdding snapshot " << snapshots.size() << endl;
+#endif
 
     // Clone the current view
     Mat snap = current.clone();
-    
+
+    // Pack snapshot onto end of store
+    if (isPacked()) {
+        checkPackable(snap, m_SADKernel);
+
+        // If snapshots were loaded from file, copy them from the read-only mapping first
+        const size_t packedSize = m_SADKernel.getPackedSize();
+        if (m_PackedSnapshots.size() != (snapshots.size() * packedSize)) {
+            m_PackedSnapshots.assign(m_PackedSnapshotData, m_PackedSnapshotData + (snapshots.size() * packedSize));
+        }
+
+        m_PackedSnapshots.resize(m_PackedSnapshots.size() + packedSize);
+        m_SADKernel.pack(snap.data, snap.step, &m_PackedSnapshots[m_PackedSnapshots.size() - packedSize]);
+        m_PackedSnapshotData = m_PackedSnapshots.data();
+    }
+
     // Add to vector
     snapshots.push_back(snap);
+    precomputeSnapshot(snap);
 
 #ifdef PM_LOG
-    imwrite(PM_LOG_DIR "snapshot" + to_string(snapshots.size()) + ".png", snap);
+    if (m_DebugWriter != nullptr && m_DebugWriter->isDumpDue(m_LastDump)) {
+        m_DebugWriter->writeImage(PM_LOG_PREFIX "snapshot" + to_string(snapshots.size()) + ".png", snap);
+    }
 #endif
 }
 
+// Calculate any data required by method from a stored snapshot
+void PerfectMemory::precomputeSnapshot(const Mat &snap)
+{
+    // Precompute the spectrum of each row and the sum of squares
+    if (m_Method == RIDFMethod::FFT) {
+        Mat snapFloat;
+        snap.convertTo(snapFloat, CV_64FC1);
+
+        Mat spectrum;
+        dft(snapFloat, spectrum, DFT_ROWS);
+        m_SnapshotSpectra.push_back(spectrum);
+        m_SnapshotSumSquares.push_back(snapFloat.dot(snapFloat));
+    }
+    // Pack downsampled snapshot for coarse RIDF
+    else if (m_Method == RIDFMethod::CoarseToFine) {
+        resize(snap, m_Coarse, Size(m_CoarseSADKernel->getWidth(), m_CoarseSADKernel->getHeight()), 0.0, 0.0, INTER_AREA);
+
+        const size_t coarsePackedSize = m_CoarseSADKernel->getPackedSize();
+        m_PackedCoarseSnapshots.resize(m_PackedCoarseSnapshots.size() + coarsePackedSize);
+        m_CoarseSADKernel->pack(m_Coarse.data, m_Coarse.step, &m_PackedCoarseSnapshots[m_PackedCoarseSnapshots.size() - coarsePackedSize]);
+    }
+}
+
+// Save snapshots to a binary file
+void PerfectMemory::save(const std::string &filename) const
+{
+    ofstream file(filename, ios::binary);
+    if (!file.good()) {
+        throw runtime_error("Cannot open '" + filename + "' to save perfect memory");
+    }
+
+    // Write header
+    FileHeader header;
+    memcpy(header.magic, fileMagic, sizeof(fileMagic));
+    header.version = fileVersion;
+    header.width = m_SADKernel.getWidth();
+    header.height = m_SADKernel.getHeight();
+    header.packedSize = (uint32_t)m_SADKernel.getPackedSize();
+    header.numSnapshots = snapshots.size();
+    header.dataOffset = ((sizeof(FileHeader) + fileAlignment - 1) / fileAlignment) * fileAlignment;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+
+    // Pad to data
+    const vector<char> padding(header.dataOffset - sizeof(FileHeader), 0);
+    file.write(padding.data(), padding.size());
+
+    // Pack and write each snapshot
+    vector<uint8_t> packed(header.packedSize);
+    for (const auto &snap : snapshots) {
+        checkPackable(snap, m_SADKernel);
+        m_SADKernel.pack(snap.data, snap.step, packed.data());
+        file.write(reinterpret_cast<const char*>(packed.data()), packed.size());
+    }
+
+    if (!file.good()) {
+        throw runtime_error("Error writing perfect memory to '" + filename + "'");
+    }
+}
+
+// Memory-map snapshots saved by save()
+void PerfectMemory::load(const std::string &filename)
+{
+    if (!snapshots.empty()) {
+        throw runtime_error("Perfect memory must be empty to load snapshots");
+    }
+
+    // Open file and get its size
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw runtime_error("Cannot open '" + filename + "': " + string(strerror(errno)));
+    }
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || (size_t)sb.st_size < sizeof(FileHeader)) {
+        close(fd);
+        throw runtime_error("'" + filename + "' is not a perfect memory file");
+    }
+
+    // Map whole file read-only and shared so pages are shared between processes
+    m_MappingSize = (size_t)sb.st_size;
+    m_Mapping = mmap(nullptr, m_MappingSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (m_Mapping == MAP_FAILED) {
+        m_Mapping = nullptr;
+        throw runtime_error("Cannot map '" + filename + "': " + string(strerror(errno)));
+    }
+
+    // Validate header
+    const uint8_t *data = reinterpret_cast<const uint8_t*>(m_Mapping);
+    const FileHeader *header = reinterpret_cast<const FileHeader*>(data);
+    if (memcmp(header->magic, fileMagic, sizeof(fileMagic)) != 0 || header->version != fileVersion) {
+        throw runtime_error("'" + filename + "' is not a perfect memory file");
+    }
+    if (header->width != m_SADKernel.getWidth() || header->height != m_SADKernel.getHeight()
+        || header->packedSize != m_SADKernel.getPackedSize() || (header->dataOffset % fileAlignment) != 0
+        || m_MappingSize < (header->dataOffset + (header->numSnapshots * header->packedSize)))
+    {
+        throw runtime_error("Perfect memory file '" + filename + "' does not match view size");
+    }
+
+    // Use packed snapshots directly from mapping
+    m_PackedSnapshotData = data + header->dataOffset;
+
+    // Wrap each snapshot in a Mat header so the other methods can also use them without copying
+    // **NOTE** the mapping is read-only so these must never be written to
+    const size_t stride = header->packedSize / header->height;
+    for (uint64_t j = 0; j < header->numSnapshots; j++) {
+        uint8_t *snapData = const_cast<uint8_t*>(m_PackedSnapshotData + (j * header->packedSize));
+        snapshots.emplace_back(header->height, header->width, CV_8UC1, snapData, stride);
+        precomputeSnapshot(snapshots.back());
+    }
+
+    cout << "Loaded " << snapshots.size() << " snapshots from '" << filename << "'" << endl;
+}
+
 // Get the heading etc. by comparing current view to all stored snapshots
 void PerfectMemory::getHeading(Mat &current, PerfectMemoryResult &res)
 {
 #ifdef PM_LOG
     testCount++;
 
+    // Only log this test if debug writer is ready for another dump
+    const bool dump = (m_DebugWriter != nullptr && m_DebugWriter->isDumpDue(m_LastDump));
+
     // Prefix for log files
-    string pref = to_string(testCount) + "_";
-    
-    // Save current view
-    imwrite(PM_LOG_DIR + pref + "current.png", current);
+    string pref = PM_LOG_PREFIX + to_string(testCount) + "_";
 
-    // CSV file to store RIDF output
-    ofstream ridfFile;
-    ridfFile.open(PM_LOG_DIR + pref + "ridf.csv", ios::out | ios::trunc);
+    // Save current view
+    if (dump) {
+        m_DebugWriter->writeImage(pref + "current.png", current);
+    }
 #endif
 
-    // Stores the view as we rotate it azimuthally
-    Mat shiftSnap(current.size(), current.type());
-    
-    // RIDF values
-    int minrot; // best rotation (as index)
-    uint minsnap; // best-matching snapshot
-    double minval = numeric_limits<double>::infinity(); // lowest value across snapshots and rotations
-    
-    // Compare current view at all rotations against all snapshots
-    for (int i = 0; i < current.cols; i++) {
-        // Shift current to the right by i pixels
-        shiftColumns(current, i, shiftSnap);
-        
-        // Iterate through all snapshots
-        for (uint j = 0; j < snapshots.size(); j++) {
-            // Get sum absolute difference between current (rotated) view and snapshot
-            absdiff(snapshots.at(j), shiftSnap, m_diff);
-            double sumabsdiff = sum(m_diff)[0];
-            
-            // If this value is lower than previous best, update
-            if (sumabsdiff < minval) {
-                minval = sumabsdiff;
-                minrot = i;
-                minsnap = j;
-            }
+    // Compare current view at all rotations against all snapshots and find lowest value
+    const Point minLoc = getRIDF(current, m_RIDF);
+    const double minval = m_RIDF.at<double>(minLoc.y, minLoc.x);
+    const int minrot = minLoc.y; // best rotation (as index)
+    const uint minsnap = minLoc.x; // best-matching snapshot
+    m_PreviousSnapshot = minLoc.x;
 
-#ifdef PM_LOG
-            if (j > 0) {
-                ridfFile << ", ";
-            }
-            ridfFile << sumabsdiff;
-#endif
-        }
-#ifdef PM_LOG
-        ridfFile << "\n";
-#endif
-    }
-    
     // Best rotation
     double ratio = (double)minrot / (double)current.cols;
 
 #ifdef PM_LOG
-    ridfFile.close();
+    if (dump) {
+        // CSV file to store RIDF output
+        m_DebugWriter->writeCSV(pref + "ridf.csv", m_RIDF);
 
-    // Store a text representation of RIDF output
-    ofstream logfile;
-    logfile.open(PM_LOG_DIR + pref + "log.txt", ios::out | ios::trunc);
-    double rot = 360.0 * ratio; // degrees
-    logfile << "test" << testCount << ": " << endl
+        // Store a text representation of RIDF output
+        ostringstream logText;
+        double rot = 360.0 * ratio; // degrees
+        logText << "test" << testCount << ": " << endl
             << "- rotation: " << rot << endl
             << "- snap: " << minsnap << " (n=" << snapshots.size() << ")" << endl
             << "- value: " << minval << endl << endl;
-    logfile.close();
+        m_DebugWriter->writeText(pref + "log.txt", logText.str());
+    }
 #endif
-    
+
     // Fill PerfectMemoryResult struct
     res.heading = 2 * M_PI * ratio; // radians
     res.snapshot = minsnap;
@@ -127,10 +287,254 @@ void PerfectMemory::getHeading(Mat &current, PerfectMemoryResult &res)
          << "\tMinimum value: " << minval << endl;
 }
 
+// Calculate the RIDF of current view against all stored snapshots
+Point PerfectMemory::getRIDF(const Mat &current, Mat &ridf)
+{
+    if (snapshots.empty()) {
+        throw runtime_error("No snapshots stored in perfect memory");
+    }
+
+    ridf.create(current.cols, snapshots.size(), CV_64FC1);
+    if (m_Method == RIDFMethod::SIMD) {
+        return getRIDFSIMD(current, ridf);
+    }
+    else if (m_Method == RIDFMethod::CoarseToFine) {
+        return getRIDFCoarseToFine(current, ridf);
+    }
+
+    if (m_Method == RIDFMethod::FFT) {
+        getRIDFFFT(current, ridf);
+    }
+    else {
+        getRIDFSAD(current, ridf);
+    }
+
+    // Find lowest value across snapshots and rotations
+    // **NOTE** minMaxLoc returns the first minimum in row-major order so, like
+    // the original exhaustive search, ties are resolved by rotation then snapshot
+    Point minLoc;
+    minMaxLoc(ridf, nullptr, nullptr, &minLoc);
+    return minLoc;
+}
+
+// Calculate the full RIDF using the exhaustive SIMD search, whatever the method
+Point PerfectMemory::getExhaustiveRIDF(const Mat &current, Mat &ridf)
+{
+    if (!isPacked()) {
+        throw runtime_error("Exhaustive SIMD search requires packed snapshots");
+    }
+    if (snapshots.empty()) {
+        throw runtime_error("No snapshots stored in perfect memory");
+    }
+
+    ridf.create(current.cols, snapshots.size(), CV_64FC1);
+    return getRIDFSIMD(current, ridf);
+}
+
+// Configure coarse-to-fine search
+void PerfectMemory::setCoarseToFine(unsigned int scale, unsigned int numCandidates, unsigned int snapshotWindow)
+{
+    if (m_Method != RIDFMethod::CoarseToFine) {
+        throw runtime_error("Perfect memory is not using coarse-to-fine search");
+    }
+    if (!snapshots.empty()) {
+        throw runtime_error("Coarse-to-fine search must be configured before adding snapshots");
+    }
+    if (scale == 0 || (m_SADKernel.getWidth() % scale) != 0 || m_SADKernel.getHeight() < scale) {
+        throw runtime_error("Coarse-to-fine scale must divide view width");
+    }
+    if (numCandidates == 0) {
+        throw runtime_error("Coarse-to-fine search requires at least one candidate");
+    }
+
+    m_CoarseScale = scale;
+    m_NumCandidates = numCandidates;
+    m_SnapshotWindow = snapshotWindow;
+    m_CoarseSADKernel.reset(new SADKernel(m_SADKernel.getWidth() / scale, m_SADKernel.getHeight() / scale));
+
+    // Reserve space for one more than the number of candidates so insertion never allocates
+    m_ThreadCandidates.resize(m_ThreadPool->getNumThreads());
+    for (auto &c : m_ThreadCandidates) {
+        c.reserve(numCandidates + 1);
+    }
+    m_Candidates.reserve(numCandidates * m_ThreadPool->getNumThreads());
+}
+
+// Sum of absolute differences between each snapshot and current view shifted right by each column
+void PerfectMemory::getRIDFSAD(const Mat &current, Mat &ridf)
+{
+    // Stores the view as we rotate it azimuthally
+    Mat shiftSnap(current.size(), current.type());
+
+    for (int i = 0; i < current.cols; i++) {
+        // Shift current to the right by i pixels
+        shiftColumns(current, i, shiftSnap);
+
+        // Iterate through all snapshots
+        for (uint j = 0; j < snapshots.size(); j++) {
+            // Get sum absolute difference between current (rotated) view and snapshot
+            absdiff(snapshots.at(j), shiftSnap, m_diff);
+            ridf.at<double>(i, j) = sum(m_diff)[0];
+        }
+    }
+}
+
+// Sum of squared differences between each snapshot and current view shifted right by each column.
+// Expanding the square gives sum(snap^2) + sum(current^2) - 2 * sum(snap(c) * current(c - i)),
+// where the last term is the circular cross-correlation along rows, which is calculated for all
+// rotations at once from the products of the rows' spectra. As cross-correlations are linear, the
+// spectra of each row can be summed before a single inverse transform.
+void PerfectMemory::getRIDFFFT(const Mat &current, Mat &ridf)
+{
+    // Calculate spectrum of each row and sum of squares of current view
+    current.convertTo(m_CurrentFloat, CV_64FC1);
+    dft(m_CurrentFloat, m_CurrentSpectrum, DFT_ROWS);
+    const double currentSumSquares = m_CurrentFloat.dot(m_CurrentFloat);
+
+    // If images are integer, sums are too so round away FFT error to match the direct calculation
+    const bool integral = (current.depth() != CV_32F && current.depth() != CV_64F);
+
+    for (uint j = 0; j < snapshots.size(); j++) {
+        // Multiply snapshot spectra by conjugate of current view's spectra and sum across rows
+        mulSpectrums(m_SnapshotSpectra[j], m_CurrentSpectrum, m_ProductSpectrum, DFT_ROWS, true);
+        reduce(m_ProductSpectrum, m_RowSumSpectrum, 0, CV_REDUCE_SUM);
+
+        // Inverse transform to get cross-correlation at every rotation
+        idft(m_RowSumSpectrum, m_CrossCorrelation, DFT_SCALE | DFT_REAL_OUTPUT);
+
+        const double *crossCorrelation = m_CrossCorrelation.ptr<double>();
+        for (int i = 0; i < current.cols; i++) {
+            const double ssd = m_SnapshotSumSquares[j] + currentSumSquares - (2.0 * crossCorrelation[i]);
+            ridf.at<double>(i, j) = integral ? round(ssd) : ssd;
+        }
+    }
+}
+
+// Sum of absolute differences between each packed snapshot and current view at each rotation,
+// split across threads in contiguous blocks of snapshots. Each thread finds its best match
+// and these are then reduced in thread order, comparing (value, rotation, snapshot) so the
+// result is identical to the first minimum found by the exhaustive search.
+Point PerfectMemory::getRIDFSIMD(const Mat &current, Mat &ridf)
+{
+    checkPackable(current, m_SADKernel);
+    m_SADKernel.setCurrent(current.data, current.step);
+
+    const unsigned int width = m_SADKernel.getWidth();
+    const size_t packedSize = m_SADKernel.getPackedSize();
+    m_ThreadPool->parallelFor(snapshots.size(),
+        [&](unsigned int thread, size_t begin, size_t end)
+        {
+            uint32_t *sad = &m_ThreadSAD[thread * width];
+            Match best{numeric_limits<uint32_t>::max(), 0, 0};
+            for (size_t j = begin; j < end; j++) {
+                m_SADKernel.calculate(&m_PackedSnapshotData[j * packedSize], sad);
+
+                for (unsigned int i = 0; i < width; i++) {
+                    ridf.at<double>(i, j) = sad[i];
+
+                    const Match match{sad[i], (int)i, (int)j};
+                    if (match < best) {
+                        best = match;
+                    }
+                }
+            }
+            m_ThreadBest[thread] = best;
+        });
+
+    // Reduce per-thread best matches
+    Match best = m_ThreadBest[0];
+    for (unsigned int t = 1; t < m_ThreadPool->getNumThreads(); t++) {
+        if (m_ThreadBest[t] < best) {
+            best = m_ThreadBest[t];
+        }
+    }
+    return Point(best.snapshot, best.rotation);
+}
+
+// Coarse-to-fine search. The coarse RIDF of downsampled views is calculated (in parallel, like
+// the SIMD method) for all snapshots or only those near the previous best match. The lowest
+// (snapshot, rotation) candidates are then refined by calculating the full resolution SAD at
+// all rotations covered by the coarse rotation and its neighbours. Only these entries of
+// ridf are calculated - the remainder are set to infinity.
+Point PerfectMemory::getRIDFCoarseToFine(const Mat &current, Mat &ridf)
+{
+    checkPackable(current, m_SADKernel);
+
+    // Set full resolution and downsampled current view
+    m_SADKernel.setCurrent(current.data, current.step);
+    resize(current, m_Coarse, Size(m_CoarseSADKernel->getWidth(), m_CoarseSADKernel->getHeight()), 0.0, 0.0, INTER_AREA);
+    m_CoarseSADKernel->setCurrent(m_Coarse.data, m_Coarse.step);
+
+    // Determine range of snapshots to search
+    size_t searchBegin = 0;
+    size_t searchEnd = snapshots.size();
+    if (m_SnapshotWindow > 0 && m_PreviousSnapshot >= 0) {
+        searchBegin = (size_t)max(0, m_PreviousSnapshot - (int)m_SnapshotWindow);
+        searchEnd = min(snapshots.size(), (size_t)(m_PreviousSnapshot + m_SnapshotWindow + 1));
+    }
+
+    // Calculate coarse RIDF, with each thread keeping a sorted list of its lowest candidates
+    const unsigned int coarseWidth = m_CoarseSADKernel->getWidth();
+    const size_t coarsePackedSize = m_CoarseSADKernel->getPackedSize();
+    m_ThreadPool->parallelFor(searchEnd - searchBegin,
+        [&](unsigned int thread, size_t begin, size_t end)
+        {
+            uint32_t *sad = &m_ThreadSAD[thread * m_SADKernel.getWidth()];
+            vector<Match> &candidates = m_ThreadCandidates[thread];
+            candidates.clear();
+            for (size_t j = searchBegin + begin; j < searchBegin + end; j++) {
+                m_CoarseSADKernel->calculate(&m_PackedCoarseSnapshots[j * coarsePackedSize], sad);
+
+                for (unsigned int i = 0; i < coarseWidth; i++) {
+                    const Match match{sad[i], (int)i, (int)j};
+                    if (candidates.size() < m_NumCandidates || match < candidates.back()) {
+                        candidates.insert(upper_bound(candidates.begin(), candidates.end(), match), match);
+                        if (candidates.size() > m_NumCandidates) {
+                            candidates.pop_back();
+                        }
+                    }
+                }
+            }
+        });
+
+    // Merge per-thread candidates and take lowest
+    m_Candidates.clear();
+    for (const auto &c : m_ThreadCandidates) {
+        m_Candidates.insert(m_Candidates.end(), c.cbegin(), c.cend());
+    }
+    sort(m_Candidates.begin(), m_Candidates.end());
+    m_Candidates.resize(min(m_Candidates.size(), (size_t)m_NumCandidates));
+
+    // Refine candidates at full resolution
+    ridf.setTo(numeric_limits<double>::infinity());
+    const int width = (int)m_SADKernel.getWidth();
+    const int scale = (int)m_CoarseScale;
+    const size_t packedSize = m_SADKernel.getPackedSize();
+    Match best{numeric_limits<uint32_t>::max(), 0, 0};
+    for (const auto &c : m_Candidates) {
+        const uint8_t *packed = &m_PackedSnapshotData[c.snapshot * packedSize];
+        for (int r = (c.rotation - 1) * scale; r <= (c.rotation + 1) * scale; r++) {
+            // Skip rotations already calculated for neighbouring candidates
+            const int rotation = (r + width) % width;
+            double &value = ridf.at<double>(rotation, c.snapshot);
+            if (value != numeric_limits<double>::infinity()) {
+                continue;
+            }
+
+            const Match match{m_SADKernel.calculate(packed, rotation), rotation, c.snapshot};
+            value = match.value;
+            if (match < best) {
+                best = match;
+            }
+        }
+    }
+    return Point(best.snapshot, best.rotation);
+}
+
 // Shift an image to the right by numRight pixels
 void shiftColumns(Mat in, int numRight, Mat &out) {
     // Special case: no rotation
-    if(numRight == 0) { 
+    if(numRight == 0) {
         in.copyTo(out);
         return;
     }
@@ -138,7 +542,8 @@ void shiftColumns(Mat in, int numRight, Mat &out) {
     int ncols = in.cols;
     int nrows = in.rows;
 
-    out = Mat::zeros(in.size(), in.type());
+    // **NOTE** every column is overwritten below so there's no need to zero
+    out.create(in.size(), in.type());
 
     // Adjust for when numRight < 0 || numRight >= ncols
     numRight = numRight % ncols;
@@ -148,4 +553,4 @@ void shiftColumns(Mat in, int numRight, Mat &out) {
     // Shift columns right
     in(Rect(ncols-numRight,0, numRight,nrows)).copyTo(out(Rect(0,0,numRight,nrows)));
     in(Rect(0,0, ncols-numRight,nrows)).copyTo(out(Rect(numRight,0,ncols-numRight,nrows)));
-}
\ No newline at end of file
+}
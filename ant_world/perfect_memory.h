@@ -1,15 +1,41 @@
 #pragma once
 
+// Standard C++ includes
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "opencv2/opencv.hpp"
 
-// Whether to log algorithm's output
+// Common includes
+#include "../common/thread_pool.h"
+
+// Antworld includes
+#include "sad_kernel.h"
+
+// Whether to log algorithm's output (define PM_NO_LOG to disable)
+#ifndef PM_NO_LOG
 #define PM_LOG
+#endif
 
-// Where to store log files
-#define PM_LOG_DIR "pm_dump/"
+// Prefix for log files written by debug writer
+#define PM_LOG_PREFIX "pm_"
 
 using namespace cv;
 
+class DebugWriter;
+
+// Method used to calculate the rotational image difference function (RIDF)
+enum class RIDFMethod
+{
+    SAD,    // sum of absolute differences, calculated by shifting the view one column at a time
+    FFT,    // sum of squared differences, calculated at all rotations at once by FFT cross-correlation
+    SIMD,   // sum of absolute differences of packed 8-bit images, calculated with SIMD across threads
+    CoarseToFine,   // SIMD sum of absolute differences, refining best matches of a downsampled RIDF
+};
+
 // For storing output of getHeading()
 struct PerfectMemoryResult
 {
@@ -22,7 +48,10 @@ class PerfectMemory
 {
 public:
     // Create PM model for images with specified width and height (after processing)
-    PerfectMemory(unsigned int outputWidth, unsigned int outputHeight);
+    // The SIMD method is split across numThreads threads
+    PerfectMemory(unsigned int outputWidth, unsigned int outputHeight, RIDFMethod method = RIDFMethod::SAD,
+                  unsigned int numThreads = std::thread::hardware_concurrency());
+    ~PerfectMemory();
     
     // Add a new snapshot to memory
     void addSnapshot(Mat &snap);
@@ -30,17 +59,125 @@ public:
     // Get the heading etc. by comparing current view to all stored snapshots
     void getHeading(Mat &snap, PerfectMemoryResult &res);
 
+    // Calculate the RIDF of current view against all stored snapshots
+    // Rows of ridf are rotations (in columns) and columns are snapshots
+    // Returns location of the first minimum, searching snapshots within each rotation
+    Point getRIDF(const Mat &current, Mat &ridf);
+
+    // Calculate the full RIDF using the exhaustive SIMD search, whatever the method
+    // Only available for methods with packed snapshots (SIMD and CoarseToFine)
+    Point getExhaustiveRIDF(const Mat &current, Mat &ridf);
+
+    // Configure coarse-to-fine search - views are downsampled by scale to calculate a coarse RIDF
+    // and its numCandidates lowest (snapshot, rotation) pairs are refined at full resolution.
+    // If snapshotWindow is non-zero, only snapshots within this many of the previous
+    // best match found by getHeading are searched. Must be called before adding snapshots
+    void setCoarseToFine(unsigned int scale, unsigned int numCandidates, unsigned int snapshotWindow);
+
+    // Save snapshots to a binary file which can be loaded by any method
+    void save(const std::string &filename) const;
+
+    // Memory-map snapshots saved by save() into an empty memory. Snapshots are used
+    // directly from the read-only mapping so it can be shared between processes
+    void load(const std::string &filename);
+
+    size_t getNumSnapshots() const{ return snapshots.size(); }
+
+    // Queue logged snapshots, views and RIDFs to be written by debugWriter as often as it allows
+    // (nullptr to disable). Only used if PM_LOG is defined
+    void setDebugWriter(DebugWriter *debugWriter){ m_DebugWriter = debugWriter; }
+
 private:
+    // Calculate any data required by method from a stored snapshot
+    void precomputeSnapshot(const Mat &snap);
+
+    // Are snapshots packed for SIMD sum of absolute differences?
+    bool isPacked() const{ return (m_Method == RIDFMethod::SIMD || m_Method == RIDFMethod::CoarseToFine); }
+
+    void getRIDFSAD(const Mat &current, Mat &ridf);
+    void getRIDFFFT(const Mat &current, Mat &ridf);
+    Point getRIDFSIMD(const Mat &current, Mat &ridf);
+    Point getRIDFCoarseToFine(const Mat &current, Mat &ridf);
+
+    const RIDFMethod m_Method;
+
     std::vector<Mat> snapshots; // vector to store snapshots
+
+    // Row spectra and sums of squares of snapshots, precomputed for FFT method
+    std::vector<Mat> m_SnapshotSpectra;
+    std::vector<double> m_SnapshotSumSquares;
+
+    // Snapshots packed for SIMD method, with kernel and pool to process them
+    SADKernel m_SADKernel;
+    std::vector<uint8_t> m_PackedSnapshots;
+
+    // Packed snapshots used by SIMD method - either m_PackedSnapshots or mapped from file
+    const uint8_t *m_PackedSnapshotData;
+
+    // Memory mapping of snapshots loaded from file
+    void *m_Mapping;
+    size_t m_MappingSize;
+
+    std::unique_ptr<ThreadPool> m_ThreadPool;
+
+    // Per-thread SADs of one snapshot at all rotations and best match, for SIMD method
+    struct Match
+    {
+        // Order by value then rotation then snapshot, matching the exhaustive search's tie-breaking
+        bool operator < (const Match &other) const
+        {
+            if (value != other.value) {
+                return value < other.value;
+            }
+            else if (rotation != other.rotation) {
+                return rotation < other.rotation;
+            }
+            else {
+                return snapshot < other.snapshot;
+            }
+        }
+
+        uint32_t value;
+        int rotation;
+        int snapshot;
+    };
+    std::vector<uint32_t> m_ThreadSAD;
+    std::vector<Match> m_ThreadBest;
+
+    // Coarse-to-fine search parameters
+    unsigned int m_CoarseScale;
+    unsigned int m_NumCandidates;
+    unsigned int m_SnapshotWindow;
+
+    // Snapshot which best matched the previous view passed to getHeading
+    int m_PreviousSnapshot;
+
+    // Downsampled snapshots, packed for coarse RIDF, and per-thread candidates found in it
+    std::unique_ptr<SADKernel> m_CoarseSADKernel;
+    std::vector<uint8_t> m_PackedCoarseSnapshots;
+    std::vector<std::vector<Match>> m_ThreadCandidates;
+    std::vector<Match> m_Candidates;
+    Mat m_Coarse;
     
     // temporary values
     Mat m_diff;
     Mat m_tmp1;
     Mat m_tmp2;
+    Mat m_RIDF;
+    Mat m_CurrentFloat;
+    Mat m_CurrentSpectrum;
+    Mat m_ProductSpectrum;
+    Mat m_RowSumSpectrum;
+    Mat m_CrossCorrelation;
     
+    DebugWriter *m_DebugWriter = nullptr;
+
 #ifdef PM_LOG
     // number of times getHeading has been called
     int testCount = -1;
+
+    // when log files were last queued
+    std::chrono::steady_clock::time_point m_LastDump;
 #endif
 };
 
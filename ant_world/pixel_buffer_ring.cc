@@ -0,0 +1,88 @@
+#include "pixel_buffer_ring.h"
+
+// Standard C++ includes
+#include <stdexcept>
+
+// Antworld includes
+#include "common.h"
+
+//----------------------------------------------------------------------------
+// PixelBufferRing
+//----------------------------------------------------------------------------
+PixelBufferRing::PixelBufferRing(GLint x, GLint y, unsigned int width, unsigned int height, unsigned int numBuffers)
+:   m_X(x), m_Y(y), m_Width(width), m_Height(height), m_Step((((width * 3) + 3) / 4) * 4),
+    m_Buffers(numBuffers), m_Fences(numBuffers, nullptr), m_Oldest(0), m_NumPending(0)
+{
+    // Create buffers, hinting that they will be read by the CPU once each time they're filled
+    glGenBuffers(numBuffers, m_Buffers.data());
+    for(GLuint buffer : m_Buffers) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, m_Step * m_Height, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+//----------------------------------------------------------------------------
+PixelBufferRing::~PixelBufferRing()
+{
+    for(GLsync fence : m_Fences) {
+        if(fence != nullptr) {
+            glDeleteSync(fence);
+        }
+    }
+    glDeleteBuffers(m_Buffers.size(), m_Buffers.data());
+}
+//----------------------------------------------------------------------------
+void PixelBufferRing::startRead()
+{
+    if(isFull()) {
+        throw std::runtime_error("All pixel buffers have pending reads");
+    }
+
+    // Queue read into next free buffer
+    const unsigned int b = (m_Oldest + m_NumPending) % m_Buffers.size();
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_Buffers[b]);
+    glReadPixels(m_X, m_Y, m_Width, m_Height, GL_BGR, GL_UNSIGNED_BYTE, BUFFER_OFFSET(0));
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    // Insert fence to signal when it has completed
+    m_Fences[b] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_NumPending++;
+}
+//----------------------------------------------------------------------------
+cv::Mat PixelBufferRing::mapOldest()
+{
+    if(m_NumPending == 0) {
+        throw std::runtime_error("No pixel buffer reads are pending");
+    }
+
+    // Wait for read to complete, flushing commands so the fence is guaranteed to be signalled
+    GLsync &fence = m_Fences[m_Oldest];
+    GLenum status;
+    while((status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000)) == GL_TIMEOUT_EXPIRED) {
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+    if(status == GL_WAIT_FAILED) {
+        throw std::runtime_error("Failed to wait for pixel buffer read");
+    }
+
+    // Map buffer
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_Buffers[m_Oldest]);
+    void *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, m_Step * m_Height, GL_MAP_READ_BIT);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if(pixels == nullptr) {
+        throw std::runtime_error("Failed to map pixel buffer");
+    }
+
+    return cv::Mat(m_Height, m_Width, CV_8UC3, pixels, m_Step);
+}
+//----------------------------------------------------------------------------
+void PixelBufferRing::releaseOldest()
+{
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_Buffers[m_Oldest]);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    m_Oldest = (m_Oldest + 1) % m_Buffers.size();
+    m_NumPending--;
+}
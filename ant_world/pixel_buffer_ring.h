@@ -0,0 +1,61 @@
+#pragma once
+
+// Standard C++ includes
+#include <vector>
+
+// OpenCV includes
+#include <opencv2/core/core.hpp>
+
+// OpenGL includes
+#include <GL/glew.h>
+
+//----------------------------------------------------------------------------
+// PixelBufferRing
+//----------------------------------------------------------------------------
+//! Ring of pixel buffer objects for reading back a region of the framebuffer
+//! asynchronously. glReadPixels into a bound pixel buffer returns as soon as the
+//! copy is queued and a fence is inserted after it, so the CPU only waits if it
+//! maps a buffer before the GPU has finished filling it. Reads are consumed in
+//! the order they were started, so several can be in flight while later frames render.
+class PixelBufferRing
+{
+public:
+    //! Create numBuffers buffers for reading width * height BGR region with bottom-left corner at (x, y)
+    PixelBufferRing(GLint x, GLint y, unsigned int width, unsigned int height, unsigned int numBuffers);
+    ~PixelBufferRing();
+
+    //------------------------------------------------------------------------
+    // Public API
+    //------------------------------------------------------------------------
+    //! Start reading region of current read framebuffer into next free buffer
+    void startRead();
+
+    //! Wait for oldest read to complete and map its buffer, returning image header pointing at the mapped pixels
+    //! **NOTE** like glReadPixels, the first row of the image is the bottom of the region
+    cv::Mat mapOldest();
+
+    //! Unmap oldest buffer so it can be reused
+    void releaseOldest();
+
+    unsigned int getNumPending() const{ return m_NumPending; }
+    bool isFull() const{ return (m_NumPending == m_Buffers.size()); }
+
+private:
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    const GLint m_X;
+    const GLint m_Y;
+    const unsigned int m_Width;
+    const unsigned int m_Height;
+
+    // Bytes per row, padded to default GL_PACK_ALIGNMENT
+    const size_t m_Step;
+
+    std::vector<GLuint> m_Buffers;
+    std::vector<GLsync> m_Fences;
+
+    // Index of oldest pending read and number of pending reads
+    unsigned int m_Oldest;
+    unsigned int m_NumPending;
+};
@@ -0,0 +1,164 @@
+// Standard C++ includes
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Standard C includes
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+// OpenCV includes
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+// Antworld includes
+#include "parameters.h"
+#include "perfect_memory.h"
+
+//----------------------------------------------------------------------------
+// Anonymous namespace
+//----------------------------------------------------------------------------
+namespace
+{
+constexpr unsigned int numQueries = 20;
+
+// Generate smooth random greyscale view at model resolution
+cv::Mat generateView(std::mt19937 &gen)
+{
+    std::uniform_int_distribution<int> pixel(0, 255);
+    cv::Mat noise(Parameters::inputHeight / 2, Parameters::inputWidth / 4, CV_8UC1);
+    std::generate(noise.begin<uint8_t>(), noise.end<uint8_t>(), [&](){ return (uint8_t)pixel(gen); });
+
+    cv::Mat view;
+    cv::resize(noise, view, cv::Size(Parameters::inputWidth, Parameters::inputHeight), 0.0, 0.0, cv::INTER_CUBIC);
+    return view;
+}
+
+// Time getRIDF for all queries, storing RIDFs and best matches
+double timeRIDF(PerfectMemory &pm, const std::vector<cv::Mat> &queries, std::vector<cv::Mat> &ridfs, std::vector<cv::Point> &best)
+{
+    ridfs.resize(queries.size());
+    best.resize(queries.size());
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    for(size_t q = 0; q < queries.size(); q++) {
+        best[q] = pm.getRIDF(queries[q], ridfs[q]);
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / (double)queries.size();
+}
+
+// Maximum difference between FFT RIDF and sum of squared differences calculated directly
+double getMaxSSDError(const std::vector<cv::Mat> &snapshots, const cv::Mat &current, const cv::Mat &ridf)
+{
+    double maxError = 0.0;
+    cv::Mat shifted;
+    for(int i = 0; i < current.cols; i++) {
+        shiftColumns(current, i, shifted);
+        for(size_t j = 0; j < snapshots.size(); j++) {
+            const double ssd = cv::norm(snapshots[j], shifted, cv::NORM_L2SQR);
+            maxError = std::max(maxError, std::fabs(ssd - ridf.at<double>(i, j)));
+        }
+    }
+    return maxError;
+}
+}   // Anonymous namespace
+
+//! Compares the time taken to calculate the RIDF of a view against a growing route memory
+//! using the exhaustive column-shifting SAD, the FFT-based SSD, the SIMD SAD and the coarse-to-fine methods
+int main()
+{
+    std::mt19937 gen;
+    std::uniform_int_distribution<int> rotation(0, Parameters::inputWidth - 1);
+    std::normal_distribution<double> viewNoise(0.0, 8.0);
+
+    const unsigned int routeSizes[] = {10, 50, 100, 200, 500, 1000, 2000};
+
+    PerfectMemory sad(Parameters::inputWidth, Parameters::inputHeight, RIDFMethod::SAD);
+    PerfectMemory fft(Parameters::inputWidth, Parameters::inputHeight, RIDFMethod::FFT);
+    PerfectMemory simd(Parameters::inputWidth, Parameters::inputHeight, RIDFMethod::SIMD);
+    PerfectMemory coarse(Parameters::inputWidth, Parameters::inputHeight, RIDFMethod::CoarseToFine);
+    coarse.setCoarseToFine(Parameters::pmCoarseScale, Parameters::pmNumCandidates, 0);
+    std::vector<cv::Mat> snapshots;
+    for(unsigned int routeSize : routeSizes) {
+        // Grow memories to route size
+        while(snapshots.size() < routeSize) {
+            snapshots.push_back(generateView(gen));
+            sad.addSnapshot(snapshots.back());
+            fft.addSnapshot(snapshots.back());
+            simd.addSnapshot(snapshots.back());
+            coarse.addSnapshot(snapshots.back());
+        }
+
+        // Generate noisy, rotated copies of random snapshots to query with
+        std::uniform_int_distribution<size_t> snapshot(0, snapshots.size() - 1);
+        std::vector<cv::Mat> queries;
+        for(unsigned int q = 0; q < numQueries; q++) {
+            cv::Mat rotated;
+            shiftColumns(snapshots[snapshot(gen)], rotation(gen), rotated);
+
+            cv::Mat noise(rotated.size(), CV_64FC1);
+            std::generate(noise.begin<double>(), noise.end<double>(), [&](){ return viewNoise(gen); });
+
+            cv::Mat query;
+            cv::add(rotated, noise, query, cv::noArray(), CV_8UC1);
+            queries.push_back(query);
+        }
+
+        // Time each method
+        std::vector<cv::Mat> sadRIDFs;
+        std::vector<cv::Mat> fftRIDFs;
+        std::vector<cv::Mat> simdRIDFs;
+        std::vector<cv::Mat> coarseRIDFs;
+        std::vector<cv::Point> sadBest;
+        std::vector<cv::Point> fftBest;
+        std::vector<cv::Point> simdBest;
+        std::vector<cv::Point> coarseBest;
+        const double sadMs = timeRIDF(sad, queries, sadRIDFs, sadBest);
+        const double fftMs = timeRIDF(fft, queries, fftRIDFs, fftBest);
+        const double simdMs = timeRIDF(simd, queries, simdRIDFs, simdBest);
+        const double coarseMs = timeRIDF(coarse, queries, coarseRIDFs, coarseBest);
+
+        // Count queries where FFT agrees with SAD on best snapshot and heading and where SIMD is identical to SAD
+        unsigned int numFFTAgree = 0;
+        unsigned int numSIMDIdentical = 0;
+        unsigned int numCoarseAgree = 0;
+        for(unsigned int q = 0; q < numQueries; q++) {
+            if(sadBest[q] == fftBest[q]) {
+                numFFTAgree++;
+            }
+            if(sadBest[q] == simdBest[q] && cv::norm(sadRIDFs[q], simdRIDFs[q], cv::NORM_INF) == 0.0) {
+                numSIMDIdentical++;
+            }
+            if(sadBest[q] == coarseBest[q]) {
+                numCoarseAgree++;
+            }
+        }
+
+        std::cout << routeSize << " snapshots: SAD " << sadMs << "ms, FFT " << fftMs << "ms (" << sadMs / fftMs << "x), "
+            << "SIMD " << simdMs << "ms (" << sadMs / simdMs << "x), coarse-to-fine " << coarseMs << "ms (" << sadMs / coarseMs << "x)" << std::endl;
+        std::cout << "\tFFT: " << numFFTAgree << "/" << numQueries << " best matches agree, SSD max error " << getMaxSSDError(snapshots, queries[0], fftRIDFs[0])
+            << ", SIMD: " << numSIMDIdentical << "/" << numQueries << " RIDFs identical, coarse-to-fine: " << numCoarseAgree << "/" << numQueries << " best matches agree" << std::endl;
+    }
+
+    // Save largest memory, memory-map it back and check it gives identical RIDFs
+    const char *filename = "ridf_benchmark.bin";
+    simd.save(filename);
+    const auto loadStart = std::chrono::high_resolution_clock::now();
+    PerfectMemory loaded(Parameters::inputWidth, Parameters::inputHeight, RIDFMethod::SIMD);
+    loaded.load(filename);
+    const double loadMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
+
+    const cv::Mat query = generateView(gen);
+    cv::Mat simdRIDF;
+    cv::Mat loadedRIDF;
+    const bool identical = (simd.getRIDF(query, simdRIDF) == loaded.getRIDF(query, loadedRIDF))
+        && (cv::norm(simdRIDF, loadedRIDF, cv::NORM_INF) == 0.0);
+    std::cout << "Loaded " << loaded.getNumSnapshots() << " snapshots in " << loadMs << "ms, RIDF "
+        << (identical ? "identical" : "DIFFERENT") << std::endl;
+    std::remove(filename);
+
+    return EXIT_SUCCESS;
+}
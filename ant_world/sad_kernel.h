@@ -0,0 +1,143 @@
+#pragma once
+
+// Standard C++ includes
+#include <algorithm>
+#include <vector>
+
+// Standard C includes
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+// SSE2 and AVX2 includes
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+//----------------------------------------------------------------------------
+// SADKernel
+//----------------------------------------------------------------------------
+//! Calculates the sum of absolute differences between packed 8-bit snapshots and
+//! a view at every column rotation. Rather than building a shifted copy of the view
+//! for each rotation, its rows are stored twice end-to-end so the view shifted
+//! right by i columns is the contiguous run starting width - i bytes into each row.
+//! Packed snapshot rows are padded with zeros to a multiple of 16 bytes and the
+//! corresponding bytes of the view are masked out, so every row is processed as
+//! whole 16 (or, with AVX2, 32) byte vectors using psadbw.
+class SADKernel
+{
+public:
+    SADKernel(unsigned int width, unsigned int height)
+    :   m_Width(width), m_Height(height), m_Stride(((width + 15) / 16) * 16),
+        m_CurrentStride(width + m_Stride), m_Current(m_CurrentStride * height)
+    {
+    }
+
+    //------------------------------------------------------------------------
+    // Public API
+    //------------------------------------------------------------------------
+    //! Pack width * height 8-bit image with row step (in bytes) into getPackedSize() bytes
+    void pack(const uint8_t *image, size_t step, uint8_t *packed) const
+    {
+        for(unsigned int y = 0; y < m_Height; y++) {
+            std::copy_n(&image[y * step], m_Width, &packed[y * m_Stride]);
+            std::fill(&packed[(y * m_Stride) + m_Width], &packed[(y + 1) * m_Stride], 0);
+        }
+    }
+
+    //! Set the width * height 8-bit view with row step (in bytes) which snapshots are compared against
+    void setCurrent(const uint8_t *image, size_t step)
+    {
+        for(unsigned int y = 0; y < m_Height; y++) {
+            uint8_t *row = &m_Current[y * m_CurrentStride];
+            std::copy_n(&image[y * step], m_Width, row);
+            std::copy_n(&image[y * step], m_Width, row + m_Width);
+            std::fill(row + (2 * m_Width), row + m_CurrentStride, 0);
+        }
+    }
+
+    //! Calculate the SAD between packed snapshot and current view shifted right by each column
+    void calculate(const uint8_t *packed, uint32_t *sad) const
+    {
+        for(unsigned int i = 0; i < m_Width; i++) {
+            sad[i] = calculate(packed, i);
+        }
+    }
+
+    //! Calculate the SAD between packed snapshot and current view shifted right by a single rotation
+    uint32_t calculate(const uint8_t *packed, unsigned int rotation) const
+    {
+        const unsigned int offset = m_Width - rotation;
+        uint32_t total = 0;
+        for(unsigned int y = 0; y < m_Height; y++) {
+            total += calculateRow(&packed[y * m_Stride], &m_Current[(y * m_CurrentStride) + offset]);
+        }
+        return total;
+    }
+
+    //! Size of one packed snapshot in bytes
+    size_t getPackedSize() const{ return m_Stride * m_Height; }
+
+    unsigned int getWidth() const{ return m_Width; }
+    unsigned int getHeight() const{ return m_Height; }
+
+private:
+    //------------------------------------------------------------------------
+    // Private methods
+    //------------------------------------------------------------------------
+    uint32_t calculateRow(const uint8_t *snapshot, const uint8_t *current) const
+    {
+        unsigned int x = 0;
+        uint32_t total = 0;
+#ifdef __AVX2__
+        // Sum 32 bytes at a time into four 64-bit lanes
+        __m256i total256 = _mm256_setzero_si256();
+        for(; (x + 32) <= m_Width; x += 32) {
+            const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&snapshot[x]));
+            const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&current[x]));
+            total256 = _mm256_add_epi64(total256, _mm256_sad_epu8(s, c));
+        }
+        const __m128i total128 = _mm_add_epi64(_mm256_castsi256_si128(total256), _mm256_extracti128_si256(total256, 1));
+        total += (uint32_t)(_mm_cvtsi128_si32(total128) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(total128, total128)));
+#endif
+#ifdef __SSE2__
+        // Reading 16 bytes starting at masks[16 - n] gives a mask selecting the first n bytes
+        static const uint8_t masks[32] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                                          0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                                          0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+        // Sum remaining 16 bytes at a time into two 64-bit lanes, masking out
+        // the bytes of the view which correspond to the snapshot's padding
+        __m128i sum = _mm_setzero_si128();
+        for(; x < m_Width; x += 16) {
+            const unsigned int numValid = std::min(16u, m_Width - x);
+            const __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&masks[16 - numValid]));
+            const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&snapshot[x]));
+            const __m128i c = _mm_and_si128(mask, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&current[x])));
+            sum = _mm_add_epi64(sum, _mm_sad_epu8(s, c));
+        }
+        total += (uint32_t)(_mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(sum, sum)));
+#endif
+        // Scalar fallback
+        for(; x < m_Width; x++) {
+            total += (uint32_t)std::abs((int)snapshot[x] - (int)current[x]);
+        }
+        return total;
+    }
+
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    const unsigned int m_Width;
+    const unsigned int m_Height;
+
+    // Bytes per row of packed snapshots
+    const unsigned int m_Stride;
+
+    // Bytes per row of doubled current view - long enough to read m_Stride bytes from any rotation
+    const unsigned int m_CurrentStride;
+    std::vector<uint8_t> m_Current;
+};
@@ -1,56 +1,157 @@
 #include "snapshot_processor.h"
 
+// Standard C++ includes
+#include <iostream>
+
+// Standard C includes
+#include <cmath>
+
+// Common includes
+#include "../common/timer.h"
+
 //----------------------------------------------------------------------------
 // SnapshotProcessor
 //----------------------------------------------------------------------------
 SnapshotProcessor::SnapshotProcessor(unsigned int intermediateWidth, unsigned int intermediateHeight,
                                      unsigned int outputWidth, unsigned int outputHeight)
-:   m_IntermediateWidth(intermediateWidth), m_IntermediateHeight(intermediateHeight),
+:   m_FinalSnapshot(outputHeight, outputWidth, CV_8UC1),
+    m_IntermediateWidth(intermediateWidth), m_IntermediateHeight(intermediateHeight),
     m_OutputWidth(outputWidth), m_OutputHeight(outputHeight),
-    m_IntermediateSnapshot(intermediateWidth, intermediateHeight, CV_8UC3),
-    m_IntermediateSnapshotGreyscale(intermediateWidth, intermediateHeight, CV_8UC1),
-    m_FinalSnapshot(outputWidth, outputHeight, CV_8UC1),
-    m_FinalSnapshotFloat(outputWidth, outputHeight, CV_32FC1),
-    m_FinalSnapshotFloatGPU(outputWidth, outputHeight, CV_32FC1),
-    m_Clahe(cv::createCLAHE(40.0, cv::Size(8, 8)))
+    m_IntermediateSnapshot(intermediateHeight, intermediateWidth, CV_8UC3),
+    m_IntermediateSnapshotGreyscale(intermediateHeight, intermediateWidth, CV_8UC1),
+    m_FinalSnapshotFloat(outputHeight, outputWidth, CV_32FC1),
+#ifndef CPU_ONLY
+    m_FinalSnapshotFloatGPU(outputHeight, outputWidth, CV_32FC1),
+#endif
+    m_Clahe(cv::createCLAHE(40.0, cv::Size(8, 8))), m_DebugWriter(nullptr), m_NumProcessed(0), m_NumUploaded(0),
+    m_ResizeTime(0.0), m_GreyscaleTime(0.0), m_InvertTime(0.0), m_ClaheTime(0.0), m_FinalResizeTime(0.0),
+    m_NormaliseTime(0.0), m_UploadTime(0.0)
 {
 }
 //----------------------------------------------------------------------------
 std::tuple<float*, unsigned int> SnapshotProcessor::process(const cv::Mat &snapshot)
+{
+    processToHost(snapshot);
+
+#ifdef CPU_ONLY
+    // Simulation reads snapshot directly from host memory
+    return std::make_tuple(reinterpret_cast<float*>(m_FinalSnapshotFloat.data), m_FinalSnapshotFloat.step / sizeof(float));
+#else
+    // Upload final snapshot to GPU
+    {
+        TimerAccumulate<> timer(m_UploadTime);
+        m_FinalSnapshotFloatGPU.upload(m_FinalSnapshotFloat);
+    }
+    m_NumUploaded++;
+
+    // Extract device pointers and step; and return
+    auto finalSnapshotPtrStep = (cv::cuda::PtrStep<float>)m_FinalSnapshotFloatGPU;
+    return std::make_tuple(finalSnapshotPtrStep.data, finalSnapshotPtrStep.step / sizeof(float));
+#endif
+}
+//----------------------------------------------------------------------------
+const cv::Mat &SnapshotProcessor::processToHost(const cv::Mat &snapshot)
 {
     // **TODO** theoretically this processing could all be done on the GPU but
     // a) we're currently starting from a snapshot in host memory
     // b) CLAHE seems broken for GPU matrices
 
     // Downsample to intermediate size
-    cv::resize(snapshot, m_IntermediateSnapshot,
-               cv::Size(m_IntermediateWidth, m_IntermediateHeight));
+    {
+        TimerAccumulate<> timer(m_ResizeTime);
+        cv::resize(snapshot, m_IntermediateSnapshot,
+                   cv::Size(m_IntermediateWidth, m_IntermediateHeight));
+    }
 
     // Convert to greyscale
-    cv::cvtColor(m_IntermediateSnapshot, m_IntermediateSnapshotGreyscale, CV_BGR2GRAY);
+    {
+        TimerAccumulate<> timer(m_GreyscaleTime);
+        cv::cvtColor(m_IntermediateSnapshot, m_IntermediateSnapshotGreyscale, CV_BGR2GRAY);
+    }
 
-    // Invert image
-    cv::subtract(255, m_IntermediateSnapshotGreyscale, m_IntermediateSnapshotGreyscale);
+    // Invert image (for 8-bit images, bitwise not is 255 - x without converting 255 to a temporary matrix)
+    {
+        TimerAccumulate<> timer(m_InvertTime);
+        cv::bitwise_not(m_IntermediateSnapshotGreyscale, m_IntermediateSnapshotGreyscale);
+    }
 
     // Apply histogram normalization
     // http://answers.opencv.org/question/15442/difference-of-clahe-between-opencv-and-matlab/
-    m_Clahe->apply(m_IntermediateSnapshotGreyscale, m_IntermediateSnapshotGreyscale);
+    {
+        TimerAccumulate<> timer(m_ClaheTime);
+        m_Clahe->apply(m_IntermediateSnapshotGreyscale, m_IntermediateSnapshotGreyscale);
+    }
 
     // Finally resample down to final size
-    cv::resize(m_IntermediateSnapshotGreyscale, m_FinalSnapshot,
-                cv::Size(m_OutputWidth, m_OutputHeight),
-                0.0, 0.0, CV_INTER_CUBIC);
-    m_FinalSnapshot.convertTo(m_FinalSnapshotFloat, CV_32FC1, 1.0 / 255.0);
+    {
+        TimerAccumulate<> timer(m_FinalResizeTime);
+        cv::resize(m_IntermediateSnapshotGreyscale, m_FinalSnapshot,
+                   cv::Size(m_OutputWidth, m_OutputHeight),
+                   0.0, 0.0, CV_INTER_CUBIC);
+    }
 
-    cv::imwrite("snapshot.png", m_FinalSnapshot);
+    // Convert to float and normalise snapshot using L2 norm
+    {
+        TimerAccumulate<> timer(m_NormaliseTime);
+        m_FinalSnapshot.convertTo(m_FinalSnapshotFloat, CV_32FC1, 1.0 / 255.0);
+        cv::normalize(m_FinalSnapshotFloat, m_FinalSnapshotFloat);
+    }
 
-    // Normalise snapshot using L2 norm
-    cv::normalize(m_FinalSnapshotFloat, m_FinalSnapshotFloat);
+    // Hand final snapshot to debug writer if it's time for another dump
+    if(m_DebugWriter != nullptr && m_DebugWriter->isDumpDue(m_LastDump)) {
+        m_DebugWriter->writeImage("snapshot_" + std::to_string(m_NumProcessed) + ".png", m_FinalSnapshot);
+    }
+    m_NumProcessed++;
 
-    // Upload final snapshot to GPU
-    m_FinalSnapshotFloatGPU.upload(m_FinalSnapshotFloat);
+    return m_FinalSnapshotFloat;
+}
+//----------------------------------------------------------------------------
+void SnapshotProcessor::printTimes() const
+{
+    if(m_NumProcessed == 0) {
+        return;
+    }
 
-    // Extract device pointers and step; and return
-    auto finalSnapshotPtrStep = (cv::cuda::PtrStep<float>)m_FinalSnapshotFloatGPU;
-    return std::make_tuple(finalSnapshotPtrStep.data, finalSnapshotPtrStep.step / sizeof(float));
-}
\ No newline at end of file
+    const double n = (double)m_NumProcessed;
+    std::cout << "Snapshot processing (mean of " << m_NumProcessed << "): resize " << m_ResizeTime / n
+        << "ms, cvtColor " << m_GreyscaleTime / n << "ms, invert " << m_InvertTime / n
+        << "ms, CLAHE " << m_ClaheTime / n << "ms, final resize " << m_FinalResizeTime / n
+        << "ms, normalize " << m_NormaliseTime / n << "ms";
+#ifndef CPU_ONLY
+    if(m_NumUploaded > 0) {
+        std::cout << ", upload " << m_UploadTime / (double)m_NumUploaded << "ms";
+    }
+#endif
+    std::cout << std::endl;
+}
+//----------------------------------------------------------------------------
+void rotatePanorama(const cv::Mat &panorama, double degrees, cv::Mat &rotated)
+{
+    rotated.create(panorama.size(), panorama.type());
+
+    // Turning right moves the view left so output column x comes from input column x + shift
+    const int width = panorama.cols;
+    const int channels = panorama.channels();
+    const double shift = degrees * (double)width / 360.0;
+    const double wrappedShift = shift - (std::floor(shift / (double)width) * (double)width);
+
+    // Split shift into whole columns and 8-bit fixed point weight of next column
+    int wholeShift = (int)wrappedShift;
+    unsigned int weight = (unsigned int)std::lround((wrappedShift - (double)wholeShift) * 256.0);
+    if(weight == 256) {
+        wholeShift = (wholeShift + 1) % width;
+        weight = 0;
+    }
+
+    for(int y = 0; y < panorama.rows; y++) {
+        const uint8_t *in = panorama.ptr<uint8_t>(y);
+        uint8_t *out = rotated.ptr<uint8_t>(y);
+        for(int x = 0; x < width; x++) {
+            const int a = ((x + wholeShift) < width) ? (x + wholeShift) : (x + wholeShift - width);
+            const int b = ((a + 1) < width) ? (a + 1) : 0;
+            for(int c = 0; c < channels; c++) {
+                out[(x * channels) + c] = (uint8_t)(((in[(a * channels) + c] * (256 - weight)) + (in[(b * channels) + c] * weight) + 128) >> 8);
+            }
+        }
+    }
+}
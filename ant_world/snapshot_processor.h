@@ -1,8 +1,14 @@
 #pragma once
 
+// Standard C++ includes
+#include <tuple>
+
 // OpenCV includes
 #include <opencv2/opencv.hpp>
 
+// Common includes
+#include "../common/debug_writer.h"
+
 //----------------------------------------------------------------------------
 // SnapshotProcessor
 //----------------------------------------------------------------------------
@@ -15,10 +21,20 @@ public:
     //------------------------------------------------------------------------
     // Public API
     //------------------------------------------------------------------------
-    // Process input snapshot (probably at screen resolution)
-    // and return GPU data pointer and step
+    // Process input snapshot (probably at screen resolution) and return data pointer and step
+    // (in floats) of normalised snapshot - on the GPU unless built with CPU_ONLY
+    // **NOTE** all processing happens in buffers allocated by the constructor
     std::tuple<float*, unsigned int> process(const cv::Mat &snapshot);
-    
+
+    // Process input snapshot and return normalised snapshot in host memory, which is overwritten by the next call
+    const cv::Mat &processToHost(const cv::Mat &snapshot);
+
+    // Queue final snapshots to be written by debugWriter as often as it allows (nullptr to disable)
+    void setDebugWriter(DebugWriter *debugWriter){ m_DebugWriter = debugWriter; }
+
+    // Print mean time spent in each processing stage
+    void printTimes() const;
+
     // Host OpenCV array to hold final resolution greyscale snapshot
     cv::Mat m_FinalSnapshot;
 
@@ -42,9 +58,29 @@ private:
 
     cv::Mat m_FinalSnapshotFloat;
 
-    // GPU OpenCV array to hold
+#ifndef CPU_ONLY
+    // GPU OpenCV array to hold normalised final snapshot
     cv::cuda::GpuMat m_FinalSnapshotFloatGPU;
+#endif
 
     // CLAHE algorithm for histogram normalization
     cv::Ptr<cv::CLAHE> m_Clahe;
-};
\ No newline at end of file
+
+    DebugWriter *m_DebugWriter;
+    DebugWriter::TimePoint m_LastDump;
+
+    // Number of snapshots processed (and uploaded) and total time (in ms) spent in each stage
+    unsigned int m_NumProcessed;
+    unsigned int m_NumUploaded;
+    double m_ResizeTime;
+    double m_GreyscaleTime;
+    double m_InvertTime;
+    double m_ClaheTime;
+    double m_FinalResizeTime;
+    double m_NormaliseTime;
+    double m_UploadTime;
+};
+
+// Rotate 8-bit panorama covering 360 degrees of azimuth as if the ant had turned right by degrees,
+// linearly interpolating between columns when the rotation isn't a whole number of them
+void rotatePanorama(const cv::Mat &panorama, double degrees, cv::Mat &rotated);
\ No newline at end of file
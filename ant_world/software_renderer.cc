@@ -0,0 +1,366 @@
+#include "software_renderer.h"
+
+// Standard C++ includes
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+// Standard C includes
+#include <cmath>
+
+// SSE2 and AVX includes
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+
+// Antworld includes
+#include "common.h"
+
+//----------------------------------------------------------------------------
+// Anonymous namespace
+//----------------------------------------------------------------------------
+namespace
+{
+// Height of ant's eye above the ground (matches renderAntView)
+constexpr float eyeHeight = 0.01f;
+
+// Size of square ground (matches World)
+constexpr float groundSize = 10.5f;
+
+constexpr float pi = 3.141592654f;
+
+// Convert colour to BGR bytes packed into 32-bit word, rounding like OpenGL does
+uint32_t packColour(float red, float green, float blue)
+{
+    auto toByte = [](float c){ return (uint32_t)std::round(std::min(1.0f, std::max(0.0f, c)) * 255.0f); };
+    return toByte(blue) | (toByte(green) << 8) | (toByte(red) << 16);
+}
+
+// Colour of background, cleared to white by ant_world
+const uint32_t skyColour = packColour(1.0f, 1.0f, 1.0f);
+}   // anonymous namespace
+
+//----------------------------------------------------------------------------
+// SoftwareRenderer
+//----------------------------------------------------------------------------
+SoftwareRenderer::SoftwareRenderer(const std::string &worldFilename, const float (&worldColour)[3], const float (&groundColour)[3],
+                                   unsigned int width, unsigned int height, float minElevation, float maxElevation, float farDistance,
+                                   unsigned int numThreads)
+:   m_Width(width), m_Height(height), m_Stride(((width + 7) / 8) * 8),
+    m_MinElevation(minElevation * degreesToRadians), m_ElevationStep((maxElevation - minElevation) * degreesToRadians / (float)height),
+    m_AzimuthStep(2.0f * pi / (float)width), m_SinAzimuth(m_Stride, 0.0f), m_CosAzimuth(m_Stride, 0.0f), m_TanElevation(height),
+    m_FarDepth(m_Stride * height), m_Depth(m_Stride * height), m_Colour(m_Stride * height), m_ThreadPool(numThreads)
+{
+    if(!loadWorld(worldFilename, worldColour, groundColour)) {
+        throw std::runtime_error("Cannot load world");
+    }
+    m_ViewTriangles.resize(m_Colours.size());
+
+    // Calculate direction of pixel centres - azimuth runs from -180 degrees (behind, to the left) to 180
+    for(unsigned int x = 0; x < m_Width; x++) {
+        const float azimuth = -pi + (((float)x + 0.5f) * m_AzimuthStep);
+        m_SinAzimuth[x] = std::sin(azimuth);
+        m_CosAzimuth[x] = std::cos(azimuth);
+    }
+    for(unsigned int y = 0; y < m_Height; y++) {
+        m_TanElevation[y] = std::tan(m_MinElevation + (((float)y + 0.5f) * m_ElevationStep));
+    }
+
+    // OpenGL clips at far plane of whichever cubemap face each direction falls in
+    for(unsigned int y = 0; y < m_Height; y++) {
+        for(unsigned int x = 0; x < m_Width; x++) {
+            const float maxComponent = std::max(std::max(std::fabs(m_SinAzimuth[x]), std::fabs(m_CosAzimuth[x])), std::fabs(m_TanElevation[y]));
+            m_FarDepth[(y * m_Stride) + x] = farDistance / maxComponent;
+        }
+    }
+}
+//----------------------------------------------------------------------------
+void SoftwareRenderer::render(float antX, float antY, float antHeading, uint8_t *image, size_t step)
+{
+    const float sinHeading = std::sin(antHeading * degreesToRadians);
+    const float cosHeading = std::cos(antHeading * degreesToRadians);
+
+    // Transform triangles into ant's frame of reference and find which pixels they may cover
+    m_ThreadPool.parallelFor(m_ViewTriangles.size(),
+        [this, antX, antY, sinHeading, cosHeading](unsigned int, size_t begin, size_t end)
+        {
+            for(size_t t = begin; t < end; t++) {
+                setupTriangle(t, antX, antY, sinHeading, cosHeading);
+            }
+        });
+
+    // Rasterise blocks of rows
+    m_ThreadPool.parallelFor(m_Height,
+        [this, image, step](unsigned int, size_t begin, size_t end)
+        {
+            rasteriseRows(begin, end, image, step);
+        });
+}
+//----------------------------------------------------------------------------
+bool SoftwareRenderer::loadWorld(const std::string &filename, const float (&worldColour)[3], const float (&groundColour)[3])
+{
+    // Open file for binary IO
+    std::ifstream input(filename, std::ios::binary);
+    if(!input.good()) {
+        std::cerr << "Cannot open world file:" << filename << std::endl;
+        return false;
+    }
+
+    // Seek to end of file, get size and rewind
+    input.seekg(0, std::ios_base::end);
+    const size_t numTriangles = input.tellg() / (sizeof(double) * 12);
+    input.seekg(0);
+
+    // Add ground triangles
+    m_Positions = {0.0f,        0.0f,       0.0f,
+                   groundSize,  groundSize, 0.0f,
+                   0.0f,        groundSize, 0.0f,
+
+                   0.0f,        0.0f,       0.0f,
+                   groundSize,  0.0f,       0.0f,
+                   groundSize,  groundSize, 0.0f};
+    m_Colours.assign(2, packColour(groundColour[0], groundColour[1], groundColour[2]));
+
+    // Read components (X, Y and Z) of each vertex of each triangle
+    m_Positions.resize(m_Positions.size() + (numTriangles * 9));
+    for(unsigned int c = 0; c < 3; c++) {
+        for(unsigned int v = 0; v < 3; v++) {
+            for(size_t t = 0; t < numTriangles; t++) {
+                double trianglePosition;
+                input.read(reinterpret_cast<char*>(&trianglePosition), sizeof(double));
+                m_Positions[18 + (t * 9) + (v * 3) + c] = (float)trianglePosition;
+            }
+        }
+    }
+
+    // Read triangle colours
+    // **NOTE** we only bother reading the R channel because colours are greyscale anyway
+    for(size_t t = 0; t < numTriangles; t++) {
+        double triangleColour;
+        input.read(reinterpret_cast<char*>(&triangleColour), sizeof(double));
+        m_Colours.push_back(packColour((float)(worldColour[0] * triangleColour),
+                                       (float)(worldColour[1] * triangleColour),
+                                       (float)(worldColour[2] * triangleColour)));
+    }
+
+    return input.good();
+}
+//----------------------------------------------------------------------------
+void SoftwareRenderer::setupTriangle(size_t t, float antX, float antY, float sinHeading, float cosHeading)
+{
+    ViewTriangle &triangle = m_ViewTriangles[t];
+    triangle.colour = m_Colours[t];
+    triangle.rowBegin = 0;
+    triangle.rowEnd = 0;
+
+    // Transform vertices relative to ant and rotate so it is facing along the y axis
+    float v[3][3];
+    const float *position = &m_Positions[t * 9];
+    for(unsigned int i = 0; i < 3; i++) {
+        const float x = position[(i * 3) + 0] - antX;
+        const float y = position[(i * 3) + 1] - antY;
+        v[i][0] = (x * cosHeading) - (y * sinHeading);
+        v[i][1] = (x * sinHeading) + (y * cosHeading);
+        v[i][2] = position[(i * 3) + 2] - eyeHeight;
+    }
+
+    // Calculate normals of planes through eye and each edge
+    for(unsigned int i = 0; i < 3; i++) {
+        const float *a = v[i];
+        const float *b = v[(i + 1) % 3];
+        triangle.edges[i][0] = (a[1] * b[2]) - (a[2] * b[1]);
+        triangle.edges[i][1] = (a[2] * b[0]) - (a[0] * b[2]);
+        triangle.edges[i][2] = (a[0] * b[1]) - (a[1] * b[0]);
+    }
+
+    // The edge functions at the direction of any point inside triangle share the sign of the triple product,
+    // so flip everything to make them positive (if eye is in plane of triangle, it can't be seen)
+    triangle.volume = (v[0][0] * triangle.edges[1][0]) + (v[0][1] * triangle.edges[1][1]) + (v[0][2] * triangle.edges[1][2]);
+    if(triangle.volume == 0.0f) {
+        return;
+    }
+    else if(triangle.volume < 0.0f) {
+        triangle.volume = -triangle.volume;
+        for(auto &e : triangle.edges) {
+            e[0] = -e[0];
+            e[1] = -e[1];
+            e[2] = -e[2];
+        }
+    }
+
+    // By default, triangle may cover the whole panorama
+    int rowBegin = 0;
+    int rowEnd = (int)m_Height;
+    triangle.columnBegin = 0;
+    triangle.numColumns = m_Width;
+
+    // Find bounding sphere of triangle
+    float centre[3];
+    for(unsigned int c = 0; c < 3; c++) {
+        centre[c] = (v[0][c] + v[1][c] + v[2][c]) / 3.0f;
+    }
+    float radiusSquared = 0.0f;
+    for(unsigned int i = 0; i < 3; i++) {
+        const float dx = v[i][0] - centre[0];
+        const float dy = v[i][1] - centre[1];
+        const float dz = v[i][2] - centre[2];
+        radiusSquared = std::max(radiusSquared, (dx * dx) + (dy * dy) + (dz * dz));
+    }
+
+    // If eye is outside bounding sphere, triangle lies within the cone of directions it subtends
+    const float distanceSquared = (centre[0] * centre[0]) + (centre[1] * centre[1]) + (centre[2] * centre[2]);
+    if(distanceSquared > radiusSquared) {
+        const float distance = std::sqrt(distanceSquared);
+        const float coneAngle = std::asin(std::sqrt(radiusSquared) / distance);
+        const float elevation = std::asin(centre[2] / distance);
+
+        // Find rows whose centres lie within cone's range of elevation
+        rowBegin = std::max(rowBegin, (int)std::ceil(((elevation - coneAngle - m_MinElevation) / m_ElevationStep) - 0.5f));
+        rowEnd = std::min(rowEnd, (int)std::floor(((elevation + coneAngle - m_MinElevation) / m_ElevationStep) - 0.5f) + 1);
+
+        // If cone doesn't contain a pole, find columns whose centres lie within its range of azimuth
+        if((std::fabs(elevation) + coneAngle) < (0.5f * pi)) {
+            const float azimuth = std::atan2(centre[0], centre[1]);
+            const float halfWidth = std::asin(std::sin(coneAngle) / std::cos(elevation));
+            const int columnBegin = (int)std::ceil(((azimuth - halfWidth + pi) / m_AzimuthStep) - 0.5f);
+            const int columnEnd = (int)std::floor(((azimuth + halfWidth + pi) / m_AzimuthStep) - 0.5f) + 1;
+            if(columnEnd <= columnBegin) {
+                return;
+            }
+            else if((columnEnd - columnBegin) < (int)m_Width) {
+                triangle.columnBegin = (unsigned int)(((columnBegin % (int)m_Width) + (int)m_Width) % (int)m_Width);
+                triangle.numColumns = (unsigned int)(columnEnd - columnBegin);
+            }
+        }
+    }
+
+    triangle.rowBegin = rowBegin;
+    triangle.rowEnd = rowEnd;
+}
+//----------------------------------------------------------------------------
+void SoftwareRenderer::rasteriseRows(unsigned int rowBegin, unsigned int rowEnd, uint8_t *image, size_t step)
+{
+    // Clear rows to background at far plane
+    std::copy(m_FarDepth.begin() + (rowBegin * m_Stride), m_FarDepth.begin() + (rowEnd * m_Stride), m_Depth.begin() + (rowBegin * m_Stride));
+    std::fill(m_Colour.begin() + (rowBegin * m_Stride), m_Colour.begin() + (rowEnd * m_Stride), skyColour);
+
+    // Rasterise triangles in order, within the rows they overlap, so pixels at equal depth keep the first triangle like OpenGL
+    for(const auto &triangle : m_ViewTriangles) {
+        const unsigned int begin = (unsigned int)std::max(triangle.rowBegin, (int)rowBegin);
+        const unsigned int end = (unsigned int)std::min(triangle.rowEnd, (int)rowEnd);
+        const unsigned int columnEnd = triangle.columnBegin + triangle.numColumns;
+        for(unsigned int y = begin; y < end; y++) {
+            // If columns wrap around, rasterise them in two spans
+            if(columnEnd > m_Width) {
+                rasteriseSpan(triangle, y, triangle.columnBegin, m_Width);
+                rasteriseSpan(triangle, y, 0, columnEnd - m_Width);
+            }
+            else {
+                rasteriseSpan(triangle, y, triangle.columnBegin, columnEnd);
+            }
+        }
+    }
+
+    // Unpack colours into image
+    for(unsigned int y = rowBegin; y < rowEnd; y++) {
+        const uint32_t *colour = &m_Colour[y * m_Stride];
+        uint8_t *pixel = &image[y * step];
+        for(unsigned int x = 0; x < m_Width; x++) {
+            *pixel++ = (uint8_t)(colour[x]);
+            *pixel++ = (uint8_t)(colour[x] >> 8);
+            *pixel++ = (uint8_t)(colour[x] >> 16);
+        }
+    }
+}
+//----------------------------------------------------------------------------
+void SoftwareRenderer::rasteriseSpan(const ViewTriangle &triangle, unsigned int row, unsigned int begin, unsigned int end)
+{
+    // Evaluating edge functions with scaled directions (sin(azimuth), cos(azimuth), tan(elevation)) doesn't
+    // change their signs, but scales the distance they give along each direction by cos(elevation)
+    const float tanElevation = m_TanElevation[row];
+    const float b0 = triangle.edges[0][2] * tanElevation;
+    const float b1 = triangle.edges[1][2] * tanElevation;
+    const float b2 = triangle.edges[2][2] * tanElevation;
+    float *depth = &m_Depth[row * m_Stride];
+    uint32_t *colour = &m_Colour[row * m_Stride];
+
+    // Pixels are inside if all edge functions are positive and closer if volume / sum of edge functions is
+    // less than depth - padding means whole vectors can be processed from the start of the span's first vector
+#if defined(__AVX__)
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 n0x = _mm256_set1_ps(triangle.edges[0][0]);
+    const __m256 n0y = _mm256_set1_ps(triangle.edges[0][1]);
+    const __m256 n1x = _mm256_set1_ps(triangle.edges[1][0]);
+    const __m256 n1y = _mm256_set1_ps(triangle.edges[1][1]);
+    const __m256 n2x = _mm256_set1_ps(triangle.edges[2][0]);
+    const __m256 n2y = _mm256_set1_ps(triangle.edges[2][1]);
+    const __m256 b0v = _mm256_set1_ps(b0);
+    const __m256 b1v = _mm256_set1_ps(b1);
+    const __m256 b2v = _mm256_set1_ps(b2);
+    const __m256 volume = _mm256_set1_ps(triangle.volume);
+    const __m256 triangleColour = _mm256_castsi256_ps(_mm256_set1_epi32((int)triangle.colour));
+    for(unsigned int x = begin & ~7u; x < end; x += 8) {
+        const __m256 s = _mm256_loadu_ps(&m_SinAzimuth[x]);
+        const __m256 c = _mm256_loadu_ps(&m_CosAzimuth[x]);
+        const __m256 e0 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(n0x, s), _mm256_mul_ps(n0y, c)), b0v);
+        const __m256 e1 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(n1x, s), _mm256_mul_ps(n1y, c)), b1v);
+        const __m256 e2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(n2x, s), _mm256_mul_ps(n2y, c)), b2v);
+        const __m256 sum = _mm256_add_ps(_mm256_add_ps(e0, e1), e2);
+        const __m256 d = _mm256_loadu_ps(&depth[x]);
+
+        const __m256 inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(e0, zero, _CMP_GE_OQ), _mm256_cmp_ps(e1, zero, _CMP_GE_OQ)),
+                                            _mm256_cmp_ps(e2, zero, _CMP_GE_OQ));
+        const __m256 mask = _mm256_and_ps(inside, _mm256_cmp_ps(volume, _mm256_mul_ps(d, sum), _CMP_LT_OQ));
+        if(_mm256_movemask_ps(mask) != 0) {
+            float *pixelColour = reinterpret_cast<float*>(&colour[x]);
+            _mm256_storeu_ps(&depth[x], _mm256_blendv_ps(d, _mm256_div_ps(volume, sum), mask));
+            _mm256_storeu_ps(pixelColour, _mm256_blendv_ps(_mm256_loadu_ps(pixelColour), triangleColour, mask));
+        }
+    }
+#elif defined(__SSE2__)
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 n0x = _mm_set1_ps(triangle.edges[0][0]);
+    const __m128 n0y = _mm_set1_ps(triangle.edges[0][1]);
+    const __m128 n1x = _mm_set1_ps(triangle.edges[1][0]);
+    const __m128 n1y = _mm_set1_ps(triangle.edges[1][1]);
+    const __m128 n2x = _mm_set1_ps(triangle.edges[2][0]);
+    const __m128 n2y = _mm_set1_ps(triangle.edges[2][1]);
+    const __m128 b0v = _mm_set1_ps(b0);
+    const __m128 b1v = _mm_set1_ps(b1);
+    const __m128 b2v = _mm_set1_ps(b2);
+    const __m128 volume = _mm_set1_ps(triangle.volume);
+    const __m128 triangleColour = _mm_castsi128_ps(_mm_set1_epi32((int)triangle.colour));
+    for(unsigned int x = begin & ~3u; x < end; x += 4) {
+        const __m128 s = _mm_loadu_ps(&m_SinAzimuth[x]);
+        const __m128 c = _mm_loadu_ps(&m_CosAzimuth[x]);
+        const __m128 e0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(n0x, s), _mm_mul_ps(n0y, c)), b0v);
+        const __m128 e1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(n1x, s), _mm_mul_ps(n1y, c)), b1v);
+        const __m128 e2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(n2x, s), _mm_mul_ps(n2y, c)), b2v);
+        const __m128 sum = _mm_add_ps(_mm_add_ps(e0, e1), e2);
+        const __m128 d = _mm_loadu_ps(&depth[x]);
+
+        const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+        const __m128 mask = _mm_and_ps(inside, _mm_cmplt_ps(volume, _mm_mul_ps(d, sum)));
+        if(_mm_movemask_ps(mask) != 0) {
+            float *pixelColour = reinterpret_cast<float*>(&colour[x]);
+            _mm_storeu_ps(&depth[x], _mm_or_ps(_mm_and_ps(mask, _mm_div_ps(volume, sum)), _mm_andnot_ps(mask, d)));
+            _mm_storeu_ps(pixelColour, _mm_or_ps(_mm_and_ps(mask, triangleColour), _mm_andnot_ps(mask, _mm_loadu_ps(pixelColour))));
+        }
+    }
+#else
+    for(unsigned int x = begin; x < end; x++) {
+        const float e0 = (triangle.edges[0][0] * m_SinAzimuth[x]) + (triangle.edges[0][1] * m_CosAzimuth[x]) + b0;
+        const float e1 = (triangle.edges[1][0] * m_SinAzimuth[x]) + (triangle.edges[1][1] * m_CosAzimuth[x]) + b1;
+        const float e2 = (triangle.edges[2][0] * m_SinAzimuth[x]) + (triangle.edges[2][1] * m_CosAzimuth[x]) + b2;
+        const float sum = e0 + e1 + e2;
+        if(e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f && triangle.volume < (depth[x] * sum)) {
+            depth[x] = triangle.volume / sum;
+            colour[x] = triangle.colour;
+        }
+    }
+#endif
+}
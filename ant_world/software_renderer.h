@@ -0,0 +1,108 @@
+#pragma once
+
+// Standard C++ includes
+#include <string>
+#include <thread>
+#include <vector>
+
+// Standard C includes
+#include <cstddef>
+#include <cstdint>
+
+// Common includes
+#include "../common/thread_pool.h"
+
+//----------------------------------------------------------------------------
+// SoftwareRenderer
+//----------------------------------------------------------------------------
+//! Renders the world on the CPU directly into a low-resolution equirectangular
+//! panorama, without the cubemap and render mesh used by the OpenGL path. Rather
+//! than projecting triangles onto the image, each pixel's view direction d is
+//! tested against the planes through the eye and each triangle edge: the edge
+//! functions n.d are linear in d, so are exact on the sphere and can be evaluated
+//! for a row of pixels at a time with SIMD. Their sum also gives the distance
+//! to the triangle along d, which is used for depth testing. Rows are split
+//! between threads, each of which rasterises all the triangles overlapping them.
+class SoftwareRenderer
+{
+public:
+    //! Load world from file (the same format as World) to render width * height panoramas
+    //! covering 360 degrees of azimuth and the given range of elevation (in degrees)
+    SoftwareRenderer(const std::string &worldFilename, const float (&worldColour)[3], const float (&groundColour)[3],
+                     unsigned int width, unsigned int height, float minElevation, float maxElevation, float farDistance,
+                     unsigned int numThreads = std::thread::hardware_concurrency());
+
+    //------------------------------------------------------------------------
+    // Public API
+    //------------------------------------------------------------------------
+    //! Render view from ant's position and heading into width * height 8-bit BGR image with row step (in bytes)
+    //! **NOTE** like snapshots read back from the OpenGL framebuffer, the first row is the lowest elevation
+    void render(float antX, float antY, float antHeading, uint8_t *image, size_t step);
+
+    unsigned int getWidth() const{ return m_Width; }
+    unsigned int getHeight() const{ return m_Height; }
+
+private:
+    //------------------------------------------------------------------------
+    // ViewTriangle
+    //------------------------------------------------------------------------
+    //! Triangle transformed into ant's frame of reference and set up for rasterisation
+    struct ViewTriangle
+    {
+        // Normals of planes through eye and each edge, oriented so pixels inside triangle have positive edge functions
+        float edges[3][3];
+
+        // Triple product of vertices (oriented to be positive) - distance along d is this divided by sum of edge functions
+        float volume;
+
+        uint32_t colour;
+
+        // Range of rows and (wrapping) columns which may contain triangle (rows are empty if it can't be seen)
+        int rowBegin;
+        int rowEnd;
+        unsigned int columnBegin;
+        unsigned int numColumns;
+    };
+
+    //------------------------------------------------------------------------
+    // Private methods
+    //------------------------------------------------------------------------
+    bool loadWorld(const std::string &filename, const float (&worldColour)[3], const float (&groundColour)[3]);
+
+    void setupTriangle(size_t t, float antX, float antY, float sinHeading, float cosHeading);
+    void rasteriseRows(unsigned int rowBegin, unsigned int rowEnd, uint8_t *image, size_t step);
+    void rasteriseSpan(const ViewTriangle &triangle, unsigned int row, unsigned int begin, unsigned int end);
+
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    const unsigned int m_Width;
+    const unsigned int m_Height;
+
+    // Floats per row of buffers, padded so whole SIMD vectors can be processed
+    const unsigned int m_Stride;
+
+    const float m_MinElevation;
+    const float m_ElevationStep;
+    const float m_AzimuthStep;
+
+    // World triangle vertex positions and packed BGR colours (ground first, as in World)
+    std::vector<float> m_Positions;
+    std::vector<uint32_t> m_Colours;
+
+    // Direction of each column and row - directions are scaled by 1 / cos(elevation) to (sin(azimuth), cos(azimuth), tan(elevation))
+    std::vector<float> m_SinAzimuth;
+    std::vector<float> m_CosAzimuth;
+    std::vector<float> m_TanElevation;
+
+    // Horizontal distance to far plane of OpenGL cubemap faces in each direction, used to initialise depth
+    std::vector<float> m_FarDepth;
+
+    // Horizontal distance to and colour of nearest triangle in each direction
+    std::vector<float> m_Depth;
+    std::vector<uint32_t> m_Colour;
+
+    std::vector<ViewTriangle> m_ViewTriangles;
+
+    ThreadPool m_ThreadPool;
+};
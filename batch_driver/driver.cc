@@ -0,0 +1,367 @@
+// Standard C++ includes
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Standard C includes
+#include <cstdlib>
+#include <cstring>
+
+// POSIX includes
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sched.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+//----------------------------------------------------------------------------
+// Anonymous namespace
+//----------------------------------------------------------------------------
+namespace
+{
+//----------------------------------------------------------------------------
+// Job
+//----------------------------------------------------------------------------
+//! A single recording to be processed by a worker process
+struct Job
+{
+    Job(const std::string &input, const std::string &name) : input(input), name(name), core(-1), pid(-1),
+        exitStatus(-1), wallTime(0.0), steps(0), events(0), stepsPerSecond(0.0), eventsPerSecond(0.0)
+    {
+    }
+
+    // Absolute path to recording and name used for its output directory
+    std::string input;
+    std::string name;
+
+    // Core worker process was pinned to and its PID
+    int core;
+    pid_t pid;
+
+    // Results
+    int exitStatus;
+    double wallTime;
+    unsigned long long steps;
+    unsigned long long events;
+    double stepsPerSecond;
+    double eventsPerSecond;
+
+    std::chrono::high_resolution_clock::time_point start;
+};
+
+//----------------------------------------------------------------------------
+void printUsage(const char *executable)
+{
+    std::cerr << "Usage: " << executable << " [--jobs N] [--cores 0,1,...] [--output-dir DIR] [--dataset DIR]"
+        << " -- command [args] -- [recordings]" << std::endl;
+    std::cerr << "\t{input} and {name} in command are replaced by the recording's absolute path and name" << std::endl;
+    std::cerr << "\tEach worker runs in DIR/{name}, with its output logged to DIR/{name}/log.txt" << std::endl;
+}
+//----------------------------------------------------------------------------
+std::vector<int> parseCores(const std::string &cores)
+{
+    std::vector<int> parsed;
+    std::stringstream coreStream(cores);
+    std::string core;
+    while(std::getline(coreStream, core, ',')) {
+        parsed.push_back(std::stoi(core));
+    }
+    return parsed;
+}
+//----------------------------------------------------------------------------
+std::string getAbsolutePath(const std::string &path)
+{
+    char absolutePath[PATH_MAX];
+    if(realpath(path.c_str(), absolutePath) == nullptr) {
+        throw std::runtime_error("Cannot find '" + path + "'");
+    }
+    return absolutePath;
+}
+//----------------------------------------------------------------------------
+std::string getName(const std::string &path)
+{
+    // Strip directory
+    const size_t slash = path.find_last_of('/');
+    std::string name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+
+    // Strip extension
+    const size_t dot = name.find_last_of('.');
+    return (dot == std::string::npos) ? name : name.substr(0, dot);
+}
+//----------------------------------------------------------------------------
+//! Condition a recording belongs to i.e. its name without trailing trial number
+std::string getCondition(const std::string &name)
+{
+    const size_t underscore = name.find_last_of('_');
+    return (underscore == std::string::npos) ? name : name.substr(0, underscore);
+}
+//----------------------------------------------------------------------------
+void addDatasetRecordings(const std::string &datasetDirectory, std::vector<std::string> &recordings)
+{
+    DIR *dir = opendir(datasetDirectory.c_str());
+    if(dir == nullptr) {
+        throw std::runtime_error("Cannot open dataset directory '" + datasetDirectory + "'");
+    }
+
+    // Add all spike files in directory
+    std::vector<std::string> datasetRecordings;
+    while(dirent *entry = readdir(dir)) {
+        const std::string filename = entry->d_name;
+        if(filename.size() > 7 && filename.compare(filename.size() - 7, 7, ".spikes") == 0) {
+            datasetRecordings.push_back(datasetDirectory + "/" + filename);
+        }
+    }
+    closedir(dir);
+
+    // Sort so jobs are issued in a predictable order
+    std::sort(datasetRecordings.begin(), datasetRecordings.end());
+    recordings.insert(recordings.end(), datasetRecordings.cbegin(), datasetRecordings.cend());
+}
+//----------------------------------------------------------------------------
+std::string substitute(std::string argument, const Job &job)
+{
+    const std::pair<std::string, std::string> replacements[] = {{"{input}", job.input}, {"{name}", job.name}};
+    for(const auto &r : replacements) {
+        for(size_t pos = argument.find(r.first); pos != std::string::npos; pos = argument.find(r.first, pos)) {
+            argument.replace(pos, r.first.size(), r.second);
+            pos += r.second.size();
+        }
+    }
+    return argument;
+}
+//----------------------------------------------------------------------------
+void launch(Job &job, int core, const std::vector<std::string> &command, const std::string &outputDirectory)
+{
+    // Create working directory for job
+    const std::string jobDirectory = outputDirectory + "/" + job.name;
+    mkdir(jobDirectory.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+
+    // Build argument vector before forking
+    std::vector<std::string> arguments;
+    std::transform(command.cbegin(), command.cend(), std::back_inserter(arguments),
+                   [&job](const std::string &a){ return substitute(a, job); });
+
+    std::vector<char*> argv;
+    for(auto &a : arguments) {
+        argv.push_back(&a[0]);
+    }
+    argv.push_back(nullptr);
+
+    job.core = core;
+    job.start = std::chrono::high_resolution_clock::now();
+    job.pid = fork();
+    if(job.pid < 0) {
+        throw std::runtime_error("Cannot fork worker process");
+    }
+    // Worker process
+    else if(job.pid == 0) {
+        // Pin to core
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(core, &cpuSet);
+        if(sched_setaffinity(0, sizeof(cpu_set_t), &cpuSet) != 0) {
+            std::cerr << "Cannot pin worker to core " << core << std::endl;
+        }
+
+        // Run in job directory so any files worker writes don't collide
+        if(chdir(jobDirectory.c_str()) != 0) {
+            _exit(126);
+        }
+
+        // Redirect stdout and stderr to log
+        const int log = open("log.txt", O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+        if(log >= 0) {
+            dup2(log, STDOUT_FILENO);
+            dup2(log, STDERR_FILENO);
+            close(log);
+        }
+
+        execvp(argv[0], argv.data());
+        _exit(127);
+    }
+}
+//----------------------------------------------------------------------------
+//! Read the final 'Batch:' statistics line written by the worker from its log
+void readStats(Job &job, const std::string &outputDirectory)
+{
+    std::ifstream log(outputDirectory + "/" + job.name + "/log.txt");
+    std::string line;
+    std::string stats;
+    while(std::getline(log, line)) {
+        if(line.compare(0, 6, "Batch:") == 0) {
+            stats = line;
+        }
+    }
+
+    // Format is 'Batch: <steps> steps, <events> events, <seconds> s, <steps/s> steps/s, <events/s> events/s'
+    if(!stats.empty()) {
+        std::string label;
+        double seconds;
+        std::stringstream statsStream(stats.substr(6));
+        statsStream >> job.steps >> label >> job.events >> label >> seconds >> label
+            >> job.stepsPerSecond >> label >> job.eventsPerSecond;
+    }
+}
+}   // Anonymous namespace
+
+int main(int argc, char *argv[])
+{
+    unsigned int numJobs = 0;
+    std::vector<int> cores;
+    std::string outputDirectory = "batch_output";
+    std::vector<std::string> recordings;
+    std::vector<std::string> command;
+
+    // Parse driver options, command and recordings
+    int a = 1;
+    for(; a < argc && strcmp(argv[a], "--") != 0; a++) {
+        if(strcmp(argv[a], "--jobs") == 0 && (a + 1) < argc) {
+            numJobs = std::atoi(argv[++a]);
+        }
+        else if(strcmp(argv[a], "--cores") == 0 && (a + 1) < argc) {
+            cores = parseCores(argv[++a]);
+        }
+        else if(strcmp(argv[a], "--output-dir") == 0 && (a + 1) < argc) {
+            outputDirectory = argv[++a];
+        }
+        else if(strcmp(argv[a], "--dataset") == 0 && (a + 1) < argc) {
+            addDatasetRecordings(argv[++a], recordings);
+        }
+        else {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    for(a++; a < argc && strcmp(argv[a], "--") != 0; a++) {
+        command.push_back(argv[a]);
+    }
+    for(a++; a < argc; a++) {
+        recordings.push_back(argv[a]);
+    }
+
+    if(command.empty() || recordings.empty()) {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // If no cores are specified, use all of them
+    if(cores.empty()) {
+        const unsigned int numCores = std::max(1u, std::thread::hardware_concurrency());
+        for(unsigned int c = 0; c < numCores; c++) {
+            cores.push_back(c);
+        }
+    }
+
+    // By default, run one worker per core
+    if(numJobs == 0 || numJobs > cores.size()) {
+        numJobs = cores.size();
+    }
+
+    // Make command executable absolute as workers run in their own directory
+    if(command[0].find('/') != std::string::npos) {
+        command[0] = getAbsolutePath(command[0]);
+    }
+
+    // Create jobs
+    std::vector<Job> jobs;
+    for(const auto &r : recordings) {
+        jobs.emplace_back(getAbsolutePath(r), getName(r));
+    }
+
+    mkdir(outputDirectory.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+    outputDirectory = getAbsolutePath(outputDirectory);
+
+    std::cout << "Processing " << jobs.size() << " recordings with " << numJobs << " workers" << std::endl;
+
+    // Fan jobs out over workers, launching a new job on each core as soon as it becomes free
+    std::vector<int> freeCores(cores.cbegin(), cores.cbegin() + numJobs);
+    std::map<pid_t, size_t> running;
+    size_t nextJob = 0;
+    const auto start = std::chrono::high_resolution_clock::now();
+    while(nextJob < jobs.size() || !running.empty()) {
+        // Launch jobs on all free cores
+        while(nextJob < jobs.size() && !freeCores.empty()) {
+            launch(jobs[nextJob], freeCores.back(), command, outputDirectory);
+            running.emplace(jobs[nextJob].pid, nextJob);
+            freeCores.pop_back();
+            nextJob++;
+        }
+
+        // Wait for any worker to exit
+        int status;
+        const pid_t pid = waitpid(-1, &status, 0);
+        if(pid < 0) {
+            throw std::runtime_error("waitpid failed");
+        }
+
+        // Record result and free core
+        const auto r = running.find(pid);
+        if(r != running.end()) {
+            Job &job = jobs[r->second];
+            job.wallTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - job.start).count();
+            job.exitStatus = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+            readStats(job, outputDirectory);
+            std::cout << "\t" << job.name << " finished on core " << job.core << " in " << job.wallTime << "s" << std::endl;
+
+            freeCores.push_back(job.core);
+            running.erase(r);
+        }
+    }
+    const double totalTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+    // Write per-recording table to stdout and CSV
+    std::ofstream summary(outputDirectory + "/summary.csv");
+    summary << "Recording, Core, Exit status, Wall time [s], Steps, Events, Steps/s, Events/s" << std::endl;
+    std::cout << std::endl << std::left << std::setw(20) << "Recording" << std::right << std::setw(6) << "Core"
+        << std::setw(8) << "Status" << std::setw(12) << "Wall [s]" << std::setw(14) << "Steps/s" << std::setw(14) << "Events/s" << std::endl;
+
+    double totalWorkerTime = 0.0;
+    std::map<std::string, std::vector<const Job*>> conditions;
+    for(const auto &job : jobs) {
+        summary << job.name << "," << job.core << "," << job.exitStatus << "," << job.wallTime << ","
+            << job.steps << "," << job.events << "," << job.stepsPerSecond << "," << job.eventsPerSecond << std::endl;
+        std::cout << std::left << std::setw(20) << job.name << std::right << std::setw(6) << job.core
+            << std::setw(8) << job.exitStatus << std::setw(12) << job.wallTime
+            << std::setw(14) << job.stepsPerSecond << std::setw(14) << job.eventsPerSecond << std::endl;
+
+        totalWorkerTime += job.wallTime;
+        conditions[getCondition(job.name)].push_back(&job);
+    }
+
+    // Aggregate recordings by condition
+    std::cout << std::endl << std::left << std::setw(20) << "Condition" << std::right << std::setw(6) << "N"
+        << std::setw(12) << "Wall [s]" << std::setw(14) << "Steps/s" << std::setw(14) << "Events/s" << std::endl;
+    for(const auto &c : conditions) {
+        double wallTime = 0.0;
+        double stepsPerSecond = 0.0;
+        double eventsPerSecond = 0.0;
+        for(const auto *job : c.second) {
+            wallTime += job->wallTime;
+            stepsPerSecond += job->stepsPerSecond;
+            eventsPerSecond += job->eventsPerSecond;
+        }
+
+        const double n = (double)c.second.size();
+        std::cout << std::left << std::setw(20) << c.first << std::right << std::setw(6) << c.second.size()
+            << std::setw(12) << wallTime / n << std::setw(14) << stepsPerSecond / n << std::setw(14) << eventsPerSecond / n << std::endl;
+    }
+
+    std::cout << std::endl << "Processed " << jobs.size() << " recordings in " << totalTime << "s ("
+        << totalWorkerTime / totalTime << "x speedup over serial)" << std::endl;
+
+    // Fail if any worker did
+    const bool allSucceeded = std::all_of(jobs.cbegin(), jobs.cend(),
+                                          [](const Job &j){ return j.exitStatus == 0; });
+    return allSucceeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
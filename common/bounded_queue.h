@@ -0,0 +1,105 @@
+#pragma once
+
+// Standard C++ includes
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+// Standard C includes
+#include <cstddef>
+
+//----------------------------------------------------------------------------
+// BoundedQueue
+//----------------------------------------------------------------------------
+//! Thread-safe FIFO queue holding at most capacity items. Producers wait
+//! while it is full and consumers wait while it is empty, so a fast producer
+//! can only run a fixed distance ahead of a slow consumer. Closing the queue
+//! wakes everyone: pushes fail from then on and pops fail once it's drained.
+template<typename T>
+class BoundedQueue
+{
+public:
+    BoundedQueue(size_t capacity) : m_Capacity(capacity), m_Closed(false)
+    {
+    }
+
+    //------------------------------------------------------------------------
+    // Public API
+    //------------------------------------------------------------------------
+    //! Wait for space and add item to back of queue, returning false if queue has been closed
+    bool push(T item)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_NotFullCondition.wait(lock, [this](){ return m_Closed || m_Items.size() < m_Capacity; });
+            if(m_Closed) {
+                return false;
+            }
+            m_Items.push_back(std::move(item));
+        }
+        m_NotEmptyCondition.notify_one();
+        return true;
+    }
+
+    //! Wait for an item and remove it from front of queue, returning false if queue has been closed and is empty
+    bool pop(T &item)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_NotEmptyCondition.wait(lock, [this](){ return m_Closed || !m_Items.empty(); });
+            if(m_Items.empty()) {
+                return false;
+            }
+            item = std::move(m_Items.front());
+            m_Items.pop_front();
+        }
+        m_NotFullCondition.notify_one();
+        return true;
+    }
+
+    //! If an item is available, remove it from front of queue and return true
+    bool tryPop(T &item)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if(m_Items.empty()) {
+                return false;
+            }
+            item = std::move(m_Items.front());
+            m_Items.pop_front();
+        }
+        m_NotFullCondition.notify_one();
+        return true;
+    }
+
+    //! Close queue, waking all waiting producers and consumers
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Closed = true;
+        }
+        m_NotFullCondition.notify_all();
+        m_NotEmptyCondition.notify_all();
+    }
+
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_Items.size();
+    }
+
+    size_t getCapacity() const{ return m_Capacity; }
+
+private:
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    const size_t m_Capacity;
+
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_NotFullCondition;
+    std::condition_variable m_NotEmptyCondition;
+    std::deque<T> m_Items;
+    bool m_Closed;
+};
@@ -0,0 +1,210 @@
+#pragma once
+
+// Standard C++ includes
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+// Standard C includes
+#include <cerrno>
+#include <cstring>
+
+// POSIX includes
+#include <sys/stat.h>
+
+// OpenCV includes
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgcodecs/imgcodecs.hpp>
+
+//----------------------------------------------------------------------------
+// DebugWriter
+//----------------------------------------------------------------------------
+//! Writes debug images, CSV files and text files into a directory on a
+//! background thread so encoding and disk IO stay out of the caller's loop.
+//! Images are copied when queued so callers can keep reusing their buffers.
+//! Each caller keeps the time of its own last dump and asks isDumpDue before
+//! queuing, which limits how often it dumps; if the writer still falls behind,
+//! files are dropped rather than letting the queue grow without bound.
+class DebugWriter
+{
+public:
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    DebugWriter(const std::string &directory, double minIntervalMs, size_t maxQueued = 64)
+    :   m_Directory(directory), m_MinInterval(minIntervalMs), m_MaxQueued(maxQueued), m_NumDropped(0), m_Quit(false)
+    {
+        // Create directory if it doesn't already exist
+        if(mkdir(m_Directory.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH) != 0 && errno != EEXIST) {
+            throw std::runtime_error("Cannot create debug directory '" + m_Directory + "': " + strerror(errno));
+        }
+        if(m_Directory.back() != '/') {
+            m_Directory += '/';
+        }
+
+        m_Thread = std::thread(&DebugWriter::writerThreadHandler, this);
+    }
+
+    ~DebugWriter()
+    {
+        // Signal writer thread to finish once queue is empty
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Quit = true;
+        }
+        m_Condition.notify_one();
+        m_Thread.join();
+
+        if(m_NumDropped > 0) {
+            std::cout << "Debug writer dropped " << m_NumDropped << " files" << std::endl;
+        }
+    }
+
+    //------------------------------------------------------------------------
+    // Public API
+    //------------------------------------------------------------------------
+    //! If minimum interval has passed since lastDump, update it to now and return true
+    bool isDumpDue(TimePoint &lastDump) const
+    {
+        const TimePoint now = std::chrono::steady_clock::now();
+        if(lastDump != TimePoint() && std::chrono::duration<double, std::milli>(now - lastDump) < m_MinInterval) {
+            return false;
+        }
+
+        lastDump = now;
+        return true;
+    }
+
+    //! Queue image to be written in format given by filename's extension
+    void writeImage(const std::string &filename, const cv::Mat &image)
+    {
+        push(Job{JobType::Image, filename, image.clone(), std::string()});
+    }
+
+    //! Queue single-channel matrix to be written as comma-separated rows
+    void writeCSV(const std::string &filename, const cv::Mat &matrix)
+    {
+        push(Job{JobType::CSV, filename, matrix.clone(), std::string()});
+    }
+
+    //! Queue text to be written verbatim
+    void writeText(const std::string &filename, const std::string &text)
+    {
+        push(Job{JobType::Text, filename, cv::Mat(), text});
+    }
+
+private:
+    //------------------------------------------------------------------------
+    // Enumerations
+    //------------------------------------------------------------------------
+    enum class JobType
+    {
+        Image,
+        CSV,
+        Text,
+    };
+
+    //------------------------------------------------------------------------
+    // Job
+    //------------------------------------------------------------------------
+    struct Job
+    {
+        JobType type;
+        std::string filename;
+        cv::Mat matrix;
+        std::string text;
+    };
+
+    //------------------------------------------------------------------------
+    // Private methods
+    //------------------------------------------------------------------------
+    void push(Job &&job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if(m_Queue.size() >= m_MaxQueued) {
+                m_NumDropped++;
+                return;
+            }
+            m_Queue.push_back(std::move(job));
+        }
+        m_Condition.notify_one();
+    }
+
+    void writerThreadHandler()
+    {
+        while(true) {
+            // Wait for a job or for quit signal
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Condition.wait(lock, [this](){ return m_Quit || !m_Queue.empty(); });
+
+                // Only quit once all queued files are written
+                if(m_Queue.empty()) {
+                    return;
+                }
+
+                job = std::move(m_Queue.front());
+                m_Queue.pop_front();
+            }
+
+            write(job);
+        }
+    }
+
+    void write(const Job &job) const
+    {
+        const std::string path = m_Directory + job.filename;
+        if(job.type == JobType::Image) {
+            if(!cv::imwrite(path, job.matrix)) {
+                std::cerr << "Failed to write '" << path << "'" << std::endl;
+            }
+        }
+        else {
+            std::ofstream file(path, std::ios::out | std::ios::trunc);
+            if(job.type == JobType::Text) {
+                file << job.text;
+            }
+            else {
+                cv::Mat matrix;
+                job.matrix.convertTo(matrix, CV_64F);
+                for(int i = 0; i < matrix.rows; i++) {
+                    for(int j = 0; j < matrix.cols; j++) {
+                        if(j > 0) {
+                            file << ", ";
+                        }
+                        file << matrix.at<double>(i, j);
+                    }
+                    file << "\n";
+                }
+            }
+
+            if(!file) {
+                std::cerr << "Failed to write '" << path << "'" << std::endl;
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    std::string m_Directory;
+    const std::chrono::duration<double, std::milli> m_MinInterval;
+    const size_t m_MaxQueued;
+
+    // Written only with mutex held but read by destructor after writer thread has exited
+    size_t m_NumDropped;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+    std::deque<Job> m_Queue;
+    bool m_Quit;
+
+    std::thread m_Thread;
+};
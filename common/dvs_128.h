@@ -1,8 +1,14 @@
 #pragma once
 
+// Standard C++ includes
+#include <atomic>
+
 // Lib CAER includes
 #include <libcaercpp/devices/dvs128.hpp>
 
+// Common example includes
+#include "realtime.h"
+
 //----------------------------------------------------------------------------
 // DVS128
 //----------------------------------------------------------------------------
@@ -20,7 +26,8 @@ public:
     };
 
     DVS128(Polarity polarity, uint16_t deviceID = 1)
-        : m_DVS128Handle(deviceID, 0, 0, ""), m_Polarity(polarity), m_Width(0), m_Height(0)
+        : m_DVS128Handle(deviceID, 0, 0, ""), m_Polarity(polarity), m_Width(0), m_Height(0),
+          m_AcquisitionCore(-1), m_AcquisitionPriority(0), m_AcquisitionConfigured(false)
     {
         // Let's take a look at the information we have on the device.
         auto info = m_DVS128Handle.infoGet();
@@ -49,9 +56,23 @@ public:
     //------------------------------------------------------------------------
     // Public API
     //------------------------------------------------------------------------
+    //! Pin and prioritise libcaer's acquisition thread once it starts delivering data
+    void setAcquisitionThread(int core, int priority)
+    {
+        m_AcquisitionCore = core;
+        m_AcquisitionPriority = priority;
+    }
+
     void start()
     {
-        m_DVS128Handle.dataStart();
+        // If acquisition thread should be configured, get libcaer to notify us from it
+        if(m_AcquisitionCore >= 0 || m_AcquisitionPriority > 0) {
+            m_AcquisitionConfigured = false;
+            m_DVS128Handle.dataStart(&onDataNotifyIncrease, nullptr, this, nullptr, nullptr);
+        }
+        else {
+            m_DVS128Handle.dataStart();
+        }
     }
 
     void stop()
@@ -59,6 +80,11 @@ public:
         m_DVS128Handle.dataStop();
     }
 
+    bool isFinished() const
+    {
+        return false;
+    }
+
     void readEvents(unsigned int &spikeCount, unsigned int *spikes)
     {
         // Zero spike count
@@ -112,6 +138,18 @@ public:
     }
 
 private:
+    //------------------------------------------------------------------------
+    // Static methods
+    //------------------------------------------------------------------------
+    //! Called by libcaer on its acquisition thread whenever new data is available
+    static void onDataNotifyIncrease(void *ptr)
+    {
+        DVS128 *dvs = reinterpret_cast<DVS128*>(ptr);
+        if(!dvs->m_AcquisitionConfigured.exchange(true)) {
+            Realtime::configureThread(pthread_self(), dvs->m_AcquisitionCore, dvs->m_AcquisitionPriority, "input");
+        }
+    }
+
     //------------------------------------------------------------------------
     // Members
     //------------------------------------------------------------------------
@@ -119,4 +157,9 @@ private:
     const Polarity m_Polarity;
     unsigned int m_Width;
     unsigned int m_Height;
+
+    // Core and SCHED_FIFO priority to apply to acquisition thread
+    int m_AcquisitionCore;
+    int m_AcquisitionPriority;
+    std::atomic<bool> m_AcquisitionConfigured;
 };
\ No newline at end of file
@@ -0,0 +1,198 @@
+#pragma once
+
+// Standard C++ includes
+#include <algorithm>
+#include <vector>
+
+// Standard C includes
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+
+// Common example includes
+#include "opencv_dvs.h"
+
+//----------------------------------------------------------------------------
+// DVSEmulator
+//----------------------------------------------------------------------------
+//! Turns the down-sampled frames produced by OpenCVDVSCPU into sparse events like
+//! those of a real DVS. Each pixel keeps a reference log-intensity and, whenever a
+//! new frame moves it by more than the contrast threshold, one event is emitted per
+//! threshold crossed and the reference moves by that many thresholds. If interpolation
+//! is enabled, the log-intensity is assumed to have changed linearly over the last
+//! frame interval and, rather than all arriving on the frame's timestep, events are
+//! spread over the following interval in the order their thresholds would have been crossed.
+//! Implements the same interface as the other event sources (see EventSource).
+class DVSEmulator
+{
+public:
+    //------------------------------------------------------------------------
+    // Enumerations
+    //------------------------------------------------------------------------
+    enum class Polarity
+    {
+        On,
+        Off,
+        Both,
+    };
+
+    DVSEmulator(OpenCVDVSCPU &dvs, unsigned int resolution, float threshold,
+                Polarity polarity = Polarity::Both, bool interpolate = true, unsigned int maxSpreadTimesteps = 100)
+        : m_DVS(dvs), m_Resolution(resolution), m_Threshold(threshold), m_Polarity(polarity), m_Interpolate(interpolate),
+          m_Buckets(std::max(1u, maxSpreadTimesteps)), m_CurrentBucket(0), m_Timestep(0), m_LastFrameTimestep(0),
+          m_FrameInterval(1), m_HasReference(false), m_NumEvents(0), m_NumDroppedEvents(0),
+          m_Reference(resolution * resolution, 0.0f), m_LastScheduledTimestep(resolution * resolution, -1)
+    {
+    }
+
+    //------------------------------------------------------------------------
+    // Public API
+    //------------------------------------------------------------------------
+    void start()
+    {
+    }
+
+    void stop()
+    {
+    }
+
+    bool isFinished() const
+    {
+        return m_DVS.isFinished();
+    }
+
+    //! Process any new frame and return events due this timestep
+    void readEvents(unsigned int &spikeCount, unsigned int *spikes)
+    {
+        // Update underlying DVS and, if there's a new frame, convert it to events
+        m_DVS.update(m_Timestep);
+        if(m_DVS.isNewFrame()) {
+            processFrame(m_DVS.getDownsampledFrame(m_Timestep));
+        }
+
+        // Copy out events due this timestep and advance
+        auto &bucket = m_Buckets[m_CurrentBucket];
+        spikeCount = (unsigned int)bucket.size();
+        std::copy(bucket.cbegin(), bucket.cend(), spikes);
+        bucket.clear();
+
+        m_CurrentBucket = (m_CurrentBucket + 1) % m_Buckets.size();
+        m_Timestep++;
+    }
+
+    unsigned int getWidth() const
+    {
+        return m_Resolution;
+    }
+
+    unsigned int getHeight() const
+    {
+        return m_Resolution;
+    }
+
+    unsigned long long getNumEvents() const{ return m_NumEvents; }
+    unsigned long long getNumDroppedEvents() const{ return m_NumDroppedEvents; }
+
+private:
+    //------------------------------------------------------------------------
+    // Private methods
+    //------------------------------------------------------------------------
+    void processFrame(const cv::Mat &frame)
+    {
+        assert(frame.isContinuous());
+        const float *luminance = reinterpret_cast<const float*>(frame.data);
+        const unsigned int numPixels = m_Resolution * m_Resolution;
+
+        // If this is the first frame, initialise reference without emitting events
+        if(!m_HasReference) {
+            for(unsigned int i = 0; i < numPixels; i++) {
+                m_Reference[i] = getLogIntensity(luminance[i]);
+            }
+            m_HasReference = true;
+            m_LastFrameTimestep = m_Timestep;
+            return;
+        }
+
+        // Events are spread over the interval since the previous frame
+        m_FrameInterval = std::max(1u, std::min(m_Timestep - m_LastFrameTimestep, (unsigned int)m_Buckets.size()));
+        m_LastFrameTimestep = m_Timestep;
+
+        for(unsigned int i = 0; i < numPixels; i++) {
+            const float delta = getLogIntensity(luminance[i]) - m_Reference[i];
+            const unsigned int numCrossings = (unsigned int)(std::fabs(delta) / m_Threshold);
+            if(numCrossings == 0) {
+                continue;
+            }
+
+            // Move reference by the thresholds crossed
+            const bool on = (delta > 0.0f);
+            m_Reference[i] += on ? ((float)numCrossings * m_Threshold) : -((float)numCrossings * m_Threshold);
+
+            // Skip polarities we're not interested in
+            if((on && m_Polarity == Polarity::Off) || (!on && m_Polarity == Polarity::On)) {
+                continue;
+            }
+
+            // Schedule one event per crossing
+            for(unsigned int c = 1; c <= numCrossings; c++) {
+                // Calculate timestep offset at which this threshold is crossed, making sure each pixel
+                // fires at most once per timestep as spike sources can't fire twice - events scheduled
+                // by previous frames may not have been emitted yet so this is checked in absolute timesteps
+                int64_t offset = m_Interpolate
+                    ? (int64_t)(((float)c * m_Threshold / std::fabs(delta)) * (float)m_FrameInterval) - 1
+                    : 0;
+                offset = std::max(offset, std::max<int64_t>(0, m_LastScheduledTimestep[i] + 1 - (int64_t)m_Timestep));
+
+                // If this would wrap around event ring, drop it
+                if(offset >= (int64_t)m_Buckets.size()) {
+                    m_NumDroppedEvents += (numCrossings - c + 1);
+                    break;
+                }
+
+                m_Buckets[(m_CurrentBucket + offset) % m_Buckets.size()].push_back(i);
+                m_LastScheduledTimestep[i] = (int64_t)m_Timestep + offset;
+                m_NumEvents++;
+            }
+        }
+    }
+
+    static float getLogIntensity(float luminance)
+    {
+        // Offset avoids log(0) and mimics the dark current of a real photoreceptor
+        return std::log(luminance + (1.0f / 255.0f));
+    }
+
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    OpenCVDVSCPU &m_DVS;
+
+    const unsigned int m_Resolution;
+
+    // Log-intensity change required to emit an event
+    const float m_Threshold;
+
+    const Polarity m_Polarity;
+
+    // Should events be spread over frame interval
+    const bool m_Interpolate;
+
+    // Ring of future timesteps' events
+    std::vector<std::vector<unsigned int>> m_Buckets;
+    unsigned int m_CurrentBucket;
+
+    unsigned int m_Timestep;
+    unsigned int m_LastFrameTimestep;
+    unsigned int m_FrameInterval;
+
+    bool m_HasReference;
+
+    unsigned long long m_NumEvents;
+    unsigned long long m_NumDroppedEvents;
+
+    // Per-pixel reference log-intensity
+    std::vector<float> m_Reference;
+
+    // Timestep of the last event scheduled for each pixel (-1 if none has been)
+    std::vector<int64_t> m_LastScheduledTimestep;
+};
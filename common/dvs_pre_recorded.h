@@ -2,9 +2,11 @@
 
 // Standard C++ includes
 #include <fstream>
+#include <sstream>
 #include <string>
 
 // Standard C includes
+#include <cassert>
 #include <cstdlib>
 
 //----------------------------------------------------------------------------
@@ -47,6 +49,12 @@ public:
     {
     }
 
+    bool isFinished() const
+    {
+        // **NOTE** getline empties line when it reaches the end of the stream
+        return m_NextLine.empty();
+    }
+
     void readEvents(unsigned int &spikeCount, unsigned int *spikes)
     {
         // Zero spike count
@@ -54,7 +62,7 @@ public:
 
         // Loop through spikes in frame
         std::string cell;
-        do
+        while(!m_NextLine.empty())
         {
             // Create string stream from line
             std::stringstream lineStream(m_NextLine);
@@ -102,7 +110,6 @@ public:
             // Read next spike into buffer
             std::getline(m_SpikeStream, m_NextLine);
         }
-        while(m_SpikeStream.good());
 
         // Update frame start timestamp for next frame
         m_FrameStartTimestamp += m_FrameDurationUs;
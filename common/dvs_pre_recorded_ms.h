@@ -1,11 +1,14 @@
 #pragma once
 
 // Standard C++ includes
+#include <algorithm>
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <vector>
 
 // Standard C includes
+#include <cassert>
 #include <cstdlib>
 
 //----------------------------------------------------------------------------
@@ -34,6 +37,11 @@ public:
     {
     }
 
+    bool isFinished() const
+    {
+        return !m_MoreSpikes;
+    }
+
     void readEvents(unsigned int &spikeCount, unsigned int *spikes)
     {
         // Zero spike count
@@ -0,0 +1,237 @@
+#pragma once
+
+// Standard C++ includes
+#include <stdexcept>
+#include <string>
+
+// Standard C includes
+#include <cstring>
+
+// Common example includes
+#include "dvs_pre_recorded.h"
+#include "dvs_pre_recorded_ms.h"
+
+#ifdef DVS
+    #include "dvs_128.h"
+#endif
+
+//----------------------------------------------------------------------------
+// EventSource
+//----------------------------------------------------------------------------
+//! An event source is any class providing:
+//!     void start();
+//!     void stop();
+//!     bool isFinished() const;
+//!     void readEvents(unsigned int &spikeCount, unsigned int *spikes);
+//!     unsigned int getWidth() const;
+//!     unsigned int getHeight() const;
+//! Rather than hiding these behind virtual functions, examples write their
+//! main loop as a function object with a templated operator() and
+//! EventSource::run instantiates it for the source selected at runtime
+namespace EventSource
+{
+//----------------------------------------------------------------------------
+// Enumerations
+//----------------------------------------------------------------------------
+enum class Polarity
+{
+    On,
+    Off,
+    Both,
+};
+
+//----------------------------------------------------------------------------
+// EventSource::Config
+//----------------------------------------------------------------------------
+//! Runtime description of which event source to use
+struct Config
+{
+    Config() : polarity(Polarity::On), csv(false), flipY(false), dt(1.0), outputWidth(0), outputHeight(0),
+        inputCore(-1), inputPriority(0)
+    {
+    }
+
+    // If no filename is specified, a live DVS is used
+    std::string filename;
+
+    // Which polarity events should be passed through
+    Polarity polarity;
+
+    // Is file in (timestamp, x, y, polarity) CSV format rather than one line per timestep
+    bool csv;
+
+    // Should y coordinate of CSV events be flipped
+    bool flipY;
+
+    // Simulation timestep, used to bin CSV events
+    double dt;
+
+    // If non-zero, events are downsampled to this resolution
+    unsigned int outputWidth;
+    unsigned int outputHeight;
+
+    // Core and SCHED_FIFO priority for live DVS acquisition thread (see Realtime::Config)
+    int inputCore;
+    int inputPriority;
+};
+
+//----------------------------------------------------------------------------
+// EventSource::Downsampled
+//----------------------------------------------------------------------------
+//! Wraps another event source and rescales its addresses to a lower resolution
+template<typename Source>
+class Downsampled
+{
+public:
+    Downsampled(Source &source, unsigned int width, unsigned int height)
+        : m_Source(source), m_Width(width), m_Height(height)
+    {
+    }
+
+    //------------------------------------------------------------------------
+    // Public API
+    //------------------------------------------------------------------------
+    void start()
+    {
+        m_Source.start();
+    }
+
+    void stop()
+    {
+        m_Source.stop();
+    }
+
+    bool isFinished() const
+    {
+        return m_Source.isFinished();
+    }
+
+    void readEvents(unsigned int &spikeCount, unsigned int *spikes)
+    {
+        // Read events at source resolution
+        m_Source.readEvents(spikeCount, spikes);
+
+        // Rescale each address in place
+        const unsigned int sourceWidth = m_Source.getWidth();
+        const unsigned int sourceHeight = m_Source.getHeight();
+        for(unsigned int s = 0; s < spikeCount; s++) {
+            const unsigned int x = (spikes[s] % sourceWidth) * m_Width / sourceWidth;
+            const unsigned int y = (spikes[s] / sourceWidth) * m_Height / sourceHeight;
+            spikes[s] = x + (y * m_Width);
+        }
+    }
+
+    unsigned int getWidth() const
+    {
+        return m_Width;
+    }
+
+    unsigned int getHeight() const
+    {
+        return m_Height;
+    }
+
+private:
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    Source &m_Source;
+    const unsigned int m_Width;
+    const unsigned int m_Height;
+};
+
+//----------------------------------------------------------------------------
+// Functions
+//----------------------------------------------------------------------------
+//! Convert polarity to the equivalent enumeration of a specific source
+template<typename P>
+P convertPolarity(Polarity polarity)
+{
+    switch(polarity) {
+        case Polarity::On:
+            return P::On;
+        case Polarity::Off:
+            return P::Off;
+        default:
+            return P::Both;
+    }
+}
+
+//! If argv[i] is an event source option, apply it to config, advance i past
+//! any values it consumed and return true. Any non-option argument is the filename
+inline bool parseArg(Config &config, int &i, int argc, char *argv[])
+{
+    if(strcmp(argv[i], "--csv") == 0) {
+        config.csv = true;
+    }
+    else if(strcmp(argv[i], "--flip-y") == 0) {
+        config.flipY = true;
+    }
+    else if(strcmp(argv[i], "--polarity") == 0 && (i + 1) < argc) {
+        i++;
+        if(strcmp(argv[i], "on") == 0) {
+            config.polarity = Polarity::On;
+        }
+        else if(strcmp(argv[i], "off") == 0) {
+            config.polarity = Polarity::Off;
+        }
+        else if(strcmp(argv[i], "both") == 0) {
+            config.polarity = Polarity::Both;
+        }
+        else {
+            throw std::runtime_error("Unknown polarity '" + std::string(argv[i]) + "'");
+        }
+    }
+    else if(argv[i][0] != '-') {
+        config.filename = argv[i];
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+//! Start source, run loop (downsampling events if required) and stop source
+template<typename Source, typename Loop>
+void runSource(const Config &config, Source &source, Loop &loop)
+{
+    source.start();
+
+    if(config.outputWidth == 0 || config.outputHeight == 0
+        || (config.outputWidth == source.getWidth() && config.outputHeight == source.getHeight()))
+    {
+        loop(source);
+    }
+    else {
+        Downsampled<Source> downsampled(source, config.outputWidth, config.outputHeight);
+        loop(downsampled);
+    }
+
+    source.stop();
+}
+
+//! Create the event source described by config and pass it to loop
+template<typename Loop>
+void run(const Config &config, Loop &loop)
+{
+    // If no filename is specified, use live DVS
+    if(config.filename.empty()) {
+#ifdef DVS
+        DVS128 dvs(convertPolarity<DVS128::Polarity>(config.polarity));
+        dvs.setAcquisitionThread(config.inputCore, config.inputPriority);
+        runSource(config, dvs, loop);
+#else
+        throw std::runtime_error("No event file specified and live DVS support not built (build with DVS=1)");
+#endif
+    }
+    else if(config.csv) {
+        DVSPreRecorded dvs(config.filename.c_str(), convertPolarity<DVSPreRecorded::Polarity>(config.polarity),
+                           config.dt, config.flipY);
+        runSource(config, dvs, loop);
+    }
+    else {
+        DVSPreRecordedMs dvs(config.filename.c_str());
+        runSource(config, dvs, loop);
+    }
+}
+}   // namespace EventSource
@@ -0,0 +1,234 @@
+#pragma once
+
+// Standard C++ includes
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+// Standard C includes
+#include <cctype>
+#include <cmath>
+
+// OpenCV includes
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+// Common example includes
+#include "looming_stimulus.h"
+
+//----------------------------------------------------------------------------
+// FrameSource
+//----------------------------------------------------------------------------
+//! Interface for anything that produces colour (BGR) frames for OpenCVDVS
+class FrameSource
+{
+public:
+    virtual ~FrameSource()
+    {
+    }
+
+    //----------------------------------------------------------------------------
+    // Declared virtuals
+    //----------------------------------------------------------------------------
+    //! Read next frame into frame, returning false if source is exhausted
+    virtual bool readFrame(cv::Mat &frame) = 0;
+
+    virtual unsigned int getWidth() const = 0;
+    virtual unsigned int getHeight() const = 0;
+
+    //! Rate at which frames should be consumed if this source doesn't pace itself,
+    //! or zero if readFrame blocks until the next frame is available (e.g. a camera)
+    virtual double getFrameRate() const
+    {
+        return 0.0;
+    }
+};
+
+//----------------------------------------------------------------------------
+// VideoCaptureFrameSource
+//----------------------------------------------------------------------------
+//! Frame source reading from a camera device or video file using OpenCV
+class VideoCaptureFrameSource : public FrameSource
+{
+public:
+    VideoCaptureFrameSource(unsigned int device)
+        : m_Capture(device), m_FrameRate(0.0)
+    {
+        if(!m_Capture.isOpened()) {
+            throw std::runtime_error("Cannot open camera " + std::to_string(device));
+        }
+    }
+
+    VideoCaptureFrameSource(const std::string &filename)
+        : m_Capture(filename), m_FrameRate(0.0)
+    {
+        if(!m_Capture.isOpened()) {
+            throw std::runtime_error("Cannot open video file '" + filename + "'");
+        }
+
+        // Unlike cameras, files can be read as fast as we like so should be paced to their frame rate
+        m_FrameRate = m_Capture.get(CV_CAP_PROP_FPS);
+        if(m_FrameRate <= 0.0) {
+            m_FrameRate = 30.0;
+        }
+    }
+
+    //----------------------------------------------------------------------------
+    // FrameSource virtuals
+    //----------------------------------------------------------------------------
+    virtual bool readFrame(cv::Mat &frame) override
+    {
+        return m_Capture.read(frame);
+    }
+
+    virtual unsigned int getWidth() const override
+    {
+        return (unsigned int)m_Capture.get(CV_CAP_PROP_FRAME_WIDTH);
+    }
+
+    virtual unsigned int getHeight() const override
+    {
+        return (unsigned int)m_Capture.get(CV_CAP_PROP_FRAME_HEIGHT);
+    }
+
+    virtual double getFrameRate() const override
+    {
+        return m_FrameRate;
+    }
+
+private:
+    //----------------------------------------------------------------------------
+    // Members
+    //----------------------------------------------------------------------------
+    // VideoCapture::get isn't const
+    mutable cv::VideoCapture m_Capture;
+
+    double m_FrameRate;
+};
+
+//----------------------------------------------------------------------------
+// LoomingFrameSource
+//----------------------------------------------------------------------------
+//! Procedurally generated looming stimulus: a dark square approaching on a light background
+class LoomingFrameSource : public FrameSource
+{
+public:
+    LoomingFrameSource(const LoomingStimulus &stimulus = LoomingStimulus(),
+                       unsigned int width = 640, unsigned int height = 480, double frameRate = 30.0)
+        : m_Stimulus(stimulus), m_Width(width), m_Height(height), m_FrameRate(frameRate), m_Frame(0)
+    {
+    }
+
+    //----------------------------------------------------------------------------
+    // FrameSource virtuals
+    //----------------------------------------------------------------------------
+    virtual bool readFrame(cv::Mat &frame) override
+    {
+        frame.create(m_Height, m_Width, CV_8UC3);
+
+        // If object has collided, fill frame, otherwise draw centred square
+        const double halfSize = m_Stimulus.getHalfSize((double)m_Frame++ / m_FrameRate, m_Height);
+        if(std::isinf(halfSize)) {
+            frame.setTo(cv::Scalar::all(0));
+        }
+        else {
+            frame.setTo(cv::Scalar::all(255));
+
+            const int centreX = (int)m_Width / 2;
+            const int centreY = (int)m_Height / 2;
+            const int h = (int)std::min(halfSize, (double)m_Width);
+            cv::rectangle(frame, cv::Rect(centreX - h, centreY - h, 2 * h + 1, 2 * h + 1), cv::Scalar::all(0), CV_FILLED);
+        }
+        return true;
+    }
+
+    virtual unsigned int getWidth() const override{ return m_Width; }
+    virtual unsigned int getHeight() const override{ return m_Height; }
+    virtual double getFrameRate() const override{ return m_FrameRate; }
+
+    //----------------------------------------------------------------------------
+    // Public API
+    //----------------------------------------------------------------------------
+    const LoomingStimulus &getStimulus() const{ return m_Stimulus; }
+
+private:
+    //----------------------------------------------------------------------------
+    // Members
+    //----------------------------------------------------------------------------
+    const LoomingStimulus m_Stimulus;
+    const unsigned int m_Width;
+    const unsigned int m_Height;
+    const double m_FrameRate;
+
+    unsigned int m_Frame;
+};
+
+//----------------------------------------------------------------------------
+// TranslatingFrameSource
+//----------------------------------------------------------------------------
+//! Procedurally generated dark vertical bar sweeping horizontally across a light background
+class TranslatingFrameSource : public FrameSource
+{
+public:
+    TranslatingFrameSource(unsigned int width = 640, unsigned int height = 480, double frameRate = 30.0,
+                           unsigned int barWidth = 40, double speed = 320.0)
+        : m_Width(width), m_Height(height), m_FrameRate(frameRate), m_BarWidth(barWidth),
+          m_Speed(speed), m_Frame(0)
+    {
+    }
+
+    //----------------------------------------------------------------------------
+    // FrameSource virtuals
+    //----------------------------------------------------------------------------
+    virtual bool readFrame(cv::Mat &frame) override
+    {
+        frame.create(m_Height, m_Width, CV_8UC3);
+        frame.setTo(cv::Scalar::all(255));
+
+        // Calculate bar position [pixels], wrapping around frame
+        const double time = (double)m_Frame++ / m_FrameRate;
+        const int x = (int)std::fmod(time * m_Speed, (double)(m_Width + m_BarWidth)) - (int)m_BarWidth;
+        cv::rectangle(frame, cv::Rect(x, 0, m_BarWidth, m_Height), cv::Scalar::all(0), CV_FILLED);
+        return true;
+    }
+
+    virtual unsigned int getWidth() const override{ return m_Width; }
+    virtual unsigned int getHeight() const override{ return m_Height; }
+    virtual double getFrameRate() const override{ return m_FrameRate; }
+
+private:
+    //----------------------------------------------------------------------------
+    // Members
+    //----------------------------------------------------------------------------
+    const unsigned int m_Width;
+    const unsigned int m_Height;
+    const double m_FrameRate;
+    const unsigned int m_BarWidth;
+
+    // Speed bar moves across frame [pixels/s]
+    const double m_Speed;
+
+    unsigned int m_Frame;
+};
+
+//----------------------------------------------------------------------------
+// Functions
+//----------------------------------------------------------------------------
+//! Create frame source from command line specification: "looming" or "translating"
+//! for synthetic stimuli, a number for a camera device or anything else for a video file
+inline std::unique_ptr<FrameSource> createFrameSource(const std::string &spec)
+{
+    if(spec == "looming") {
+        return std::unique_ptr<FrameSource>(new LoomingFrameSource());
+    }
+    else if(spec == "translating") {
+        return std::unique_ptr<FrameSource>(new TranslatingFrameSource());
+    }
+    else if(!spec.empty() && std::all_of(spec.cbegin(), spec.cend(), ::isdigit)) {
+        return std::unique_ptr<FrameSource>(new VideoCaptureFrameSource(std::stoi(spec)));
+    }
+    else {
+        return std::unique_ptr<FrameSource>(new VideoCaptureFrameSource(spec));
+    }
+}
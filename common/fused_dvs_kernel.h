@@ -0,0 +1,123 @@
+#pragma once
+
+// Standard C++ includes
+#include <algorithm>
+#include <vector>
+
+// Standard C includes
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// SSE2 includes
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+//----------------------------------------------------------------------------
+// FusedDVSKernel
+//----------------------------------------------------------------------------
+//! Replaces the greyscale conversion, area downsampling and frame difference of
+//! OpenCVDVS with a single pass over the square BGR region of interest. Each band
+//! of input rows belonging to one output row is summed byte-wise into a 16-bit
+//! accumulator, then the channels of each output pixel's columns are reduced and
+//! converted to luminance (using the same weights as cv::cvtColor) only once per
+//! output pixel. The result matches cvtColor, convertTo and cv::resize with
+//! cv::INTER_AREA to within rounding when the input size is a multiple of the
+//! output resolution, and to within the fractional edge weights INTER_AREA uses otherwise.
+class FusedDVSKernel
+{
+public:
+    // Band accumulators are 16-bit so, at most, this many rows can be summed into one output row
+    static constexpr unsigned int maxBandRows = 65535 / 255;
+
+    FusedDVSKernel(unsigned int resolution) : m_Resolution(resolution)
+    {
+    }
+
+    //------------------------------------------------------------------------
+    // Public API
+    //------------------------------------------------------------------------
+    //! Downsample the size * size BGR image starting at bgr (with row stride in bytes)
+    //! into resolution * resolution luminance in [0, 1]. If previousLuminance is
+    //! provided, the (signed or absolute) difference from it is written to difference
+    void process(const uint8_t *bgr, size_t stride, unsigned int size, float *luminance,
+                 const float *previousLuminance, float *difference, bool absolute)
+    {
+        assert(size >= m_Resolution);
+        const unsigned int rowBytes = size * 3;
+        m_BandAccumulator.resize(rowBytes);
+
+        for(unsigned int yOut = 0; yOut < m_Resolution; yOut++) {
+            // Sum band of input rows belonging to this output row
+            const unsigned int yStart = (yOut * size) / m_Resolution;
+            const unsigned int yEnd = ((yOut + 1) * size) / m_Resolution;
+            assert((yEnd - yStart) <= maxBandRows);
+
+            std::fill(m_BandAccumulator.begin(), m_BandAccumulator.end(), 0);
+            for(unsigned int y = yStart; y < yEnd; y++) {
+                accumulateRow(bgr + (y * stride), m_BandAccumulator.data(), rowBytes);
+            }
+
+            // Loop through output pixels in row
+            for(unsigned int xOut = 0; xOut < m_Resolution; xOut++) {
+                const unsigned int xStart = (xOut * size) / m_Resolution;
+                const unsigned int xEnd = ((xOut + 1) * size) / m_Resolution;
+
+                // Sum channels of columns belonging to this output pixel
+                uint32_t b = 0;
+                uint32_t g = 0;
+                uint32_t r = 0;
+                const uint16_t *accumulator = &m_BandAccumulator[xStart * 3];
+                for(unsigned int x = xStart; x < xEnd; x++, accumulator += 3) {
+                    b += accumulator[0];
+                    g += accumulator[1];
+                    r += accumulator[2];
+                }
+
+                // Convert mean to luminance
+                const float scale = 1.0f / (255.0f * (float)((xEnd - xStart) * (yEnd - yStart)));
+                const float lum = ((0.114f * (float)b) + (0.587f * (float)g) + (0.299f * (float)r)) * scale;
+
+                const unsigned int i = xOut + (yOut * m_Resolution);
+                luminance[i] = lum;
+                if(previousLuminance != nullptr) {
+                    difference[i] = absolute ? std::fabs(lum - previousLuminance[i]) : (lum - previousLuminance[i]);
+                }
+            }
+        }
+    }
+
+private:
+    //------------------------------------------------------------------------
+    // Private static methods
+    //------------------------------------------------------------------------
+    static void accumulateRow(const uint8_t *row, uint16_t *accumulator, unsigned int numBytes)
+    {
+        unsigned int i = 0;
+#ifdef __SSE2__
+        // Widen 16 bytes at a time to 16-bit and add to accumulator
+        const __m128i zero = _mm_setzero_si128();
+        for(; (i + 16) <= numBytes; i += 16) {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&row[i]));
+            __m128i *lo = reinterpret_cast<__m128i*>(&accumulator[i]);
+            __m128i *hi = reinterpret_cast<__m128i*>(&accumulator[i + 8]);
+            _mm_storeu_si128(lo, _mm_add_epi16(_mm_loadu_si128(lo), _mm_unpacklo_epi8(bytes, zero)));
+            _mm_storeu_si128(hi, _mm_add_epi16(_mm_loadu_si128(hi), _mm_unpackhi_epi8(bytes, zero)));
+        }
+#endif
+        // Scalar fallback and remainder
+        for(; i < numBytes; i++) {
+            accumulator[i] += row[i];
+        }
+    }
+
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    const unsigned int m_Resolution;
+
+    // Byte-wise sums of the band of input rows currently being processed
+    std::vector<uint16_t> m_BandAccumulator;
+};
@@ -0,0 +1,163 @@
+#pragma once
+
+// Standard C++ includes
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+// Standard C includes
+#include <cmath>
+
+// Common example includes
+#include "looming_stimulus.h"
+
+//----------------------------------------------------------------------------
+// LatencyRecorder
+//----------------------------------------------------------------------------
+//! Records the timesteps and wall-clock times at which input frames arrive and a
+//! detector neuron spikes while being driven by a LoomingStimulus, and reports
+//! the distribution of detection latencies relative to each trial's collision and
+//! to the time its angular size crossed a threshold, along with processing time per input.
+//! Spikes within settleDuration seconds of each trial starting are caused by the
+//! transient as the previous trial's object is replaced (or the network starts up)
+//! rather than by the approach, so only spikes after this are counted as detections.
+class LatencyRecorder
+{
+public:
+    LatencyRecorder(const LoomingStimulus &stimulus, double dt, double thresholdAngle = 40.0, double settleDuration = 0.5)
+        : m_Stimulus(stimulus), m_DT(dt), m_ThresholdAngle(thresholdAngle), m_SettleDuration(settleDuration),
+          m_Start(Clock::now())
+    {
+    }
+
+    //------------------------------------------------------------------------
+    // Public API
+    //------------------------------------------------------------------------
+    //! Record that a new input (e.g. a frame) arrived at timestep
+    void recordInput(unsigned int timestep)
+    {
+        m_Inputs.push_back({timestep, getWallTime()});
+    }
+
+    //! Record that the detector spiked at timestep
+    void recordSpike(unsigned int timestep)
+    {
+        m_Spikes.push_back({timestep, getWallTime()});
+    }
+
+    void printReport(std::ostream &stream = std::cout) const
+    {
+        // Determine how many trials were presented up to the point of collision
+        const double trialDurationMs = m_Stimulus.getTrialDuration() * 1000.0;
+        const double lastInputMs = m_Inputs.empty() ? 0.0 : ((double)m_Inputs.back().timestep * m_DT);
+        const double firstCollisionMs = m_Stimulus.getCollisionTime(0) * 1000.0;
+        const unsigned int numTrials = (m_Inputs.empty() || lastInputMs < firstCollisionMs) ? 0
+            : (1 + (unsigned int)((lastInputMs - firstCollisionMs) / trialDurationMs));
+
+        std::vector<double> collisionLatencies;
+        std::vector<double> thresholdLatencies;
+        std::vector<double> wallLatencies;
+        for(unsigned int trial = 0; trial < numTrials; trial++) {
+            // Find first spike within trial, once it has settled
+            const double trialStartMs = (double)trial * trialDurationMs;
+            const double windowStartMs = trialStartMs + (m_SettleDuration * 1000.0);
+            const auto spike = std::find_if(m_Spikes.cbegin(), m_Spikes.cend(),
+                                            [windowStartMs, this](const Event &e){ return ((double)e.timestep * m_DT) >= windowStartMs; });
+            if(spike == m_Spikes.cend() || ((double)spike->timestep * m_DT) >= (trialStartMs + trialDurationMs)) {
+                continue;
+            }
+
+            // Calculate simulated latency relative to collision and threshold crossing
+            const double spikeMs = (double)spike->timestep * m_DT;
+            const double thresholdMs = m_Stimulus.getThresholdTime(trial, m_ThresholdAngle) * 1000.0;
+            collisionLatencies.push_back(spikeMs - (m_Stimulus.getCollisionTime(trial) * 1000.0));
+            thresholdLatencies.push_back(spikeMs - thresholdMs);
+
+            // Calculate wall-clock latency from arrival of first input showing threshold crossing
+            const auto input = std::find_if(m_Inputs.cbegin(), m_Inputs.cend(),
+                                            [thresholdMs, this](const Event &e){ return ((double)e.timestep * m_DT) >= thresholdMs; });
+            if(input != m_Inputs.cend() && input->timestep <= spike->timestep) {
+                wallLatencies.push_back(spike->wallTime - input->wallTime);
+            }
+        }
+
+        // Calculate wall-clock time between successive inputs
+        std::vector<double> processingTimes;
+        for(size_t i = 1; i < m_Inputs.size(); i++) {
+            processingTimes.push_back(m_Inputs[i].wallTime - m_Inputs[i - 1].wallTime);
+        }
+
+        stream << "Latency: " << collisionLatencies.size() << "/" << numTrials << " trials detected (ignoring first "
+            << m_SettleDuration * 1000.0 << "ms of each)" << std::endl;
+        printDistribution(stream, "Latency relative to collision [ms]", collisionLatencies);
+        printDistribution(stream, "Latency relative to threshold [ms]", thresholdLatencies);
+        printDistribution(stream, "Wall-clock latency from threshold input [ms]", wallLatencies);
+        printDistribution(stream, "Processing time per input [ms]", processingTimes);
+    }
+
+private:
+    //------------------------------------------------------------------------
+    // Typedefines
+    //------------------------------------------------------------------------
+    typedef std::chrono::high_resolution_clock Clock;
+
+    //------------------------------------------------------------------------
+    // Event
+    //------------------------------------------------------------------------
+    struct Event
+    {
+        unsigned int timestep;
+
+        // Wall-clock time since recorder was created [ms]
+        double wallTime;
+    };
+
+    //------------------------------------------------------------------------
+    // Private methods
+    //------------------------------------------------------------------------
+    double getWallTime() const
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - m_Start).count();
+    }
+
+    static void printDistribution(std::ostream &stream, const char *title, std::vector<double> values)
+    {
+        stream << "\t" << title << ": ";
+        if(values.empty()) {
+            stream << "none" << std::endl;
+            return;
+        }
+
+        std::sort(values.begin(), values.end());
+        double sum = 0.0;
+        double sumSquared = 0.0;
+        for(double v : values) {
+            sum += v;
+            sumSquared += v * v;
+        }
+        const double mean = sum / (double)values.size();
+        const double stdDev = std::sqrt(std::max(0.0, (sumSquared / (double)values.size()) - (mean * mean)));
+        auto percentile = [&values](double p){ return values[std::min(values.size() - 1, (size_t)(p * (double)values.size()))]; };
+
+        stream << "mean " << mean << ", std dev " << stdDev << ", min " << values.front() << ", median " << percentile(0.5)
+            << ", 90th percentile " << percentile(0.9) << ", max " << values.back() << std::endl;
+    }
+
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    const LoomingStimulus m_Stimulus;
+    const double m_DT;
+
+    // Full angle [degrees] used as detection threshold
+    const double m_ThresholdAngle;
+
+    // Time [s] after start of each trial before spikes are counted
+    const double m_SettleDuration;
+
+    const Clock::time_point m_Start;
+
+    std::vector<Event> m_Inputs;
+    std::vector<Event> m_Spikes;
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+// Standard C++ includes
+#include <vector>
+
+// Standard C includes
+#include <cmath>
+
+// Common example includes
+#include "looming_stimulus.h"
+
+//----------------------------------------------------------------------------
+// LoomingEventSource
+//----------------------------------------------------------------------------
+//! Event source which generates the events an ideal DVS would emit when viewing
+//! a LoomingStimulus - OFF events as the dark square's edges expand over each pixel
+//! and ON events when each trial resets. Runs for a fixed number of trials.
+//! Implements the same interface as the other event sources (see EventSource).
+class LoomingEventSource
+{
+public:
+    //------------------------------------------------------------------------
+    // Enumerations
+    //------------------------------------------------------------------------
+    enum class Polarity
+    {
+        On,
+        Off,
+        Both,
+    };
+
+    LoomingEventSource(const LoomingStimulus &stimulus, unsigned int resolution, double dt,
+                       unsigned int numTrials, Polarity polarity = Polarity::Both)
+        : m_Stimulus(stimulus), m_Resolution(resolution), m_DT(dt), m_Polarity(polarity),
+          m_NumTimesteps((unsigned int)std::ceil((stimulus.getTrialDuration() * 1000.0 * (double)numTrials) / dt)),
+          m_Timestep(0), m_Dark(resolution * resolution, false)
+    {
+    }
+
+    //------------------------------------------------------------------------
+    // Public API
+    //------------------------------------------------------------------------
+    void start()
+    {
+    }
+
+    void stop()
+    {
+    }
+
+    bool isFinished() const
+    {
+        return (m_Timestep >= m_NumTimesteps);
+    }
+
+    void readEvents(unsigned int &spikeCount, unsigned int *spikes)
+    {
+        spikeCount = 0;
+
+        // Get extent of square at this timestep
+        const double halfSize = m_Stimulus.getHalfSize(((double)m_Timestep++ * m_DT) / 1000.0, m_Resolution);
+        const double centre = (double)(m_Resolution - 1) * 0.5;
+
+        // Loop through pixels
+        for(unsigned int y = 0; y < m_Resolution; y++) {
+            for(unsigned int x = 0; x < m_Resolution; x++) {
+                // Determine whether pixel is covered by object
+                const bool dark = (std::fabs((double)x - centre) <= halfSize && std::fabs((double)y - centre) <= halfSize);
+
+                // If this has changed, emit event with appropriate polarity
+                const unsigned int i = x + (y * m_Resolution);
+                if(dark != m_Dark[i]) {
+                    m_Dark[i] = dark;
+
+                    if(m_Polarity == Polarity::Both || (dark && m_Polarity == Polarity::Off)
+                        || (!dark && m_Polarity == Polarity::On))
+                    {
+                        spikes[spikeCount++] = i;
+                    }
+                }
+            }
+        }
+    }
+
+    unsigned int getWidth() const
+    {
+        return m_Resolution;
+    }
+
+    unsigned int getHeight() const
+    {
+        return m_Resolution;
+    }
+
+    const LoomingStimulus &getStimulus() const{ return m_Stimulus; }
+
+private:
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    const LoomingStimulus m_Stimulus;
+    const unsigned int m_Resolution;
+    const double m_DT;
+    const Polarity m_Polarity;
+    const unsigned int m_NumTimesteps;
+
+    unsigned int m_Timestep;
+
+    // Is each pixel currently covered by the object
+    std::vector<bool> m_Dark;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+// Standard C++ includes
+#include <algorithm>
+#include <limits>
+
+// Standard C includes
+#include <cmath>
+
+//----------------------------------------------------------------------------
+// LoomingStimulus
+//----------------------------------------------------------------------------
+//! Timing of a repeating looming stimulus: a square of half-size l approaching a
+//! camera with the given field of view at constant speed v. Each trial lasts
+//! approachDuration seconds, ending in collision, after which the object fills
+//! the view for holdDuration seconds before the next trial starts. Stimuli are
+//! characterised by the ratio l/|v| [ms] as in the LGMD literature.
+class LoomingStimulus
+{
+public:
+    LoomingStimulus(double lOverV = 20.0, double approachDuration = 2.0, double holdDuration = 0.5,
+                    double fieldOfView = 60.0)
+        : m_LOverV(lOverV / 1000.0), m_ApproachDuration(approachDuration), m_HoldDuration(holdDuration),
+          m_TanHalfFOV(std::tan(fieldOfView * 0.5 * M_PI / 180.0))
+    {
+    }
+
+    //------------------------------------------------------------------------
+    // Public API
+    //------------------------------------------------------------------------
+    double getTrialDuration() const{ return m_ApproachDuration + m_HoldDuration; }
+
+    //! Time [s] from the start of the stimulus at which the object in trial collides
+    double getCollisionTime(unsigned int trial) const
+    {
+        return ((double)trial * getTrialDuration()) + m_ApproachDuration;
+    }
+
+    //! Time [s] from the start of the stimulus at which the object in trial subtends the given full angle [degrees]
+    double getThresholdTime(unsigned int trial, double angle) const
+    {
+        const double timeToContact = m_LOverV / std::tan(angle * 0.5 * M_PI / 180.0);
+        return getCollisionTime(trial) - std::min(timeToContact, m_ApproachDuration);
+    }
+
+    //! Half-size [pixels] of object's projection onto an image of the given height at
+    //! time [s], or infinity if the object has collided and fills the view
+    double getHalfSize(double time, unsigned int height) const
+    {
+        const double timeToContact = m_ApproachDuration - std::fmod(time, getTrialDuration());
+        if(timeToContact <= 0.0) {
+            return std::numeric_limits<double>::infinity();
+        }
+        else {
+            // Project tangent of object's angular half-size (l / (v * ttc)) onto image plane
+            return (m_LOverV / timeToContact) / m_TanHalfFOV * ((double)height * 0.5);
+        }
+    }
+
+private:
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    // Ratio of object half-size to approach speed [s]
+    const double m_LOverV;
+
+    const double m_ApproachDuration;
+    const double m_HoldDuration;
+    const double m_TanHalfFOV;
+};
@@ -1,7 +1,11 @@
 #pragma once
 
 // Standard C++ includes
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <stdexcept>
+#include <thread>
 
 // OpenCV includes
 #include <opencv2/imgproc/imgproc.hpp>
@@ -11,30 +15,52 @@
 #include <opencv2/gpu/gpu.hpp>
 #endif  // CPU_ONLY
 
+// Common example includes
+#include "frame_source.h"
+#include "fused_dvs_kernel.h"
+#include "realtime.h"
+#include "triple_buffer.h"
+
 //----------------------------------------------------------------------------
 // OpenCVDVS
 //----------------------------------------------------------------------------
 //! Uses OpenCV video capture interface to provide low-resolution, square 
 //! Image consisting of difference between frames:
 //! pipe into a layer of neurons and bob's your cheap DVS uncle
+//! In asynchronous mode, frames are continuously captured on a separate
+//! thread into a triple buffer so update never waits for the frame source
+//! and always processes the newest available frame.
 class OpenCVDVS
 {
 public:
-    OpenCVDVS(unsigned int device, unsigned int resolution, bool absolute)
-        : m_Camera(device), m_Resolution(resolution), m_Absolute(absolute)
+    OpenCVDVS(FrameSource &source, unsigned int resolution, bool absolute, bool asynchronous)
+        : m_Source(source), m_Resolution(resolution), m_Absolute(absolute), m_Asynchronous(asynchronous),
+          m_Timestep(1.0), m_Time(0.0), m_NextFrameTime(0.0),
+          m_StopCapture(false), m_CaptureFinished(false), m_Finished(false), m_NewFrame(false),
+          m_NumFramesCaptured(0), m_NumDroppedFrames(0), m_NumRepeatedFrames(0)
     {
-        // Check camera has opened correctly
-        if(!m_Camera.isOpened()) {
-            throw std::runtime_error("Cannot open camera");
+        if(m_Asynchronous) {
+            // Read first frame synchronously so it's available to first update
+            if(!m_Source.readFrame(m_CaptureBuffer.getWriteBuffer())) {
+                throw std::runtime_error("Cannot read first frame");
+            }
+            m_CaptureBuffer.publish();
+            m_NumFramesCaptured++;
+
+            // Start capture thread
+            m_CaptureThread = std::thread(&OpenCVDVS::captureThreadHandler, this);
         }
-        
-         // Read first frame from camera
-        readFrame();
-        
-        // Create square Region of Interest within raw frame
-        m_SquareROI = m_RawFrame(getCameraSquare());       
     }
-    
+
+    virtual ~OpenCVDVS()
+    {
+        // Stop capture thread
+        if(m_CaptureThread.joinable()) {
+            m_StopCapture = true;
+            m_CaptureThread.join();
+        }
+    }
+
     //----------------------------------------------------------------------------
     // Declared virtuals
     //----------------------------------------------------------------------------
@@ -48,30 +74,60 @@ public:
     //----------------------------------------------------------------------------
     void showRawFrame(const char *name)
     {
-        cv::imshow(name, m_RawFrame);
+        if(!m_SquareROI.empty()) {
+            cv::imshow(name, m_SquareROI);
+        }
+    }
+
+    //! Set simulation timestep [ms]. In synchronous mode, sources with a frame rate are
+    //! then paced in simulation rather than wall-clock time so results are reproducible
+    void setTimestep(double timestep)
+    {
+        m_Timestep = timestep;
+    }
+
+    //! Pin and prioritise capture thread (only exists in asynchronous mode)
+    bool configureCaptureThread(int core, int priority)
+    {
+        if(!m_CaptureThread.joinable()) {
+            return (core < 0 && priority <= 0);
+        }
+        return Realtime::configureThread(m_CaptureThread.native_handle(), core, priority, "input");
+    }
+
+    //! Has frame source run out of frames
+    bool isFinished() const
+    {
+        return m_Finished;
+    }
+
+    //! Did the last update process a new frame
+    bool isNewFrame() const
+    {
+        return m_NewFrame;
+    }
+
+    unsigned long long getNumFramesCaptured() const{ return m_NumFramesCaptured; }
+    unsigned long long getNumDroppedFrames() const{ return m_NumDroppedFrames; }
+    unsigned long long getNumRepeatedFrames() const{ return m_NumRepeatedFrames; }
+
+    void printFrameStats(std::ostream &stream = std::cout) const
+    {
+        stream << "Frames: " << m_NumFramesCaptured << " captured, " << m_NumDroppedFrames << " dropped, "
+            << m_NumRepeatedFrames << " repeated" << std::endl;
     }
     
 protected:
     //----------------------------------------------------------------------------
     // Protected methods
     //----------------------------------------------------------------------------
-    void readFrame()
+    //! Make newest frame available through getSquareROI, returning false if there is no new frame
+    bool acquireFrame()
     {
-        if(!m_Camera.read(m_RawFrame)) {
-            throw std::runtime_error("Cannot read first frame");
-        }
+        m_NewFrame = acquireFrameInternal();
+        return m_NewFrame;
     }
-    
-    cv::Rect getCameraSquare()
-    {
-        // Get frame dimensions
-        const unsigned int width = m_Camera.get(CV_CAP_PROP_FRAME_WIDTH);
-        const unsigned int height = m_Camera.get(CV_CAP_PROP_FRAME_HEIGHT);
-         
-        const unsigned int margin = (width - height) / 2;
-        return cv::Rect(cv::Point(margin, 0), cv::Point(width - margin, height));
-    }
-    
+
     unsigned int getResolution() const
     {
         return m_Resolution;
@@ -86,23 +142,138 @@ protected:
     {
         return m_SquareROI;
     }
+
+    //----------------------------------------------------------------------------
+    // Static methods
+    //----------------------------------------------------------------------------
+    static cv::Rect getSquare(unsigned int width, unsigned int height)
+    {
+        const unsigned int margin = (width - height) / 2;
+        return cv::Rect(cv::Point(margin, 0), cv::Point(width - margin, height));
+    }
     
 private:
+    //----------------------------------------------------------------------------
+    // Private methods
+    //----------------------------------------------------------------------------
+    bool acquireFrameInternal()
+    {
+        if(m_Asynchronous) {
+            // Check whether capture thread has finished BEFORE consuming so its final frame can't be missed
+            const bool captureFinished = m_CaptureFinished;
+
+            // If capture thread has published a new frame, use it
+            if(m_CaptureBuffer.consume()) {
+                m_SquareROI = cropSquare(m_CaptureBuffer.getReadBuffer());
+                return true;
+            }
+            // Otherwise, if capture thread has finished, so have we
+            else {
+                if(captureFinished) {
+                    m_Finished = true;
+                }
+                m_NumRepeatedFrames++;
+                return false;
+            }
+        }
+        else {
+            // If source has a frame rate, only read a new frame once simulation time reaches it
+            const double frameRate = m_Source.getFrameRate();
+            const double time = m_Time;
+            m_Time += m_Timestep;
+            if(frameRate > 0.0) {
+                if(time < m_NextFrameTime) {
+                    m_NumRepeatedFrames++;
+                    return false;
+                }
+                m_NextFrameTime += 1000.0 / frameRate;
+            }
+
+            if(m_Source.readFrame(m_RawFrame)) {
+                m_NumFramesCaptured++;
+                m_SquareROI = cropSquare(m_RawFrame);
+                return true;
+            }
+            else {
+                m_Finished = true;
+                return false;
+            }
+        }
+    }
+
+    static cv::Mat cropSquare(const cv::Mat &frame)
+    {
+        return frame(getSquare(frame.cols, frame.rows));
+    }
+
+    void captureThreadHandler()
+    {
+        // If source doesn't pace itself, calculate frame interval
+        const double frameRate = m_Source.getFrameRate();
+        const auto frameInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>((frameRate > 0.0) ? (1.0 / frameRate) : 0.0));
+
+        auto nextFrameTime = std::chrono::steady_clock::now() + frameInterval;
+        while(!m_StopCapture) {
+            // Wait until frame is due
+            if(frameRate > 0.0) {
+                std::this_thread::sleep_until(nextFrameTime);
+                nextFrameTime += frameInterval;
+            }
+
+            // Read frame into write buffer
+            if(!m_Source.readFrame(m_CaptureBuffer.getWriteBuffer())) {
+                break;
+            }
+
+            // Publish, counting frame as dropped if the previous one was never consumed
+            if(m_CaptureBuffer.publish()) {
+                m_NumDroppedFrames++;
+            }
+            m_NumFramesCaptured++;
+        }
+
+        m_CaptureFinished = true;
+    }
+
     //----------------------------------------------------------------------------
     // Members
     //----------------------------------------------------------------------------
-    cv::VideoCapture m_Camera;
+    FrameSource &m_Source;
     
     // Square resolution DVS operates at
     const unsigned int m_Resolution;
 
     // Should frame difference be absolute
     const bool m_Absolute;
-    
-    // Full resolution, colour frame read directly from camera
+
+    // Should frames be captured on a separate thread
+    const bool m_Asynchronous;
+
+    // Full resolution, colour frame read from source in synchronous mode
     cv::Mat m_RawFrame;
+
+    // Simulation timestep, current simulation time and time next frame is due in synchronous mode [ms]
+    double m_Timestep;
+    double m_Time;
+    double m_NextFrameTime;
+
+    // Frames captured by capture thread in asynchronous mode
+    TripleBuffer<cv::Mat> m_CaptureBuffer;
+    std::thread m_CaptureThread;
+    std::atomic<bool> m_StopCapture;
+    std::atomic<bool> m_CaptureFinished;
+    bool m_Finished;
+
+    // Did last call to acquireFrame get a new frame
+    bool m_NewFrame;
+
+    // Frame counters
+    std::atomic<unsigned long long> m_NumFramesCaptured;
+    std::atomic<unsigned long long> m_NumDroppedFrames;
+    unsigned long long m_NumRepeatedFrames;
     
-    // Square region of interest within m_RawFrame used for subsequent processing
+    // Square region of interest within current frame used for subsequent processing
     cv::Mat m_SquareROI;
 };
 
@@ -112,8 +283,9 @@ private:
 class OpenCVDVSCPU : public OpenCVDVS
 {
 public:
-    OpenCVDVSCPU(unsigned int device, unsigned int resolution, bool absolute=false)
-        : OpenCVDVS(device, resolution, absolute)
+    OpenCVDVSCPU(FrameSource &source, unsigned int resolution, bool absolute=false, bool asynchronous=true,
+                 bool fused=false)
+        : OpenCVDVS(source, resolution, absolute, asynchronous), m_Fused(fused), m_FusedKernel(resolution)
     {
         // Initialize and zero the two downsampled image
         m_DownsampledFrames[0].create(getResolution(), getResolution(), CV_32FC1);
@@ -134,6 +306,25 @@ public:
         // Get references to current and previous down-sampled frame
         auto &curDownSampledFrame = m_DownsampledFrames[i % 2];
         auto &prevDownSampledFrame = m_DownsampledFrames[(i + 1) % 2];
+
+        // If there's no new frame, nothing has changed
+        if(!acquireFrame()) {
+            prevDownSampledFrame.copyTo(curDownSampledFrame);
+            m_FrameDifference.setTo(0);
+            return std::make_pair(reinterpret_cast<float*>(m_FrameDifference.data),
+                                  getResolution());
+        }
+
+        // If fused kernel is enabled, use it to calculate current down-sampled frame and difference in one pass
+        if(m_Fused) {
+            const cv::Mat &squareROI = getSquareROI();
+            m_FusedKernel.process(squareROI.data, squareROI.step, squareROI.rows,
+                                  reinterpret_cast<float*>(curDownSampledFrame.data),
+                                  (i > 0) ? reinterpret_cast<const float*>(prevDownSampledFrame.data) : nullptr,
+                                  reinterpret_cast<float*>(m_FrameDifference.data), isAbsolute());
+            return std::make_pair(reinterpret_cast<float*>(m_FrameDifference.data),
+                                  getResolution());
+        }
         
         // Convert square frame to floating-point using CPU
         cv::cvtColor(getSquareROI(), m_GreyscaleFrame, CV_BGR2GRAY);
@@ -154,9 +345,6 @@ public:
                 cv::subtract(curDownSampledFrame, prevDownSampledFrame, m_FrameDifference);
             }
         }
-    
-        // Read next frame
-        readFrame();
 
         // Return frame difference data directly
         return std::make_pair(reinterpret_cast<float*>(m_FrameDifference.data),
@@ -175,6 +363,10 @@ public:
 
     virtual void showGreyscaleFrame(const char *name) override
     {
+        // Fused kernel never produces a full-resolution greyscale frame so convert one on demand
+        if(m_Fused) {
+            cv::cvtColor(getSquareROI(), m_GreyscaleFrame, CV_BGR2GRAY);
+        }
         cv::imshow(name, m_GreyscaleFrame);
     }
 
@@ -182,11 +374,16 @@ public:
     // Public API
     //----------------------------------------------------------------------------
     const cv::Mat &getFrameDifference() const{ return m_FrameDifference; }
+    const cv::Mat &getDownsampledFrame(unsigned int i) const{ return m_DownsampledFrames[i % 2]; }
     
 private:
     //----------------------------------------------------------------------------
     // Members
     //----------------------------------------------------------------------------
+    // Should fused kernel be used rather than separate OpenCV passes
+    const bool m_Fused;
+    FusedDVSKernel m_FusedKernel;
+
     cv::Mat m_GreyscaleFrame;
     
     cv::Mat m_DownsampledFrames[2];
@@ -200,12 +397,12 @@ private:
 class OpenCVDVSGPU : public OpenCVDVS
 {
 public:
-    OpenCVDVSGPU(unsigned int device, unsigned int resolution, bool absolute=false)
-        : OpenCVDVS(device, resolution, absolute)
+    OpenCVDVSGPU(FrameSource &source, unsigned int resolution, bool absolute=false, bool asynchronous=true)
+        : OpenCVDVS(source, resolution, absolute, asynchronous)
     {
         // Create GPU matrix to upload squared camera input into
-        auto cameraSquare = getCameraSquare();
-        m_SquareROIGPU.create(cameraSquare.width, cameraSquare.height, CV_8UC3);
+        auto cameraSquare = getSquare(source.getWidth(), source.getHeight());
+        m_SquareROIGPU.create(cameraSquare.height, cameraSquare.width, CV_8UC3);
         
         // Initialize and zero the two downsampled image
         m_DownsampledFrames[0].create(getResolution(), getResolution(), CV_32FC1);
@@ -221,11 +418,18 @@ public:
     //----------------------------------------------------------------------------
     // OpenCVDVS virtuals
     //----------------------------------------------------------------------------
-    virtual std::pair<float*, unsigned int> update(unsigned int i, std::mutex &mutex) override
+    virtual std::pair<float*, unsigned int> update(unsigned int i) override
     {
         // Get references to current and previous down-sampled frame
         auto &curDownSampledFrame = m_DownsampledFrames[i % 2];
         auto &prevDownSampledFrame = m_DownsampledFrames[(i + 1) % 2];
+
+        // If there's no new frame, nothing has changed
+        if(!acquireFrame()) {
+            prevDownSampledFrame.copyTo(curDownSampledFrame);
+            m_FrameDifference.setTo(0);
+            return getFrameDifferencePtr();
+        }
     
         // Upload camera data to GPU
         m_SquareROIGPU.upload(getSquareROI());
@@ -242,7 +446,6 @@ public:
         
         // If this isn't first frame, calculate difference with previous frame
         if(i > 0) {
-            std::lock_guard<std::mutex> lock(outputMutex);
             if(isAbsolute()) {
                 cv::gpu::absdiff(curDownSampledFrame, prevDownSampledFrame, m_FrameDifference);
             }
@@ -251,13 +454,7 @@ public:
             }
         }
     
-        // Read next frame
-        readFrame();
-        
-        // Get low-level structure containing device pointer and stride and return
-        auto frameDifferencePtrStep = (cv::gpu::PtrStep<float>)m_FrameDifference;
-        return std::make_pair(frameDifferencePtrStep.data,
-                              frameDifferencePtrStep.step / sizeof(float));
+        return getFrameDifferencePtr();
     }
     
     virtual void showDownsampledFrame(const char *name, unsigned int i) override
@@ -290,6 +487,18 @@ public:
     const cv::gpu::GpuMat &getFrameDifference() const{ return m_FrameDifference; }
     
 private:
+    //----------------------------------------------------------------------------
+    // Private methods
+    //----------------------------------------------------------------------------
+    std::pair<float*, unsigned int> getFrameDifferencePtr()
+    {
+        // Get low-level structure containing device pointer and stride and return
+        auto frameDifferencePtrStep = (cv::gpu::PtrStep<float>)m_FrameDifference;
+        return std::make_pair(frameDifferencePtrStep.data,
+                              frameDifferencePtrStep.step / sizeof(float));
+    }
+
+
     //----------------------------------------------------------------------------
     // Members
     //----------------------------------------------------------------------------
@@ -9,18 +9,24 @@
 //! Leaky integrate-and-fire neuron solved algebraically
 //! Input current comes from a external array of floats and 
 //! a stride  (as provided by an OpenCV PtrStep struct)
+//! Input resolution is also set at runtime so the population can be sized for the
+//! largest resolution required - neurons beyond resolution * resolution receive no input
 class OpenCVLIF : public NeuronModels::Base
 {
 public:
-    DECLARE_MODEL(OpenCVLIF, 8, 2);
+    DECLARE_MODEL(OpenCVLIF, 7, 2);
 
     SET_SIM_CODE(
         "if ($(RefracTime) <= 0.0)\n"
         "{\n"
-        "  unsigned int x = $(id) % (unsigned int)($(Resolution));\n"
-        "  unsigned int y = $(id) / (unsigned int)($(Resolution));\n"
-        "  unsigned int index = (y * $(step)) + x;\n"
-        "  scalar inputCurrent = *($(inputCurrents) + index);\n"
+        "  scalar inputCurrent = 0.0;\n"
+        "  if ($(id) < ($(resolution) * $(resolution)))\n"
+        "  {\n"
+        "    unsigned int x = $(id) % $(resolution);\n"
+        "    unsigned int y = $(id) / $(resolution);\n"
+        "    unsigned int index = (y * $(step)) + x;\n"
+        "    inputCurrent = *($(inputCurrents) + index);\n"
+        "  }\n"
         "  scalar alpha = ((inputCurrent + $(Ioffset)) * $(Rmembrane)) + $(Vrest);\n"
         "  $(V) = alpha - ($(ExpTC) * (alpha - $(V)));\n"
         "}\n"
@@ -44,7 +50,6 @@ public:
         "Vthresh",    // Spiking threshold [mV]
         "Ioffset",    // Offset current
         "TauRefrac",  // Refractory time [ms]
-        "Resolution", // Resolution of population
     });
 
     SET_DERIVED_PARAMS({
@@ -53,6 +58,6 @@ public:
 
     SET_VARS({{"V", "scalar"}, {"RefracTime", "scalar"}});
     
-    SET_EXTRA_GLOBAL_PARAMS({{"inputCurrents", "float*"}, {"step", "unsigned int"}});
+    SET_EXTRA_GLOBAL_PARAMS({{"inputCurrents", "float*"}, {"step", "unsigned int"}, {"resolution", "unsigned int"}});
 };
 IMPLEMENT_MODEL(OpenCVLIF);
\ No newline at end of file
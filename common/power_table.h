@@ -0,0 +1,40 @@
+#pragma once
+
+// Standard C++ includes
+#include <vector>
+
+// Standard C includes
+#include <cassert>
+
+//----------------------------------------------------------------------------
+// PowerTable
+//----------------------------------------------------------------------------
+//! Lookup table of base^n used to apply n timesteps of exponential decay in one go.
+//! Powers are built by repeated multiplication so they match decaying eagerly every
+//! timestep and, once they drop below threshold, are treated as zero
+class PowerTable
+{
+public:
+    PowerTable(float base, float threshold = 1.0E-6f)
+    {
+        assert(base >= 0.0f && base < 1.0f);
+
+        for(float power = 1.0f; power >= threshold; power *= base) {
+            m_Powers.push_back(power);
+        }
+    }
+
+    //------------------------------------------------------------------------
+    // Operators
+    //------------------------------------------------------------------------
+    float operator[](unsigned int n) const
+    {
+        return (n < m_Powers.size()) ? m_Powers[n] : 0.0f;
+    }
+
+private:
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    std::vector<float> m_Powers;
+};
@@ -0,0 +1,169 @@
+#pragma once
+
+// Standard C++ includes
+#include <iostream>
+
+// Standard C includes
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+// POSIX includes
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+//----------------------------------------------------------------------------
+// Realtime
+//----------------------------------------------------------------------------
+//! Helpers for opting threads into more predictable scheduling. Each helper
+//! reports failures (typically due to missing permissions) on std::cerr and
+//! returns false, but leaves the application to carry on without that guarantee
+namespace Realtime
+{
+//! How much of each configured thread's stack to pre-fault
+constexpr size_t stackPrefaultBytes = 256 * 1024;
+
+//----------------------------------------------------------------------------
+// Realtime::Config
+//----------------------------------------------------------------------------
+struct Config
+{
+    Config() : simulationCore(-1), inputCore(-1), displayCore(-1), priority(0), lockMemory(false)
+    {
+    }
+
+    // Cores to pin each thread to (-1 leaves thread free to migrate)
+    int simulationCore;
+    int inputCore;
+    int displayCore;
+
+    // SCHED_FIFO priority for simulation and input threads (0 leaves them in normal scheduling class)
+    int priority;
+
+    // Should all current and future memory be locked into RAM
+    bool lockMemory;
+};
+
+//----------------------------------------------------------------------------
+// Functions
+//----------------------------------------------------------------------------
+//! If argument a is a realtime option, apply it to config, advance a past any value and return true
+inline bool parseArg(Config &config, int &a, int argc, char *argv[])
+{
+    if(strcmp(argv[a], "--simulation-core") == 0 && (a + 1) < argc) {
+        config.simulationCore = std::atoi(argv[++a]);
+    }
+    else if(strcmp(argv[a], "--input-core") == 0 && (a + 1) < argc) {
+        config.inputCore = std::atoi(argv[++a]);
+    }
+    else if(strcmp(argv[a], "--display-core") == 0 && (a + 1) < argc) {
+        config.displayCore = std::atoi(argv[++a]);
+    }
+    else if(strcmp(argv[a], "--rt-priority") == 0 && (a + 1) < argc) {
+        config.priority = std::atoi(argv[++a]);
+    }
+    else if(strcmp(argv[a], "--lock-memory") == 0) {
+        config.lockMemory = true;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+//! Pin thread to a single core
+inline bool pinThread(pthread_t thread, int core, const char *name)
+{
+    if(core < 0) {
+        return true;
+    }
+
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(core, &cpuSet);
+    const int result = pthread_setaffinity_np(thread, sizeof(cpu_set_t), &cpuSet);
+    if(result != 0) {
+        std::cerr << "Realtime: unable to pin " << name << " thread to core " << core << ": " << strerror(result) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+//! Move thread into SCHED_FIFO scheduling class with given priority
+inline bool setFIFOPriority(pthread_t thread, int priority, const char *name)
+{
+    if(priority <= 0) {
+        return true;
+    }
+
+    sched_param param;
+    param.sched_priority = priority;
+    const int result = pthread_setschedparam(thread, SCHED_FIFO, &param);
+    if(result != 0) {
+        std::cerr << "Realtime: unable to set SCHED_FIFO priority " << priority << " for " << name << " thread: " << strerror(result) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+//! Lock all current and future pages into RAM so they can't be paged out mid-timestep
+inline bool lockMemory()
+{
+    if(mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        std::cerr << "Realtime: unable to lock memory: " << strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+//! Touch every page of buffer so first access from the realtime loop doesn't fault
+inline void prefault(void *data, size_t size)
+{
+    if(size == 0) {
+        return;
+    }
+
+    const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    volatile unsigned char *bytes = reinterpret_cast<volatile unsigned char*>(data);
+    for(size_t i = 0; i < size; i += pageSize) {
+        bytes[i] = bytes[i];
+    }
+    bytes[size - 1] = bytes[size - 1];
+}
+
+//! Pre-fault the calling thread's stack
+inline void prefaultStack()
+{
+    unsigned char stack[stackPrefaultBytes];
+    prefault(stack, stackPrefaultBytes);
+}
+
+//! Pin and prioritise a thread, returning false if either fails
+inline bool configureThread(pthread_t thread, int core, int priority, const char *name)
+{
+    const bool pinned = pinThread(thread, core, name);
+    const bool prioritised = setFIFOPriority(thread, priority, name);
+    return (pinned && prioritised);
+}
+
+//! Lock memory if requested and configure the calling thread as the simulation thread
+inline bool configureSimulationThread(const Config &config)
+{
+    bool success = true;
+    if(config.lockMemory) {
+        success = lockMemory();
+        prefaultStack();
+    }
+
+    success = configureThread(pthread_self(), config.simulationCore, config.priority, "simulation") && success;
+    return success;
+}
+
+//! Configure a display thread - these are pinned but left in the normal scheduling class
+inline bool configureDisplayThread(const Config &config, pthread_t thread)
+{
+    return pinThread(thread, config.displayCore, "display");
+}
+}   // namespace Realtime
@@ -0,0 +1,198 @@
+#pragma once
+
+// Standard C++ includes
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+// Standard C includes
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// POSIX includes
+#include <time.h>
+
+//----------------------------------------------------------------------------
+// RealtimeScheduler
+//----------------------------------------------------------------------------
+//! Paces a loop to a fixed period using absolute deadlines on CLOCK_MONOTONIC so,
+//! unlike sleeping for the remainder of each tick, oversleeping doesn't accumulate
+//! as drift. What happens when a tick overruns its deadline is set by the policy.
+class RealtimeScheduler
+{
+public:
+    //------------------------------------------------------------------------
+    // Enumerations
+    //------------------------------------------------------------------------
+    enum class OverrunPolicy
+    {
+        Skip,       // Drop any deadlines that have been missed entirely and realign to the next
+        CatchUp,    // Run missed ticks back-to-back until caught up (up to maxCatchUpTicks)
+        Degrade,    // As CatchUp but ask caller to shed optional work while late
+    };
+
+    //------------------------------------------------------------------------
+    // Tick
+    //------------------------------------------------------------------------
+    //! What waitForNextTick tells the caller about the tick it's about to run
+    struct Tick
+    {
+        // How many ticks were dropped before this one
+        unsigned int numSkipped;
+
+        // Should optional work be skipped this tick
+        bool degrade;
+    };
+
+    RealtimeScheduler(double periodMs, OverrunPolicy policy, unsigned int maxCatchUpTicks = 10)
+    :   m_PeriodNs((int64_t)std::round(periodMs * 1.0E6)), m_Policy(policy), m_MaxCatchUpTicks(maxCatchUpTicks),
+        m_NextDeadlineNs(0), m_NumTicks(0), m_NumOverruns(0), m_NumSkipped(0), m_NumDegraded(0),
+        m_JitterSumNs(0.0), m_JitterSumSquaredNs(0.0), m_MaxJitterNs(0), m_MinJitterNs(std::numeric_limits<int64_t>::max())
+    {
+    }
+
+    //------------------------------------------------------------------------
+    // Public API
+    //------------------------------------------------------------------------
+    //! Set deadline of first tick to now
+    void start()
+    {
+        m_NextDeadlineNs = getTimeNs();
+    }
+
+    //! Wait until the deadline of the next tick and advance deadline
+    Tick waitForNextTick()
+    {
+        Tick tick{0, false};
+
+        // If we're ahead of the deadline, sleep until it
+        const int64_t lateness = getTimeNs() - m_NextDeadlineNs;
+        if(lateness <= 0) {
+            const timespec deadline{(time_t)(m_NextDeadlineNs / 1000000000), (long)(m_NextDeadlineNs % 1000000000)};
+            while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {
+            }
+
+            // Record how late we actually woke up
+            recordJitter(getTimeNs() - m_NextDeadlineNs);
+        }
+        // Otherwise, deadline has already passed
+        else {
+            m_NumOverruns++;
+            recordJitter(lateness);
+
+            // Calculate how many further deadlines have also passed
+            const unsigned int numMissed = (unsigned int)(lateness / m_PeriodNs);
+
+            // If we're skipping, drop all missed ticks, otherwise only drop those beyond the catch-up limit
+            const unsigned int numToSkip = (m_Policy == OverrunPolicy::Skip) ? numMissed
+                : ((numMissed > m_MaxCatchUpTicks) ? (numMissed - m_MaxCatchUpTicks) : 0);
+            m_NextDeadlineNs += numToSkip * m_PeriodNs;
+            m_NumSkipped += numToSkip;
+            tick.numSkipped = numToSkip;
+
+            // If we're degrading, tell caller
+            if(m_Policy == OverrunPolicy::Degrade) {
+                m_NumDegraded++;
+                tick.degrade = true;
+            }
+        }
+
+        m_NumTicks++;
+        m_NextDeadlineNs += m_PeriodNs;
+        return tick;
+    }
+
+    unsigned long long getNumTicks() const{ return m_NumTicks; }
+    unsigned long long getNumOverruns() const{ return m_NumOverruns; }
+    unsigned long long getNumSkipped() const{ return m_NumSkipped; }
+    unsigned long long getNumDegraded() const{ return m_NumDegraded; }
+
+    //! Mean, standard deviation and range of lateness of tick starts relative to their deadlines [us]
+    double getMeanJitterUs() const
+    {
+        return (m_NumTicks == 0) ? 0.0 : (m_JitterSumNs / (double)m_NumTicks) / 1000.0;
+    }
+
+    double getJitterStdDevUs() const
+    {
+        if(m_NumTicks == 0) {
+            return 0.0;
+        }
+
+        const double mean = m_JitterSumNs / (double)m_NumTicks;
+        return std::sqrt(std::max(0.0, (m_JitterSumSquaredNs / (double)m_NumTicks) - (mean * mean))) / 1000.0;
+    }
+
+    double getMinJitterUs() const{ return (m_NumTicks == 0) ? 0.0 : (double)m_MinJitterNs / 1000.0; }
+    double getMaxJitterUs() const{ return (double)m_MaxJitterNs / 1000.0; }
+
+    void printStats(std::ostream &stream = std::cout) const
+    {
+        stream << "Scheduler: " << m_NumTicks << " ticks, " << m_NumOverruns << " overruns, "
+            << m_NumSkipped << " skipped, " << m_NumDegraded << " degraded" << std::endl;
+        stream << "Jitter: mean " << getMeanJitterUs() << "us, std dev " << getJitterStdDevUs()
+            << "us, min " << getMinJitterUs() << "us, max " << getMaxJitterUs() << "us" << std::endl;
+    }
+
+    //------------------------------------------------------------------------
+    // Static API
+    //------------------------------------------------------------------------
+    static OverrunPolicy parsePolicy(const std::string &policy)
+    {
+        if(policy == "skip") {
+            return OverrunPolicy::Skip;
+        }
+        else if(policy == "catch-up") {
+            return OverrunPolicy::CatchUp;
+        }
+        else if(policy == "degrade") {
+            return OverrunPolicy::Degrade;
+        }
+        else {
+            throw std::runtime_error("Unknown overrun policy '" + policy + "' (expected skip, catch-up or degrade)");
+        }
+    }
+
+private:
+    //------------------------------------------------------------------------
+    // Private methods
+    //------------------------------------------------------------------------
+    static int64_t getTimeNs()
+    {
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return ((int64_t)now.tv_sec * 1000000000) + now.tv_nsec;
+    }
+
+    void recordJitter(int64_t jitterNs)
+    {
+        m_JitterSumNs += (double)jitterNs;
+        m_JitterSumSquaredNs += (double)jitterNs * (double)jitterNs;
+        m_MinJitterNs = std::min(m_MinJitterNs, jitterNs);
+        m_MaxJitterNs = std::max(m_MaxJitterNs, jitterNs);
+    }
+
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    const int64_t m_PeriodNs;
+    const OverrunPolicy m_Policy;
+    const unsigned int m_MaxCatchUpTicks;
+
+    // Absolute deadline of next tick
+    int64_t m_NextDeadlineNs;
+
+    // Statistics
+    unsigned long long m_NumTicks;
+    unsigned long long m_NumOverruns;
+    unsigned long long m_NumSkipped;
+    unsigned long long m_NumDegraded;
+    double m_JitterSumNs;
+    double m_JitterSumSquaredNs;
+    int64_t m_MaxJitterNs;
+    int64_t m_MinJitterNs;
+};
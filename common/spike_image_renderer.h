@@ -1,11 +1,17 @@
 #pragma once
 
+// Standard C++ includes
+#include <vector>
+
 // Standard C includes
 #include <cstdlib>
 
 // OpenCV includes
 #include <opencv2/core/mat.hpp>
 
+// Common example includes
+#include "power_table.h"
+
 inline void renderSpikeImage(unsigned int spikeCount, const unsigned int *spikes,
                              unsigned int width, float persistence, cv::Mat &image)
 {
@@ -22,4 +28,70 @@ inline void renderSpikeImage(unsigned int spikeCount, const unsigned int *spikes
 
     // Decay image
     image *= persistence;
-}
\ No newline at end of file
+}
+
+//----------------------------------------------------------------------------
+// TimeSurfaceRenderer
+//----------------------------------------------------------------------------
+//! Produces the same image as calling renderSpikeImage every timestep but, rather
+//! than decaying the whole image every timestep, stores the timestep each pixel
+//! was last updated and only applies decay when a pixel spikes or is rendered
+class TimeSurfaceRenderer
+{
+public:
+    TimeSurfaceRenderer(unsigned int width, unsigned int height, float persistence)
+    :   m_Width(width), m_Height(height), m_Decay(persistence), m_Timestep(0),
+        m_Values(width * height, 0.0f), m_LastUpdate(width * height, 0)
+    {
+    }
+
+    //------------------------------------------------------------------------
+    // Public API
+    //------------------------------------------------------------------------
+    //! Add this timestep's spikes - should be called once every timestep
+    void update(unsigned int spikeCount, const unsigned int *spikes)
+    {
+        // Loop through spikes
+        for(unsigned int s = 0; s < spikeCount; s++)
+        {
+            // Bring pixel up to date and add spike
+            // **NOTE** values are stored before this timestep's decay is applied
+            const unsigned int spike = spikes[s];
+            m_Values[spike] = (m_Values[spike] * m_Decay[m_Timestep - m_LastUpdate[spike]]) + 1.0f;
+            m_LastUpdate[spike] = m_Timestep;
+        }
+
+        m_Timestep++;
+    }
+
+    //! Render decayed state of all pixels at the end of the last timestep into image
+    void render(cv::Mat &image) const
+    {
+        image.create(m_Height, m_Width, CV_32FC1);
+
+        for(unsigned int y = 0; y < m_Height; y++) {
+            float *row = image.ptr<float>(y);
+            for(unsigned int x = 0; x < m_Width; x++) {
+                const unsigned int i = x + (y * m_Width);
+                row[x] = m_Values[i] * m_Decay[m_Timestep - m_LastUpdate[i]];
+            }
+        }
+    }
+
+private:
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    const unsigned int m_Width;
+    const unsigned int m_Height;
+
+    // Lookup table of persistence^n
+    const PowerTable m_Decay;
+
+    // Number of timesteps simulated
+    unsigned int m_Timestep;
+
+    // Value and timestep of last update for each pixel
+    std::vector<float> m_Values;
+    std::vector<unsigned int> m_LastUpdate;
+};
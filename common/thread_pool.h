@@ -0,0 +1,128 @@
+#pragma once
+
+// Standard C++ includes
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Standard C includes
+#include <cstddef>
+
+//----------------------------------------------------------------------------
+// ThreadPool
+//----------------------------------------------------------------------------
+//! Fixed pool of worker threads for data-parallel loops. Each call to parallelFor
+//! splits a range into one contiguous block per thread, in thread order, so
+//! per-thread results can be reduced deterministically by the caller.
+class ThreadPool
+{
+public:
+    ThreadPool(unsigned int numThreads = std::thread::hardware_concurrency())
+    :   m_NumThreads(std::max(1u, numThreads)), m_NumItems(0), m_Generation(0), m_NumBusy(0), m_Quit(false)
+    {
+        // Calling thread runs block 0 so only create workers for the remainder
+        for(unsigned int t = 1; t < m_NumThreads; t++) {
+            m_Threads.emplace_back(&ThreadPool::workerThreadHandler, this, t);
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Quit = true;
+        }
+        m_StartCondition.notify_all();
+
+        for(auto &t : m_Threads) {
+            t.join();
+        }
+    }
+
+    //------------------------------------------------------------------------
+    // Public API
+    //------------------------------------------------------------------------
+    //! Call f(thread, begin, end) for each thread's block of [0, numItems) and wait for all to complete
+    template<typename F>
+    void parallelFor(size_t numItems, F f)
+    {
+        // Publish job to workers
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Job = [&f](unsigned int thread, size_t begin, size_t end){ f(thread, begin, end); };
+            m_NumItems = numItems;
+            m_NumBusy = m_NumThreads - 1;
+            m_Generation++;
+        }
+        m_StartCondition.notify_all();
+
+        // Run first block on calling thread
+        f(0, 0, getBlockEnd(0, numItems));
+
+        // Wait for workers to complete their blocks
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_DoneCondition.wait(lock, [this](){ return m_NumBusy == 0; });
+    }
+
+    unsigned int getNumThreads() const{ return m_NumThreads; }
+
+private:
+    //------------------------------------------------------------------------
+    // Private methods
+    //------------------------------------------------------------------------
+    //! Index one past the last item in thread's block
+    size_t getBlockEnd(unsigned int thread, size_t numItems) const
+    {
+        return ((thread + 1) * numItems) / m_NumThreads;
+    }
+
+    void workerThreadHandler(unsigned int thread)
+    {
+        unsigned long long generation = 0;
+        while(true) {
+            // Wait for new job or quit
+            std::function<void(unsigned int, size_t, size_t)> job;
+            size_t numItems;
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_StartCondition.wait(lock, [this, generation](){ return m_Quit || m_Generation != generation; });
+                if(m_Quit) {
+                    return;
+                }
+                generation = m_Generation;
+                job = m_Job;
+                numItems = m_NumItems;
+            }
+
+            // Run block
+            job(thread, getBlockEnd(thread - 1, numItems), getBlockEnd(thread, numItems));
+
+            // Signal completion
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if(--m_NumBusy == 0) {
+                m_DoneCondition.notify_one();
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    const unsigned int m_NumThreads;
+
+    std::vector<std::thread> m_Threads;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_StartCondition;
+    std::condition_variable m_DoneCondition;
+
+    // Current job, protected by m_Mutex
+    std::function<void(unsigned int, size_t, size_t)> m_Job;
+    size_t m_NumItems;
+    unsigned long long m_Generation;
+    unsigned int m_NumBusy;
+    bool m_Quit;
+};
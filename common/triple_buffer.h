@@ -0,0 +1,80 @@
+#pragma once
+
+// Standard C++ includes
+#include <atomic>
+
+//----------------------------------------------------------------------------
+// TripleBuffer
+//----------------------------------------------------------------------------
+//! Lock-free single producer, single consumer triple buffer. The producer
+//! writes into its own buffer and publishes it by swapping it with the shared
+//! middle buffer; the consumer takes the most recently published buffer by
+//! swapping it with its own. Neither side ever waits for the other.
+template<typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() : m_Buffers(), m_Middle(1), m_Write(0), m_Read(2)
+    {
+    }
+
+    //------------------------------------------------------------------------
+    // Public API
+    //------------------------------------------------------------------------
+    //! Get buffer producer should write into
+    T &getWriteBuffer()
+    {
+        return m_Buffers[m_Write];
+    }
+
+    //! Publish write buffer to consumer. Returns true if the previously
+    //! published buffer was overwritten without ever being consumed
+    bool publish()
+    {
+        const unsigned int previous = m_Middle.exchange(m_Write | FreshBit, std::memory_order_acq_rel);
+        m_Write = previous & IndexMask;
+        return (previous & FreshBit) != 0;
+    }
+
+    //! If a new buffer has been published since last call, make it the read buffer and return true
+    bool consume()
+    {
+        if((m_Middle.load(std::memory_order_relaxed) & FreshBit) == 0) {
+            return false;
+        }
+
+        const unsigned int previous = m_Middle.exchange(m_Read, std::memory_order_acq_rel);
+        m_Read = previous & IndexMask;
+        return true;
+    }
+
+    //! Get buffer consumer should read from
+    const T &getReadBuffer() const
+    {
+        return m_Buffers[m_Read];
+    }
+
+    T &getReadBuffer()
+    {
+        return m_Buffers[m_Read];
+    }
+
+private:
+    //------------------------------------------------------------------------
+    // Constants
+    //------------------------------------------------------------------------
+    static constexpr unsigned int IndexMask = 3;
+    static constexpr unsigned int FreshBit = 4;
+
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    T m_Buffers[3];
+
+    // Index of middle buffer and whether it has been published but not consumed
+    std::atomic<unsigned int> m_Middle;
+
+    // Indices of buffers owned by producer and consumer
+    unsigned int m_Write;
+    unsigned int m_Read;
+};
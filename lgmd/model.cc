@@ -69,12 +69,13 @@ void modelDefinition(NNmodel &model)
         0.0);       // 1 - RefracTime
 
     // Static synapse parameters
+    // **NOTE** convergent weights are overwritten at runtime to match centre size
     WeightUpdateModels::StaticPulse::VarValues p_f_lgmd_static_syn_init(
-        -Parameters::convergent_scale * 0.04 * 5.0 * 0.2);      // 0 - Wij (nA)
+        Parameters::convergent_scale * Parameters::p_f_lgmd_weight);      // 0 - Wij (nA)
 
     // **THINK** final constant is magic scale factor
     WeightUpdateModels::StaticPulse::VarValues s_lgmd_static_syn_init(
-        Parameters::convergent_scale * 0.04 * 2.0 * 5.0);     // 0 - Wij (nA)
+        Parameters::convergent_scale * Parameters::s_lgmd_weight);     // 0 - Wij (nA)
 
     WeightUpdateModels::StaticPulse::VarValues p_e_s_static_syn_init(
         0.6);     // 0 - Wij (nA)
@@ -104,9 +105,9 @@ void modelDefinition(NNmodel &model)
     // Neuron populations
     //------------------------------------------------------------------------
     // Create IF_curr neuron
-    model.addNeuronPopulation<NeuronModels::SpikeSource>("P", Parameters::input_size * Parameters::input_size,
+    model.addNeuronPopulation<NeuronModels::SpikeSource>("P", Parameters::max_input_size * Parameters::max_input_size,
                                                          {}, {});
-    model.addNeuronPopulation<LIF>("S", Parameters::input_size * Parameters::input_size,
+    model.addNeuronPopulation<LIF>("S", Parameters::max_input_size * Parameters::max_input_size,
                                    s_lif_params, lif_init);
 
     model.addNeuronPopulation<LIF>("LGMD", 1,
@@ -116,13 +117,13 @@ void modelDefinition(NNmodel &model)
     // Synapse populations
     //------------------------------------------------------------------------
     model.addSynapsePopulation<WeightUpdateModels::StaticPulse, ExpCurr>(
-        "P_F_LGMD", SynapseMatrixType::SPARSE_GLOBALG, 3,
+        "P_F_LGMD", SynapseMatrixType::SPARSE_INDIVIDUALG, 3,
         "P", "LGMD",
         {}, p_f_lgmd_static_syn_init,
         p_f_lgmd_exp_curr_params, {});
 
     model.addSynapsePopulation<WeightUpdateModels::StaticPulse, PostsynapticModels::DeltaCurr>(
-        "S_LGMD", SynapseMatrixType::SPARSE_GLOBALG, 1,
+        "S_LGMD", SynapseMatrixType::SPARSE_INDIVIDUALG, 1,
         "S", "LGMD",
         {}, s_lgmd_static_syn_init,
         {}, {});
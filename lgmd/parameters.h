@@ -7,11 +7,27 @@ namespace Parameters
 {
     const double timestep = 1.0;
 
+    // Default runtime resolution and size of centre region connected to LGMD
+    // **NOTE** at other resolutions, centre is scaled to cover the same fraction of input
     const unsigned int input_size = 32;
     const unsigned int centre_size = 20;
 
+    // Populations are sized for this resolution when the model is generated
+    // and simulators can then use any resolution up to it at runtime
+    // **NOTE** every neuron is updated each timestep so neuron update cost is fixed
+    // by this rather than the runtime resolution - build with MAX_INPUT_SIZE=N to raise it
+#ifdef MAX_INPUT_SIZE
+    const unsigned int max_input_size = MAX_INPUT_SIZE;
+#else
+    const unsigned int max_input_size = input_size;
+#endif
+
     const double convergent_scale =  ((16.0 * 16.0) / ((double)centre_size * (double)centre_size));
 
+    // Weights of convergent connections to LGMD, scaled by convergent scale of runtime centre size
+    const double p_f_lgmd_weight = -0.04 * 5.0 * 0.2;
+    const double s_lgmd_weight = 0.04 * 2.0 * 5.0;
+
     const double persistance_e = 0.1;
     const double persistance_i = 0.8;
     const double persistance_s = 0.4;
@@ -5,8 +5,13 @@ import matplotlib.patches as patches
 import matplotlib.pyplot as plt
 import sys
 
-original_resolution = 128
-output_resolution = 32
+# Resolution of recorded input spikes and runtime resolution model was simulated at
+original_resolution = int(sys.argv[2]) if len(sys.argv) > 2 else 128
+output_resolution = int(sys.argv[3]) if len(sys.argv) > 3 else 32
+
+# Border around centre region connected to LGMD (scaled as in simulator.cc)
+border_size = int(round(output_resolution * 6.0 / 32.0))
+centre_size = output_resolution - (2 * border_size)
 
 # How many 
 timesteps_per_frame = 33
@@ -127,9 +132,9 @@ s_v_image = s_axis.imshow(s_output[0,:,:], interpolation="nearest", cmap="jet",
 
 border = s_axis.add_patch(
     patches.Rectangle(
-        (6, 6),   # (x,y)
-        20,          # width
-        20,          # height
+        (border_size, border_size),   # (x,y)
+        centre_size,          # width
+        centre_size,          # height
         fill=False,
         color="white",
         linewidth=2.0))
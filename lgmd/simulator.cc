@@ -1,18 +1,28 @@
 #include "lgmd_CODE/definitions.h"
 
 // Standard C++ includes
+#include <algorithm>
+#include <chrono>
 #include <fstream>
+#include <iostream>
 #include <limits>
 #include <set>
 #include <sstream>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 // Standard C includes
 #include <cassert>
+#include <cmath>
 #include <cstdlib>
+#include <cstring>
 
 // Common example includes
 #include "../common/analogue_csv_recorder.h"
+#include "../common/event_source.h"
+#include "../common/latency_recorder.h"
+#include "../common/looming_event_source.h"
 #include "../common/spike_csv_recorder.h"
 
 // LGMD includes
@@ -30,6 +40,27 @@ unsigned int get_neuron_index(unsigned int resolution, unsigned int x, unsigned
     return x + (y * resolution);
 }
 
+unsigned int get_centre_size(unsigned int resolution)
+{
+    // Scale border around centre to cover same fraction of input as at default resolution
+    const double border_fraction = (double)(Parameters::input_size - Parameters::centre_size) / (double)(2 * Parameters::input_size);
+    const unsigned int border_size = (unsigned int)std::round((double)resolution * border_fraction);
+
+    // Populations must be large enough and I-S connections reach two pixels beyond centre
+    if(resolution > Parameters::max_input_size) {
+        throw std::runtime_error("Resolution " + std::to_string(resolution) + " exceeds maximum of " + std::to_string(Parameters::max_input_size));
+    }
+    else if(border_size < 2) {
+        throw std::runtime_error("Resolution " + std::to_string(resolution) + " too small");
+    }
+    return resolution - (2 * border_size);
+}
+
+double get_convergent_scale(unsigned int centre_size)
+{
+    return ((16.0 * 16.0) / ((double)centre_size * (double)centre_size));
+}
+
 void print_sparse_matrix(unsigned int pre_resolution, const SparseProjection &projection)
 {
     const unsigned int pre_size = pre_resolution * pre_resolution;
@@ -46,11 +77,14 @@ void print_sparse_matrix(unsigned int pre_resolution, const SparseProjection &pr
     }
 }
 
+// **NOTE** populations are sized for Parameters::max_input_size so rows
+// of neurons beyond the runtime resolution are left empty
 void build_one_to_one_connection(unsigned int resolution,
                                  SparseProjection &projection, allocateFn allocate)
 {
     // Allocate one connection per neuron
     const unsigned int pop_size = resolution * resolution;
+    const unsigned int max_pop_size = Parameters::max_input_size * Parameters::max_input_size;
     allocate(pop_size);
 
     for(unsigned int i = 0; i < pop_size; i++)
@@ -59,7 +93,7 @@ void build_one_to_one_connection(unsigned int resolution,
         projection.ind[i] = i;
     }
 
-    projection.indInG[pop_size] = pop_size;
+    std::fill(&projection.indInG[pop_size], &projection.indInG[max_pop_size + 1], pop_size);
 }
 
 void build_centre_to_one_connection(unsigned int pre_resolution, unsigned int centre_size,
@@ -88,8 +122,9 @@ void build_centre_to_one_connection(unsigned int pre_resolution, unsigned int ce
         }
     }
 
-    // Add ending entry to data structure
-    projection.indInG[i] = s;
+    // Add empty rows for unused neurons and ending entry to data structure
+    const unsigned int max_pop_size = Parameters::max_input_size * Parameters::max_input_size;
+    std::fill(&projection.indInG[i], &projection.indInG[max_pop_size + 1], s);
 
     // Check
     assert(s == (centre_size * centre_size));
@@ -102,6 +137,7 @@ void build_i_s_connections(unsigned int resolution, unsigned int centre_size,
                            SparseProjection &projection4, allocateFn allocate4)
 {
     const unsigned int pop_size = resolution * resolution;
+    const unsigned int max_pop_size = Parameters::max_input_size * Parameters::max_input_size;
     
     // Allocate sparse projections
     allocate1(centre_size * centre_size * 4);
@@ -163,10 +199,10 @@ void build_i_s_connections(unsigned int resolution, unsigned int centre_size,
         s4 += projection4Map[i].size();
     }
 
-    // Add ending entries to data structure
-    projection1.indInG[pop_size] = s1;
-    projection2.indInG[pop_size] = s2;
-    projection4.indInG[pop_size] = s4;
+    // Add empty rows for unused neurons and ending entries to data structure
+    std::fill(&projection1.indInG[pop_size], &projection1.indInG[max_pop_size + 1], s1);
+    std::fill(&projection2.indInG[pop_size], &projection2.indInG[max_pop_size + 1], s2);
+    std::fill(&projection4.indInG[pop_size], &projection4.indInG[max_pop_size + 1], s4);
 
     // Check
     assert(s1 == (centre_size * centre_size * 4));
@@ -174,126 +210,177 @@ void build_i_s_connections(unsigned int resolution, unsigned int centre_size,
     assert(s4 == (centre_size * centre_size * 4));
 }
 
-unsigned read_p_input(unsigned int output_resolution, unsigned int original_resolution,
-                      std::ifstream &stream, std::vector<unsigned int> &indices)
+void print_usage(const char *executable)
 {
-    // Calculate resolution scale
-    const double scale = (double)original_resolution / (double)output_resolution;
-
-    // Read lines into string
-    std::string line;
-    std::getline(stream, line);
+    std::cerr << "Usage: " << executable << " [--looming TRIALS] [--resolution N] [event source options]" << std::endl;
+    std::cerr << "\tN must be no greater than " << Parameters::max_input_size << " and leave a border of at least two pixels around the centre" << std::endl;
+    std::cerr << "\tModel was generated for " << Parameters::max_input_size << "x" << Parameters::max_input_size
+        << " inputs and all of these neurons are updated every timestep - lower resolutions only reduce input and synaptic cost" << std::endl;
+}
 
-    if(line.empty()) {
-        return std::numeric_limits<unsigned int>::max();
+//----------------------------------------------------------------------------
+// SimulationLoop
+//----------------------------------------------------------------------------
+//! Main simulation loop, instantiated for each type of event source by EventSource::run
+class SimulationLoop
+{
+public:
+    SimulationLoop(unsigned int resolution, LatencyRecorder *latencyRecorder = nullptr)
+        : m_Resolution(resolution), m_LatencyRecorder(latencyRecorder), m_NumS(0), m_NumL(0), m_NumTimesteps(0), m_NumEvents(0), m_Duration(0)
+    {
     }
 
-    // Create string stream from line
-    std::stringstream lineStream(line);
+    template<typename Source>
+    void operator()(Source &dvs)
+    {
+        SpikeCSVRecorder lgmdSpikeRecorder("lgmd_spikes.csv", glbSpkCntLGMD, glbSpkLGMD);
+        AnalogueCSVRecorder<scalar> sVoltageRecorder("s_voltages.csv", VS, m_Resolution * m_Resolution, "Voltage [mV]");
+        AnalogueCSVRecorder<scalar> lgmdVoltageRecorder("lgmd_voltages.csv", VLGMD, 1, "Voltage [mV]");
 
-    // Read time from start of line
-    std::string nextTimeString;
-    std::getline(lineStream, nextTimeString, ';');
-    unsigned int nextTime = (unsigned int)std::stoul(nextTimeString);
+        // Loop through timesteps until there is no more input
+        const auto start = std::chrono::high_resolution_clock::now();
+        for(m_NumTimesteps = 0; !dvs.isFinished(); m_NumTimesteps++)
+        {
+            // Read input spikes into spike source
+            dvs.readEvents(spikeCount_P, spike_P);
+            m_NumEvents += spikeCount_P;
+            if(m_LatencyRecorder != nullptr) {
+                m_LatencyRecorder->recordInput(m_NumTimesteps);
+            }
 
-    // Clear existing times
-    indices.clear();
+#ifndef CPU_ONLY
+            // Copy to GPU
+            if(spikeCount_P > 0) {
+                pushPCurrentSpikesToDevice();
+            }
+#endif
 
-    while(lineStream.good()) {
-        // Read input spike index
-        std::string inputIndexString;
-        std::getline(lineStream, inputIndexString, ',');
-        const int input_index = std::stoi(inputIndexString);
+            // Simulate
+#ifndef CPU_ONLY
+            stepTimeGPU();
 
-        // Convert this into x and y
-        const div_t input_coord = std::div(input_index, original_resolution);
+            pullLGMDStateFromDevice();
+            pullLGMDCurrentSpikesFromDevice();
+            pullSStateFromDevice();
+            pullSCurrentSpikesFromDevice();
+#else
+            stepTimeCPU();
+#endif
 
-        // Scale into output resolution
-        const unsigned int output_x = (unsigned int)std::floor((double)input_coord.quot / scale);
-        const unsigned int output_y = (unsigned int)std::floor((double)input_coord.rem / scale);
-        assert(output_x < output_resolution);
-        assert(output_y < output_resolution);
+            m_NumS += spikeCount_S;
+            m_NumL += spikeCount_LGMD;
+            if(m_LatencyRecorder != nullptr && spikeCount_LGMD > 0) {
+                m_LatencyRecorder->recordSpike(m_NumTimesteps);
+            }
 
-        // Convert back to index and add to vector
-        const unsigned int output_index = (output_x * output_resolution) + output_y;
-        indices.push_back(output_index);
+            sVoltageRecorder.record(t);
+            lgmdVoltageRecorder.record(t);
+            lgmdSpikeRecorder.record(t);
+        }
+        m_Duration = std::chrono::high_resolution_clock::now() - start;
     }
 
-    return nextTime;
-}
+    void printStats() const
+    {
+        const double seconds = m_Duration.count();
+        std::cout << "Resolution: " << m_Resolution << "x" << m_Resolution << " (model generated for " << Parameters::max_input_size << "x" << Parameters::max_input_size << ")" << std::endl;
+        std::cout << m_NumS << " S spikes, " << m_NumL << " LGMD spikes" << std::endl;
+        std::cout << "Batch: " << m_NumTimesteps << " steps, " << m_NumEvents << " events, " << seconds << " s, "
+            << (double)m_NumTimesteps / seconds << " steps/s, " << (double)m_NumEvents / seconds << " events/s" << std::endl;
+    }
+
+private:
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    const unsigned int m_Resolution;
+
+    // If non-null, input and LGMD spike times are recorded here
+    LatencyRecorder *m_LatencyRecorder;
+
+    unsigned int m_NumS;
+    unsigned int m_NumL;
+    unsigned int m_NumTimesteps;
+    unsigned long long m_NumEvents;
+    std::chrono::duration<double> m_Duration;
+};
 }
 
 int main(int argc, char *argv[])
 {
-    std::ifstream spikeInput(argv[1]);
-    assert(spikeInput.good());
+    // Parse event source options
+    EventSource::Config eventSourceConfig;
+    unsigned int resolution = Parameters::input_size;
+    unsigned int numLoomingTrials = 0;
+    for(int a = 1; a < argc; a++) {
+        // Rather than reading events, measure latency with a number of synthetic looming trials
+        if(strcmp(argv[a], "--looming") == 0 && (a + 1) < argc) {
+            numLoomingTrials = std::atoi(argv[++a]);
+        }
+        else if(strcmp(argv[a], "--resolution") == 0 && (a + 1) < argc) {
+            resolution = std::atoi(argv[++a]);
+
+            // Check resolution up front so invalid values are reported rather than aborting later
+            try {
+                get_centre_size(resolution);
+            }
+            catch(const std::runtime_error &ex) {
+                std::cerr << ex.what() << std::endl;
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+        else if(!EventSource::parseArg(eventSourceConfig, a, argc, argv)) {
+            std::cerr << "Unknown argument '" << argv[a] << "'" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Downsample input to runtime resolution
+    const unsigned int centreSize = get_centre_size(resolution);
+    eventSourceConfig.outputWidth = resolution;
+    eventSourceConfig.outputHeight = resolution;
 
     allocateMem();
     initialize();
 
-    build_centre_to_one_connection(Parameters::input_size, Parameters::centre_size,
+    build_centre_to_one_connection(resolution, centreSize,
                                    CP_F_LGMD, &allocateP_F_LGMD);
-    build_centre_to_one_connection(Parameters::input_size, Parameters::centre_size,
+    build_centre_to_one_connection(resolution, centreSize,
                                    CS_LGMD, &allocateS_LGMD);
-    build_one_to_one_connection(Parameters::input_size,
+    build_one_to_one_connection(resolution,
                                 CP_E_S, &allocateP_E_S);
-    build_i_s_connections(Parameters::input_size, Parameters::centre_size,
+    build_i_s_connections(resolution, centreSize,
                           CP_I_S_1, &allocateP_I_S_1,
                           CP_I_S_2, &allocateP_I_S_2,
                           CP_I_S_4, &allocateP_I_S_4);
 
-    initlgmd();
-
-    // Read first line of input
-    std::vector<unsigned int> inputIndices;
-    unsigned int nextInputTime = read_p_input(Parameters::input_size, 128, spikeInput, inputIndices);
-
-    SpikeCSVRecorder lgmdSpikeRecorder("lgmd_spikes.csv", glbSpkCntLGMD, glbSpkLGMD);
-    AnalogueCSVRecorder<scalar> sVoltageRecorder("s_voltages.csv", VS, Parameters::input_size * Parameters::input_size, "Voltage [mV]");
-    AnalogueCSVRecorder<scalar> lgmdVoltageRecorder("lgmd_voltages.csv", VLGMD, 1, "Voltage [mV]");
+    // Scale convergent weights to size of centre
+    const double convergentScale = get_convergent_scale(centreSize);
+    std::fill_n(gP_F_LGMD, CP_F_LGMD.connN, (scalar)(convergentScale * Parameters::p_f_lgmd_weight));
+    std::fill_n(gS_LGMD, CS_LGMD.connN, (scalar)(convergentScale * Parameters::s_lgmd_weight));
 
-    // Loop through timesteps until there is no more import
-    unsigned int numS = 0;
-    unsigned int numL = 0;
-    for(unsigned int i = 0; nextInputTime < std::numeric_limits<unsigned int>::max(); i++)
-    {
-        // If we should supply input this timestep
-        if(nextInputTime == i) {
-            // Copy into spike source
-            spikeCount_P = inputIndices.size();
-            std::copy(inputIndices.cbegin(), inputIndices.cend(), &spike_P[0]);
-
-#ifndef CPU_ONLY
-            // Copy to GPU
-            pushPCurrentSpikesToDevice();
-#endif
-
-            // Read NEXT input
-            nextInputTime = read_p_input(Parameters::input_size, 128, spikeInput, inputIndices);
-        }
+    initlgmd();
 
-        // Simulate
-#ifndef CPU_ONLY
-        stepTimeGPU();
+    if(numLoomingTrials > 0) {
+        const LoomingStimulus stimulus;
+        LoomingEventSource looming(stimulus, resolution, DT, numLoomingTrials,
+                                   EventSource::convertPolarity<LoomingEventSource::Polarity>(eventSourceConfig.polarity));
+        LatencyRecorder latencyRecorder(stimulus, DT);
 
-        pullLGMDStateFromDevice();
-        pullLGMDCurrentSpikesFromDevice();
-        pullSStateFromDevice();
-        pullSCurrentSpikesFromDevice();
-#else
-        stepTimeCPU();
-#endif
+        SimulationLoop simulationLoop(resolution, &latencyRecorder);
+        EventSource::runSource(eventSourceConfig, looming, simulationLoop);
 
-        numS += spikeCount_S;
-        numL += spikeCount_LGMD;
-
-        sVoltageRecorder.record(t);
-        lgmdVoltageRecorder.record(t);
-        lgmdSpikeRecorder.record(t);
+        simulationLoop.printStats();
+        latencyRecorder.printReport();
     }
+    else {
+        SimulationLoop simulationLoop(resolution);
+        EventSource::run(eventSourceConfig, simulationLoop);
 
-    std::cout << numS << " S spikes, " << numL << " LGMD spikes" << std::endl;
+        simulationLoop.printStats();
+    }
 
 
   return 0;
-}
\ No newline at end of file
+}
@@ -52,8 +52,7 @@ void modelDefinition(NNmodel &model)
         0.0,        // 3 - Vreset
         0.3,        // 4 - Vthresh
         0.0,        // 5 - Ioffset
-        1.0,        // 6 - TauRefrac
-        32          // 7 - Resolution
+        1.0         // 6 - TauRefrac
     );
     
     // LIF model parameters for P population
@@ -87,12 +86,13 @@ void modelDefinition(NNmodel &model)
         0.0);       // 1 - RefracTime
     
     // Static synapse parameters
+    // **NOTE** convergent weights are overwritten at runtime to match centre size
     WeightUpdateModels::StaticPulse::VarValues p_f_lgmd_static_syn_init(
-        -Parameters::convergent_scale * 0.04 * 5.0 * 0.2);      // 0 - Wij (nA)
+        Parameters::convergent_scale * Parameters::p_f_lgmd_weight);      // 0 - Wij (nA)
 
     // **THINK** final constant is magic scale factor
     WeightUpdateModels::StaticPulse::VarValues s_lgmd_static_syn_init(
-        Parameters::convergent_scale * 0.04 * 2.0 * 5.0);     // 0 - Wij (nA)
+        Parameters::convergent_scale * Parameters::s_lgmd_weight);     // 0 - Wij (nA)
 
     WeightUpdateModels::StaticPulse::VarValues p_e_s_static_syn_init(
         0.6);     // 0 - Wij (nA)
@@ -122,9 +122,15 @@ void modelDefinition(NNmodel &model)
     // Neuron populations
     //------------------------------------------------------------------------
     // Create IF_curr neuron
-    model.addNeuronPopulation<OpenCVLIF>("P", Parameters::input_size * Parameters::input_size,
+#ifdef DVS_EMULATOR
+    // **NOTE** when emulating a DVS, P is driven by sparse events rather than dense frame differences
+    model.addNeuronPopulation<NeuronModels::SpikeSource>("P", Parameters::max_input_size * Parameters::max_input_size,
+                                                         {}, {});
+#else
+    model.addNeuronPopulation<OpenCVLIF>("P", Parameters::max_input_size * Parameters::max_input_size,
                                          p_lif_params, opencl_lif_init);
-    model.addNeuronPopulation<LIF>("S", Parameters::input_size * Parameters::input_size,
+#endif
+    model.addNeuronPopulation<LIF>("S", Parameters::max_input_size * Parameters::max_input_size,
                                    s_lif_params, lif_init);
 
     model.addNeuronPopulation<LIF>("LGMD", 1,
@@ -134,13 +140,13 @@ void modelDefinition(NNmodel &model)
     // Synapse populations
     //------------------------------------------------------------------------
     model.addSynapsePopulation<WeightUpdateModels::StaticPulse, ExpCurr>(
-        "P_F_LGMD", SynapseMatrixType::SPARSE_GLOBALG, 3,
+        "P_F_LGMD", SynapseMatrixType::SPARSE_INDIVIDUALG, 3,
         "P", "LGMD",
         {}, p_f_lgmd_static_syn_init,
         p_f_lgmd_exp_curr_params, {});
 
     model.addSynapsePopulation<WeightUpdateModels::StaticPulse, PostsynapticModels::DeltaCurr>(
-        "S_LGMD", SynapseMatrixType::SPARSE_GLOBALG, 1,
+        "S_LGMD", SynapseMatrixType::SPARSE_INDIVIDUALG, 1,
         "S", "LGMD",
         {}, s_lgmd_static_syn_init,
         {}, {});
@@ -1,19 +1,33 @@
 // Standard C++ includes
+#include <algorithm>
+#include <chrono>
 #include <fstream>
+#include <iostream>
 #include <limits>
+#include <memory>
 #include <set>
 #include <sstream>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 // Standard C includes
 #include <cassert>
+#include <cmath>
 #include <cstdlib>
+#include <cstring>
 
 // OpenCV includes
 #include <opencv2/highgui/highgui.hpp>
 
 // Common example code
+#include "../common/dvs_emulator.h"
+#include "../common/frame_source.h"
+#include "../common/latency_recorder.h"
 #include "../common/opencv_dvs.h"
+#include "../common/realtime.h"
+#include "../common/realtime_scheduler.h"
+#include "../common/spike_image_renderer.h"
 #include "../common/timer.h"
 
 // LGMD includes
@@ -34,6 +48,27 @@ unsigned int get_neuron_index(unsigned int resolution, unsigned int x, unsigned
     return x + (y * resolution);
 }
 
+unsigned int get_centre_size(unsigned int resolution)
+{
+    // Scale border around centre to cover same fraction of input as at default resolution
+    const double border_fraction = (double)(Parameters::input_size - Parameters::centre_size) / (double)(2 * Parameters::input_size);
+    const unsigned int border_size = (unsigned int)std::round((double)resolution * border_fraction);
+
+    // Populations must be large enough and I-S connections reach two pixels beyond centre
+    if(resolution > Parameters::max_input_size) {
+        throw std::runtime_error("Resolution " + std::to_string(resolution) + " exceeds maximum of " + std::to_string(Parameters::max_input_size));
+    }
+    else if(border_size < 2) {
+        throw std::runtime_error("Resolution " + std::to_string(resolution) + " too small");
+    }
+    return resolution - (2 * border_size);
+}
+
+double get_convergent_scale(unsigned int centre_size)
+{
+    return ((16.0 * 16.0) / ((double)centre_size * (double)centre_size));
+}
+
 void print_sparse_matrix(unsigned int pre_resolution, const SparseProjection &projection)
 {
     const unsigned int pre_size = pre_resolution * pre_resolution;
@@ -50,11 +85,14 @@ void print_sparse_matrix(unsigned int pre_resolution, const SparseProjection &pr
     }
 }
 
+// **NOTE** populations are sized for Parameters::max_input_size so rows
+// of neurons beyond the runtime resolution are left empty
 void build_one_to_one_connection(unsigned int resolution,
                                  SparseProjection &projection, allocateFn allocate)
 {
     // Allocate one connection per neuron
     const unsigned int pop_size = resolution * resolution;
+    const unsigned int max_pop_size = Parameters::max_input_size * Parameters::max_input_size;
     allocate(pop_size);
 
     for(unsigned int i = 0; i < pop_size; i++)
@@ -63,7 +101,7 @@ void build_one_to_one_connection(unsigned int resolution,
         projection.ind[i] = i;
     }
 
-    projection.indInG[pop_size] = pop_size;
+    std::fill(&projection.indInG[pop_size], &projection.indInG[max_pop_size + 1], pop_size);
 }
 
 void build_centre_to_one_connection(unsigned int pre_resolution, unsigned int centre_size,
@@ -92,8 +130,9 @@ void build_centre_to_one_connection(unsigned int pre_resolution, unsigned int ce
         }
     }
 
-    // Add ending entry to data structure
-    projection.indInG[i] = s;
+    // Add empty rows for unused neurons and ending entry to data structure
+    const unsigned int max_pop_size = Parameters::max_input_size * Parameters::max_input_size;
+    std::fill(&projection.indInG[i], &projection.indInG[max_pop_size + 1], s);
 
     // Check
     assert(s == (centre_size * centre_size));
@@ -106,6 +145,7 @@ void build_i_s_connections(unsigned int resolution, unsigned int centre_size,
                            SparseProjection &projection4, allocateFn allocate4)
 {
     const unsigned int pop_size = resolution * resolution;
+    const unsigned int max_pop_size = Parameters::max_input_size * Parameters::max_input_size;
     
     // Allocate sparse projections
     allocate1(centre_size * centre_size * 4);
@@ -167,53 +207,160 @@ void build_i_s_connections(unsigned int resolution, unsigned int centre_size,
         s4 += projection4Map[i].size();
     }
 
-    // Add ending entries to data structure
-    projection1.indInG[pop_size] = s1;
-    projection2.indInG[pop_size] = s2;
-    projection4.indInG[pop_size] = s4;
+    // Add empty rows for unused neurons and ending entries to data structure
+    std::fill(&projection1.indInG[pop_size], &projection1.indInG[max_pop_size + 1], s1);
+    std::fill(&projection2.indInG[pop_size], &projection2.indInG[max_pop_size + 1], s2);
+    std::fill(&projection4.indInG[pop_size], &projection4.indInG[max_pop_size + 1], s4);
 
     // Check
     assert(s1 == (centre_size * centre_size * 4));
     assert(s2 == (centre_size * centre_size * 4));
     assert(s4 == (centre_size * centre_size * 4));
 }
+
+void print_usage(const char *executable)
+{
+    std::cerr << "Usage: " << executable << " [--sync] [--no-interpolate] [--headless] [--frames N] [--resolution N] [--latency TRIALS]"
+        << " [--overrun POLICY] [realtime options] [frame source]" << std::endl;
+    std::cerr << "\tN must be no greater than " << Parameters::max_input_size << " and leave a border of at least two pixels around the centre" << std::endl;
+    std::cerr << "\tModel was generated for " << Parameters::max_input_size << "x" << Parameters::max_input_size
+        << " inputs and all of these neurons are updated every timestep - lower resolutions only reduce input and synaptic cost" << std::endl;
+}
 }   // Anonymous namespace
 
 int main(int argc, char *argv[])
 {
-    const unsigned int device = (argc > 1) ? std::atoi(argv[1]) : 0;
-#ifndef CPU_ONLY
-    OpenCVDVSGPU dvs(device, 32);
+    // Parse frame source (camera device, video file or synthetic stimulus) and options
+    std::string frameSourceSpec = "0";
+    bool asynchronous = true;
+    bool interpolate = true;
+    bool headless = false;
+    unsigned int maxFrames = 0;
+    unsigned int numLatencyTrials = 0;
+    unsigned int resolution = Parameters::input_size;
+    RealtimeScheduler::OverrunPolicy overrunPolicy = RealtimeScheduler::OverrunPolicy::Skip;
+    Realtime::Config realtimeConfig;
+    for(int a = 1; a < argc; a++) {
+        if(strcmp(argv[a], "--sync") == 0) {
+            asynchronous = false;
+        }
+        else if(strcmp(argv[a], "--no-interpolate") == 0) {
+            interpolate = false;
+        }
+        else if(strcmp(argv[a], "--headless") == 0) {
+            headless = true;
+        }
+        else if(strcmp(argv[a], "--frames") == 0 && (a + 1) < argc) {
+            maxFrames = std::atoi(argv[++a]);
+        }
+        else if(strcmp(argv[a], "--resolution") == 0 && (a + 1) < argc) {
+            resolution = std::atoi(argv[++a]);
+
+            // Check resolution up front so invalid values are reported rather than aborting later
+            try {
+                get_centre_size(resolution);
+            }
+            catch(const std::runtime_error &ex) {
+                std::cerr << ex.what() << std::endl;
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+        else if(strcmp(argv[a], "--latency") == 0 && (a + 1) < argc) {
+            numLatencyTrials = std::atoi(argv[++a]);
+        }
+        else if(strcmp(argv[a], "--overrun") == 0 && (a + 1) < argc) {
+            overrunPolicy = RealtimeScheduler::parsePolicy(argv[++a]);
+        }
+        else if(!Realtime::parseArg(realtimeConfig, a, argc, argv)) {
+            frameSourceSpec = argv[a];
+        }
+    }
+
+    // Scale centre region connected to LGMD to runtime resolution
+    const unsigned int centreSize = get_centre_size(resolution);
+
+    // Latency measurements are made headless using a fixed number of trials of a synthetic looming stimulus
+    const LoomingStimulus loomingStimulus;
+    std::unique_ptr<FrameSource> frameSource;
+    if(numLatencyTrials > 0) {
+        headless = true;
+        frameSource.reset(new LoomingFrameSource(loomingStimulus));
+    }
+    else {
+        frameSource = createFrameSource(frameSourceSpec);
+    }
+    const unsigned int maxTimesteps = (unsigned int)std::ceil((loomingStimulus.getTrialDuration() * 1000.0 * (double)numLatencyTrials) / DT);
+    LatencyRecorder latencyRecorder(loomingStimulus, DT);
+
+    // **NOTE** headless runs are for reproducible benchmarking so capture frames synchronously
+    // **NOTE** asynchronous capture never blocks so, otherwise, the simulation must be paced to real-time
+    // to stop it running ahead of the camera - --overrun only selects what happens when it falls behind
+    // **NOTE** DVS emulator requires down-sampled frames on the host
+    const bool asyncCapture = asynchronous && !headless;
+#if defined(CPU_ONLY) || defined(DVS_EMULATOR)
+    OpenCVDVSCPU dvs(*frameSource, resolution, false, asyncCapture);
+#else
+    OpenCVDVSGPU dvs(*frameSource, resolution, false, asyncCapture);
+#endif
+    dvs.setTimestep(DT);
+
+#ifdef DVS_EMULATOR
+    // Convert frames into sparse events which drive P spike source
+    DVSEmulator dvsEmulator(dvs, resolution, Parameters::emulator_threshold,
+                            DVSEmulator::Polarity::Both, interpolate, Parameters::emulator_max_spread);
+    TimeSurfaceRenderer pSpikeRenderer(resolution, resolution, Parameters::emulator_spike_persistence);
+    cv::Mat pSpikeImage(resolution, resolution, CV_32FC1);
+    const char *pWindowName = "P spikes";
 #else
-    OpenCVDVSCPU dvs(device, 32);
+    const char *pWindowName = "P Membrane voltage";
 #endif
     
     // Configure windows which will be used to show down-sampled images
-    cv::namedWindow("Downsampled frame", CV_WINDOW_NORMAL);
-    cv::namedWindow("Frame difference", CV_WINDOW_NORMAL);
-    cv::namedWindow("P Membrane voltage", CV_WINDOW_NORMAL);
-    cv::namedWindow("S Membrane voltage", CV_WINDOW_NORMAL);
-    cv::resizeWindow("Downsampled frame", 320, 320);
-    cv::resizeWindow("Frame difference", 320, 320);
-    cv::resizeWindow("P Membrane voltage", 320, 320);
-    cv::resizeWindow("S Membrane voltage", 320, 320);
+    if(!headless) {
+        cv::namedWindow("Downsampled frame", CV_WINDOW_NORMAL);
+        cv::namedWindow("Frame difference", CV_WINDOW_NORMAL);
+        cv::namedWindow(pWindowName, CV_WINDOW_NORMAL);
+        cv::namedWindow("S Membrane voltage", CV_WINDOW_NORMAL);
+        cv::resizeWindow("Downsampled frame", 320, 320);
+        cv::resizeWindow("Frame difference", 320, 320);
+        cv::resizeWindow(pWindowName, 320, 320);
+        cv::resizeWindow("S Membrane voltage", 320, 320);
+    }
     
     allocateMem();
     initialize();
 
-    build_centre_to_one_connection(Parameters::input_size, Parameters::centre_size,
+    build_centre_to_one_connection(resolution, centreSize,
                                    CP_F_LGMD, &allocateP_F_LGMD);
-    build_centre_to_one_connection(Parameters::input_size, Parameters::centre_size,
+    build_centre_to_one_connection(resolution, centreSize,
                                    CS_LGMD, &allocateS_LGMD);
-    build_one_to_one_connection(Parameters::input_size,
+    build_one_to_one_connection(resolution,
                                 CP_E_S, &allocateP_E_S);
-    build_i_s_connections(Parameters::input_size, Parameters::centre_size,
+    build_i_s_connections(resolution, centreSize,
                           CP_I_S_1, &allocateP_I_S_1,
                           CP_I_S_2, &allocateP_I_S_2,
                           CP_I_S_4, &allocateP_I_S_4);
 
+    // Scale convergent weights to size of centre
+    const double convergentScale = get_convergent_scale(centreSize);
+    std::fill_n(gP_F_LGMD, CP_F_LGMD.connN, (scalar)(convergentScale * Parameters::p_f_lgmd_weight));
+    std::fill_n(gS_LGMD, CS_LGMD.connN, (scalar)(convergentScale * Parameters::s_lgmd_weight));
+
     initlgmd_opencv();
 
+#ifndef DVS_EMULATOR
+    // Tell P population the resolution of the input it's receiving
+    resolutionP = resolution;
+#endif
+
+    // Apply any requested realtime configuration - display runs on the simulation thread
+    if(realtimeConfig.displayCore >= 0) {
+        std::cerr << "--display-core has no effect as display runs on the simulation thread - use --simulation-core" << std::endl;
+    }
+    dvs.configureCaptureThread(realtimeConfig.inputCore, realtimeConfig.priority);
+    Realtime::configureSimulationThread(realtimeConfig);
+
     // Loop through timesteps until there is no more import
     double dvsUpdate = 0.0;
     double dvsRender = 0.0;
@@ -221,16 +368,37 @@ int main(int argc, char *argv[])
     double download = 0.0;
     double outputRender = 0.0;
     double eventProcessing = 0.0;
-    for(unsigned int i = 0;; i++)
+    unsigned int numLGMDSpikes = 0;
+    RealtimeScheduler scheduler(DT, overrunPolicy);
+    scheduler.start();
+    const auto start = std::chrono::high_resolution_clock::now();
+    unsigned int i;
+    for(i = 0; !dvs.isFinished() && (maxFrames == 0 || dvs.getNumFramesCaptured() < maxFrames)
+        && (maxTimesteps == 0 || i < maxTimesteps); i++)
     {
+        // If capture is asynchronous, pace to real-time by waiting for this tick's deadline
+        const auto tick = asyncCapture ? scheduler.waitForNextTick() : RealtimeScheduler::Tick{0, false};
+        const bool display = !headless && !tick.degrade;
+
         // Read DVS state and put result into GeNN
         {
             ProfilingTimer t(dvsUpdate);
+#ifdef DVS_EMULATOR
+            dvsEmulator.readEvents(spikeCount_P, spike_P);
+            pSpikeRenderer.update(spikeCount_P, spike_P);
+#ifndef CPU_ONLY
+            pushPCurrentSpikesToDevice();
+#endif
+#else
             tie(inputCurrentsP, stepP) = dvs.update(i);
+#endif
+        }
+        if(numLatencyTrials > 0 && dvs.isNewFrame()) {
+            latencyRecorder.recordInput(i);
         }
 
-        // Show raw frame and difference with previous
-        {
+        // Show raw frame and difference with previous unless we're headless or behind schedule
+        if(display) {
             ProfilingTimer t(dvsRender);
             dvs.showDownsampledFrame("Downsampled frame", i);
             dvs.showFrameDifference("Frame difference");
@@ -247,7 +415,9 @@ int main(int argc, char *argv[])
         {
             ProfilingTimer t(download);
             
+#ifndef DVS_EMULATOR
             pullPStateFromDevice();
+#endif
             pullSStateFromDevice();
             pullLGMDCurrentSpikesFromDevice();
         }
@@ -261,32 +431,61 @@ int main(int argc, char *argv[])
         {
             ProfilingTimer t(outputRender);
             
-            cv::Mat wrappedPVoltage(32, 32, CV_32FC1, VP);
-            cv::imshow("P Membrane voltage", wrappedPVoltage);
-            
-            cv::Mat wrappedSVoltage(32, 32, CV_32FC1, VS);
-            cv::imshow("S Membrane voltage", wrappedSVoltage);
+            if(display) {
+#ifdef DVS_EMULATOR
+                pSpikeRenderer.render(pSpikeImage);
+                cv::imshow(pWindowName, pSpikeImage);
+#else
+                cv::Mat wrappedPVoltage(resolution, resolution, CV_32FC1, VP);
+                cv::imshow(pWindowName, wrappedPVoltage);
+#endif
+                
+                cv::Mat wrappedSVoltage(resolution, resolution, CV_32FC1, VS);
+                cv::imshow("S Membrane voltage", wrappedSVoltage);
+            }
             
             if(spikeCount_LGMD > 0) {
-                std::cout << "LGMD SPIKE" << std::endl;
+                numLGMDSpikes++;
+                if(numLatencyTrials > 0) {
+                    latencyRecorder.recordSpike(i);
+                }
+                if(!headless) {
+                    std::cout << "LGMD SPIKE" << std::endl;
+                }
             }
         }
         
         // **YUCK** required for OpenCV GUI to do anything
-        {
+        if(display) {
             ProfilingTimer t(eventProcessing);
             
             if(cv::waitKey(1) == 27) {
-                std::cout << "DVS update:" << dvsUpdate / (double)i << std::endl;
-                std::cout << "DVS render:" << dvsRender / (double)i  << std::endl;
-                std::cout << "Simulation step:" << simulationStep / (double)i  << std::endl;
-                std::cout << "Download:" << download / (double)i  << std::endl;
-                std::cout << "Output render:" << outputRender / (double)i  << std::endl;
-                std::cout << "Event processing:" << eventProcessing / (double)i  << std::endl;
                 break;
             }
         }
     }
+    const double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+    std::cout << "Resolution: " << resolution << "x" << resolution << " (model generated for " << Parameters::max_input_size << "x" << Parameters::max_input_size << ")" << std::endl;
+    std::cout << "Ran " << i << " timesteps in " << seconds << "s: " << (double)i / seconds << " steps/s, "
+        << (double)dvs.getNumFramesCaptured() / seconds << " frames/s, " << numLGMDSpikes << " LGMD spikes" << std::endl;
+
+    std::cout << "DVS update:" << dvsUpdate / (double)i << std::endl;
+    std::cout << "DVS render:" << dvsRender / (double)i  << std::endl;
+    std::cout << "Simulation step:" << simulationStep / (double)i  << std::endl;
+    std::cout << "Download:" << download / (double)i  << std::endl;
+    std::cout << "Output render:" << outputRender / (double)i  << std::endl;
+    std::cout << "Event processing:" << eventProcessing / (double)i  << std::endl;
+    dvs.printFrameStats();
+#ifdef DVS_EMULATOR
+    std::cout << "DVS emulator: " << dvsEmulator.getNumEvents() << " events, " << dvsEmulator.getNumDroppedEvents() << " dropped" << std::endl;
+#endif
+    if(asyncCapture) {
+        scheduler.printStats();
+    }
+    if(numLatencyTrials > 0) {
+        latencyRecorder.printReport();
+    }
     
     
 
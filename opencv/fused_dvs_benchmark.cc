@@ -0,0 +1,93 @@
+// Standard C++ includes
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+// Standard C includes
+#include <cstdlib>
+
+// OpenCV includes
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+// Common example includes
+#include "../common/fused_dvs_kernel.h"
+
+//----------------------------------------------------------------------------
+// Anonymous namespace
+//----------------------------------------------------------------------------
+namespace
+{
+constexpr unsigned int resolution = 32;
+constexpr unsigned int numIterations = 200;
+
+// Run the separate cvtColor, convertTo, resize and subtract passes used by OpenCVDVSCPU
+void runOpenCV(const cv::Mat &squareROI, cv::Mat &greyscale, cv::Mat &current, const cv::Mat &previous,
+               cv::Mat &difference, int interpolation)
+{
+    cv::cvtColor(squareROI, greyscale, CV_BGR2GRAY);
+    greyscale.convertTo(greyscale, CV_32FC1, 1.0 / 255.0);
+    cv::resize(greyscale, current, cv::Size(resolution, resolution), 0.0, 0.0, interpolation);
+    cv::subtract(current, previous, difference);
+}
+
+template<typename F>
+double timeMs(F f)
+{
+    const auto start = std::chrono::high_resolution_clock::now();
+    for(unsigned int i = 0; i < numIterations; i++) {
+        f();
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / (double)numIterations;
+}
+}   // Anonymous namespace
+
+int main()
+{
+    // Common camera resolutions
+    const cv::Size cameraSizes[] = {{320, 240}, {640, 480}, {1280, 720}, {1920, 1080}};
+
+    for(const auto &cameraSize : cameraSizes) {
+        // Generate smooth random frame so results are representative of camera images
+        cv::Mat noise(cameraSize.height / 8, cameraSize.width / 8, CV_8UC3);
+        cv::randu(noise, cv::Scalar::all(0), cv::Scalar::all(255));
+        cv::Mat frame;
+        cv::resize(noise, frame, cameraSize, 0.0, 0.0, cv::INTER_CUBIC);
+
+        // Take square ROI in the same way as OpenCVDVS
+        const int margin = (cameraSize.width - cameraSize.height) / 2;
+        const cv::Mat squareROI = frame(cv::Rect(margin, 0, cameraSize.height, cameraSize.height));
+
+        cv::Mat previous(resolution, resolution, CV_32FC1, cv::Scalar(0.5f));
+        cv::Mat greyscale;
+        cv::Mat openCVCurrent(resolution, resolution, CV_32FC1);
+        cv::Mat openCVDifference(resolution, resolution, CV_32FC1);
+        cv::Mat fusedCurrent(resolution, resolution, CV_32FC1);
+        cv::Mat fusedDifference(resolution, resolution, CV_32FC1);
+        FusedDVSKernel kernel(resolution);
+
+        // Time existing pipeline with its default bilinear and with area interpolation
+        const double linearMs = timeMs([&](){ runOpenCV(squareROI, greyscale, openCVCurrent, previous, openCVDifference, cv::INTER_LINEAR); });
+        const double areaMs = timeMs([&](){ runOpenCV(squareROI, greyscale, openCVCurrent, previous, openCVDifference, cv::INTER_AREA); });
+
+        // Time fused kernel
+        const double fusedMs = timeMs(
+            [&]()
+            {
+                kernel.process(squareROI.data, squareROI.step, squareROI.rows,
+                               reinterpret_cast<float*>(fusedCurrent.data), reinterpret_cast<const float*>(previous.data),
+                               reinterpret_cast<float*>(fusedDifference.data), false);
+            });
+
+        // Compare fused difference with area-interpolated OpenCV pipeline
+        cv::Mat error;
+        cv::absdiff(openCVDifference, fusedDifference, error);
+        double maxError;
+        cv::minMaxLoc(error, nullptr, &maxError);
+
+        std::cout << cameraSize.width << "x" << cameraSize.height << ": OpenCV (linear) " << linearMs << "ms, OpenCV (area) " << areaMs
+            << "ms, fused " << fusedMs << "ms (" << areaMs / fusedMs << "x), max error vs area " << maxError * 255.0 << "/255" << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
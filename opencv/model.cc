@@ -39,8 +39,7 @@ void modelDefinition(NNmodel &model)
         0.0,        // 3 - Vreset
         0.3,        // 4 - Vthresh
         0.0,        // 5 - Ioffset
-        1.0,        // 6 - TauRefrac
-        32          // 7 - Resolution
+        1.0         // 6 - TauRefrac
     );
 
     // LIF initial conditions
@@ -4,18 +4,23 @@
 #include <iostream>
 #include <set>
 #include <sstream>
+#include <string>
 #include <vector>
 
 // Standard C includes
 #include <cassert>
 #include <cstdlib>
+#include <cstring>
 
 // OpenCV includes
 #include <opencv2/highgui/highgui.hpp>
 
 // Common example code
 #include "../common/analogue_csv_recorder.h"
+#include "../common/frame_source.h"
 #include "../common/opencv_dvs.h"
+#include "../common/realtime_scheduler.h"
+#include "../common/timer.h"
 
 #include "opencv_CODE/definitions.h"
 
@@ -23,50 +28,133 @@
 
 int main(int argc, char *argv[])
 {
-    const unsigned int device = (argc > 1) ? std::atoi(argv[1]) : 0;
+    // Parse frame source (camera device, video file or synthetic stimulus) and options
+    std::string frameSourceSpec = "0";
+    bool asynchronous = true;
+#ifdef CPU_ONLY
+    bool fused = false;
+#endif
+    bool headless = false;
+    unsigned int maxFrames = 0;
+    RealtimeScheduler::OverrunPolicy overrunPolicy = RealtimeScheduler::OverrunPolicy::Skip;
+    for(int a = 1; a < argc; a++) {
+        if(strcmp(argv[a], "--sync") == 0) {
+            asynchronous = false;
+        }
+        else if(strcmp(argv[a], "--fused") == 0) {
+#ifdef CPU_ONLY
+            fused = true;
+#else
+            // Fused kernel is only implemented for OpenCVDVSCPU
+            std::cerr << "--fused is only supported in CPU_ONLY builds - ignoring" << std::endl;
+#endif
+        }
+        else if(strcmp(argv[a], "--headless") == 0) {
+            headless = true;
+        }
+        else if(strcmp(argv[a], "--frames") == 0 && (a + 1) < argc) {
+            maxFrames = std::atoi(argv[++a]);
+        }
+        else if(strcmp(argv[a], "--overrun") == 0 && (a + 1) < argc) {
+            overrunPolicy = RealtimeScheduler::parsePolicy(argv[++a]);
+        }
+        else {
+            frameSourceSpec = argv[a];
+        }
+    }
+
+    // **NOTE** headless runs are for reproducible benchmarking so capture frames synchronously
+    // **NOTE** asynchronous capture never blocks so, otherwise, the simulation must be paced to real-time
+    // to stop it running ahead of the camera - --overrun only selects what happens when it falls behind
+    const bool asyncCapture = asynchronous && !headless;
+    auto frameSource = createFrameSource(frameSourceSpec);
 #ifndef CPU_ONLY
-    OpenCVDVSGPU dvs(device, 32);
+    OpenCVDVSGPU dvs(*frameSource, 32, false, asyncCapture);
 #else
-    OpenCVDVSCPU dvs(device, 32);
+    OpenCVDVSCPU dvs(*frameSource, 32, false, asyncCapture, fused);
 #endif
+    dvs.setTimestep(DT);
     
     // Configure windows which will be used to show down-sampled images
-    cv::namedWindow("Downsampled frame", CV_WINDOW_NORMAL);
-    cv::namedWindow("Frame difference", CV_WINDOW_NORMAL);
-    cv::namedWindow("P Membrane voltage", CV_WINDOW_NORMAL);
-    cv::resizeWindow("Downsampled frame", 320, 320);
-    cv::resizeWindow("Frame difference", 320, 320);
-    cv::resizeWindow("P Membrane voltage", 320, 320);
+    if(!headless) {
+        cv::namedWindow("Downsampled frame", CV_WINDOW_NORMAL);
+        cv::namedWindow("Frame difference", CV_WINDOW_NORMAL);
+        cv::namedWindow("P Membrane voltage", CV_WINDOW_NORMAL);
+        cv::resizeWindow("Downsampled frame", 320, 320);
+        cv::resizeWindow("Frame difference", 320, 320);
+        cv::resizeWindow("P Membrane voltage", 320, 320);
+    }
     
     allocateMem();
     initialize();
     
     initopencv();
 
-    for(unsigned int i = 0;; i++)
+    // Tell P population the resolution of the input it's receiving
+    resolutionP = 32;
+
+    double dvsUpdate = 0.0;
+    double simulationStep = 0.0;
+    double render = 0.0;
+    double total = 0.0;
+    RealtimeScheduler scheduler(DT, overrunPolicy);
+    scheduler.start();
+    unsigned int i;
     {
-        // Read DVS state and put result into GeNN
-        tie(inputCurrentsP, stepP) = dvs.update(i);
+        TimerAccumulate<> totalTimer(total);
+        for(i = 0; !dvs.isFinished() && (maxFrames == 0 || dvs.getNumFramesCaptured() < maxFrames); i++)
+        {
+            // If capture is asynchronous, pace to real-time by waiting for this tick's deadline
+            const auto tick = asyncCapture ? scheduler.waitForNextTick() : RealtimeScheduler::Tick{0, false};
+            const bool display = !headless && !tick.degrade;
+
+            // Read DVS state and put result into GeNN
+            {
+                TimerAccumulate<> timer(dvsUpdate);
+                tie(inputCurrentsP, stepP) = dvs.update(i);
+            }
 
-        // Show raw frame and difference with previous
-        dvs.showDownsampledFrame("Downsampled frame", i);
-        dvs.showFrameDifference("Frame difference");
+            // Show raw frame and difference with previous unless we're headless or behind schedule
+            if(display) {
+                TimerAccumulate<> timer(render);
+                dvs.showDownsampledFrame("Downsampled frame", i);
+                dvs.showFrameDifference("Frame difference");
+            }
 
-        // Simulate
+            // Simulate
+            {
+                TimerAccumulate<> timer(simulationStep);
 #ifndef CPU_ONLY
-        stepTimeGPU();
+                stepTimeGPU();
 
-        pullPStateFromDevice();
+                pullPStateFromDevice();
 #else
-        stepTimeCPU();
+                stepTimeCPU();
 #endif
-        
-        cv::Mat wrappedVoltage(32, 32, CV_32FC1, VP);
-        cv::imshow("P Membrane voltage", wrappedVoltage);
-        // **YUCK** required for OpenCV GUI to do anything
-        cv::waitKey(1);
+            }
+            
+            if(display) {
+                TimerAccumulate<> timer(render);
+                cv::Mat wrappedVoltage(32, 32, CV_32FC1, VP);
+                cv::imshow("P Membrane voltage", wrappedVoltage);
+
+                // **YUCK** required for OpenCV GUI to do anything
+                if(cv::waitKey(1) == 27) {
+                    break;
+                }
+            }
+        }
     }
 
+    const double seconds = total / 1000.0;
+    std::cout << "Ran " << i << " timesteps in " << seconds << "s: " << (double)i / seconds << " steps/s, "
+        << (double)dvs.getNumFramesCaptured() / seconds << " frames/s" << std::endl;
+    std::cout << "DVS update:" << dvsUpdate / (double)i << "ms, Simulation step:" << simulationStep / (double)i
+        << "ms, Render:" << render / (double)i << "ms" << std::endl;
+    dvs.printFrameStats();
+    if(asyncCapture) {
+        scheduler.printStats();
+    }
 
     return 0;
-}
\ No newline at end of file
+}
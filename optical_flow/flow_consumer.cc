@@ -0,0 +1,149 @@
+// Standard C++ includes
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+// Standard C includes
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// Optical flow includes
+#include "flow_stream.h"
+
+//----------------------------------------------------------------------------
+// Anonymous namespace
+//----------------------------------------------------------------------------
+namespace
+{
+volatile std::sig_atomic_t g_SignalStatus;
+
+void signalHandler(int status)
+{
+    g_SignalStatus = status;
+}
+
+//----------------------------------------------------------------------------
+// Stats
+//----------------------------------------------------------------------------
+//! Statistics about received datagrams over an interval
+struct Stats
+{
+    Stats() : numReceived(0), numLost(0), numCells(0), sumMagnitude(0.0), sumLatency(0.0), maxLatency(0.0)
+    {
+    }
+
+    void add(const Stats &other)
+    {
+        numReceived += other.numReceived;
+        numLost += other.numLost;
+        numCells += other.numCells;
+        sumMagnitude += other.sumMagnitude;
+        sumLatency += other.sumLatency;
+        maxLatency = std::max(maxLatency, other.maxLatency);
+    }
+
+    void print(const char *title, double seconds) const
+    {
+        std::cout << title << ": " << numReceived << " flow fields (" << (double)numReceived / seconds << "/s), "
+            << numLost << " lost, " << ((numReceived == 0) ? 0.0 : ((double)numCells / (double)numReceived)) << " cells per field, "
+            << "mean magnitude " << ((numCells == 0) ? 0.0 : (sumMagnitude / (double)numCells)) << ", latency mean "
+            << ((numReceived == 0) ? 0.0 : (sumLatency / (double)numReceived)) << "us, max " << maxLatency << "us" << std::endl;
+    }
+
+    unsigned long long numReceived;
+    unsigned long long numLost;
+    unsigned long long numCells;
+    double sumMagnitude;
+    double sumLatency;
+    double maxLatency;
+};
+
+//! Decode cells and accumulate them into stats, checking they lie within the flow field
+template<typename T>
+void decodeCells(const FlowStream::Receiver &receiver, const FlowStream::Header *header, Stats &stats)
+{
+    const auto *cells = receiver.getCells<T>(header);
+    for(unsigned int c = 0; c < header->numCells; c++) {
+        if(cells[c].index >= (header->size * header->size)) {
+            throw std::runtime_error("Flow cell index " + std::to_string(cells[c].index) + " out of range");
+        }
+
+        const double dx = cells[c].flow[0] * header->scale;
+        const double dy = cells[c].flow[1] * header->scale;
+        stats.sumMagnitude += std::sqrt((dx * dx) + (dy * dy));
+    }
+    stats.numCells += header->numCells;
+}
+}   // Anonymous namespace
+
+//! Test consumer which receives the flow stream published by simulator --stream,
+//! validates every datagram and reports rate, loss and transport latency every second
+int main(int argc, char *argv[])
+{
+    std::string path = "/tmp/optical_flow.sock";
+    unsigned long long maxFlowFields = 0;
+    for(int a = 1; a < argc; a++) {
+        if(strcmp(argv[a], "--count") == 0 && (a + 1) < argc) {
+            maxFlowFields = std::strtoull(argv[++a], nullptr, 10);
+        }
+        else {
+            path = argv[a];
+        }
+    }
+
+    // Catch interrupt (ctrl-c) signals
+    std::signal(SIGINT, signalHandler);
+
+    FlowStream::Receiver receiver(path);
+    std::cout << "Listening on " << path << std::endl;
+
+    Stats total;
+    Stats interval;
+    bool first = true;
+    uint32_t nextSequence = 0;
+    const uint64_t start = FlowStream::getMonotonicTime();
+    uint64_t intervalStart = start;
+    while(g_SignalStatus == 0 && (maxFlowFields == 0 || total.numReceived < maxFlowFields)) {
+        // Wait for flow field
+        const FlowStream::Header *header = receiver.receive(100);
+        const uint64_t now = FlowStream::getMonotonicTime();
+        if(header != nullptr) {
+            // Count any skipped sequence numbers as lost
+            if(!first && header->sequence != nextSequence) {
+                interval.numLost += (uint32_t)(header->sequence - nextSequence);
+            }
+            first = false;
+            nextSequence = header->sequence + 1;
+
+            // Decode cells
+            if(header->format == FlowStream::Format::Int8) {
+                decodeCells<int8_t>(receiver, header, interval);
+            }
+            else {
+                decodeCells<int16_t>(receiver, header, interval);
+            }
+
+            const double latency = (double)(now - header->sendTime) / 1000.0;
+            interval.sumLatency += latency;
+            interval.maxLatency = std::max(interval.maxLatency, latency);
+            interval.numReceived++;
+        }
+
+        // Every second, print and accumulate interval stats
+        if((now - intervalStart) >= 1000000000ull || (maxFlowFields != 0 && (total.numReceived + interval.numReceived) >= maxFlowFields)) {
+            interval.print("Interval", (double)(now - intervalStart) / 1.0E9);
+
+            total.add(interval);
+            interval = Stats();
+            intervalStart = now;
+        }
+    }
+
+    total.add(interval);
+    total.print("Total", (double)(FlowStream::getMonotonicTime() - start) / 1.0E9);
+    return EXIT_SUCCESS;
+}
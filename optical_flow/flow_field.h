@@ -0,0 +1,118 @@
+#pragma once
+
+// Standard C++ includes
+#include <vector>
+
+// Standard C includes
+#include <cassert>
+#include <cmath>
+
+// Common example includes
+#include "../common/power_table.h"
+
+// Optical flow includes
+#include "parameters.h"
+
+//----------------------------------------------------------------------------
+// Typedefines
+//----------------------------------------------------------------------------
+//! Decayed flow vector at each detector
+typedef float FlowArray[Parameters::detectorSize][Parameters::detectorSize][2];
+
+//----------------------------------------------------------------------------
+// FlowField
+//----------------------------------------------------------------------------
+//! Flow field accumulated from output spikes and decayed by spikePersistence every timestep.
+//! Like TimeSurfaceRenderer, decay is only applied to a cell when it is updated or rendered
+class FlowField
+{
+public:
+    FlowField(unsigned int size = Parameters::detectorSize)
+    :   m_Size(size), m_Decay(Parameters::spikePersistence), m_Timestep(0), m_Cells(size * size)
+    {
+    }
+
+    //------------------------------------------------------------------------
+    // Public API
+    //------------------------------------------------------------------------
+    //! Add vector to cell during current timestep
+    void add(unsigned int x, unsigned int y, float dx, float dy)
+    {
+        // Bring cell up to date and add vector
+        // **NOTE** values are stored before this timestep's decay is applied
+        Cell &cell = m_Cells[x + (y * m_Size)];
+        const float decay = m_Decay[m_Timestep - cell.lastUpdate];
+        cell.flow[0] = (cell.flow[0] * decay) + dx;
+        cell.flow[1] = (cell.flow[1] * decay) + dy;
+        cell.lastUpdate = m_Timestep;
+    }
+
+    //! Advance to next timestep - should be called once every timestep after all vectors are added
+    void advance()
+    {
+        m_Timestep++;
+    }
+
+    //! Render decayed flow of all cells at the end of the last timestep into output
+    void render(FlowArray &output) const
+    {
+        assert(m_Size == Parameters::detectorSize);
+
+        for(unsigned int y = 0; y < Parameters::detectorSize; y++) {
+            for(unsigned int x = 0; x < Parameters::detectorSize; x++) {
+                const Cell &cell = m_Cells[x + (y * m_Size)];
+                const float decay = m_Decay[m_Timestep - cell.lastUpdate];
+                output[x][y][0] = cell.flow[0] * decay;
+                output[x][y][1] = cell.flow[1] * decay;
+            }
+        }
+    }
+
+    //! Calculate coherence of decayed flow - the magnitude of the summed flow vectors
+    //! divided by the sum of their magnitudes - 1 if all cells agree and 0 if there is no flow
+    float getCoherence() const
+    {
+        float sum[2] = {0.0f, 0.0f};
+        float sumMagnitude = 0.0f;
+        for(const auto &cell : m_Cells) {
+            const float decay = m_Decay[m_Timestep - cell.lastUpdate];
+            const float dx = cell.flow[0] * decay;
+            const float dy = cell.flow[1] * decay;
+            sum[0] += dx;
+            sum[1] += dy;
+            sumMagnitude += std::sqrt((dx * dx) + (dy * dy));
+        }
+
+        return (sumMagnitude > 0.0f) ? (std::sqrt((sum[0] * sum[0]) + (sum[1] * sum[1])) / sumMagnitude) : 0.0f;
+    }
+
+    unsigned int getSize() const{ return m_Size; }
+
+private:
+    //------------------------------------------------------------------------
+    // Cell
+    //------------------------------------------------------------------------
+    struct Cell
+    {
+        Cell() : flow{0.0f, 0.0f}, lastUpdate(0)
+        {
+        }
+
+        float flow[2];
+        unsigned int lastUpdate;
+    };
+
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    // Width and height of field in detectors
+    const unsigned int m_Size;
+
+    // Lookup table of spikePersistence^n
+    const PowerTable m_Decay;
+
+    // Number of timesteps simulated
+    unsigned int m_Timestep;
+
+    std::vector<Cell> m_Cells;
+};
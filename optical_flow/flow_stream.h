@@ -0,0 +1,299 @@
+#pragma once
+
+// Standard C++ includes
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Standard C includes
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+
+// POSIX includes
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+//----------------------------------------------------------------------------
+// FlowStream
+//----------------------------------------------------------------------------
+//! Compact encoding of flow fields sent as datagrams over a local Unix socket.
+//! Each datagram contains a Header followed by Header::numCells cells. Each cell holds
+//! the row-major index of a cell with non-zero flow and its flow vector quantised to
+//! int8 or int16, which is multiplied by Header::scale to recover the flow
+namespace FlowStream
+{
+//----------------------------------------------------------------------------
+// Constants
+//----------------------------------------------------------------------------
+const uint32_t magic = 0x574F4C46;  // 'FLOW'
+const uint16_t version = 1;
+
+//----------------------------------------------------------------------------
+// Enumerations
+//----------------------------------------------------------------------------
+enum class Format : uint8_t
+{
+    Int8,
+    Int16,
+};
+
+//----------------------------------------------------------------------------
+// FlowStream::Header
+//----------------------------------------------------------------------------
+#pragma pack(push, 1)
+struct Header
+{
+    uint32_t magic;
+    uint16_t version;
+
+    // Width and height of flow field in cells
+    uint16_t size;
+
+    // Sequence number of datagram, used by receivers to detect loss
+    uint32_t sequence;
+
+    // Simulation timestep flow was rendered at
+    uint32_t timestep;
+
+    // CLOCK_MONOTONIC time datagram was sent [ns]
+    uint64_t sendTime;
+
+    // Flow represented by one quantisation step
+    float scale;
+
+    uint16_t numCells;
+    Format format;
+    uint8_t padding;
+};
+
+//----------------------------------------------------------------------------
+// FlowStream::Cell
+//----------------------------------------------------------------------------
+template<typename T>
+struct Cell
+{
+    uint16_t index;
+    T flow[2];
+};
+#pragma pack(pop)
+
+//----------------------------------------------------------------------------
+// Functions
+//----------------------------------------------------------------------------
+inline uint64_t getMonotonicTime()
+{
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return ((uint64_t)time.tv_sec * 1000000000ull) + (uint64_t)time.tv_nsec;
+}
+
+inline size_t getCellSize(Format format)
+{
+    return (format == Format::Int8) ? sizeof(Cell<int8_t>) : sizeof(Cell<int16_t>);
+}
+
+inline sockaddr_un getAddress(const std::string &path)
+{
+    sockaddr_un address;
+    memset(&address, 0, sizeof(sockaddr_un));
+    address.sun_family = AF_UNIX;
+    if(path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path '" + path + "' too long");
+    }
+    strcpy(address.sun_path, path.c_str());
+    return address;
+}
+
+//----------------------------------------------------------------------------
+// FlowStream::Sender
+//----------------------------------------------------------------------------
+//! Quantises flow fields and sends them to a receiver bound to a socket path.
+//! Sending never blocks - if no receiver is bound or its queue is full, the flow field is dropped
+class Sender
+{
+public:
+    Sender(const std::string &path, unsigned int size, float scale, Format format = Format::Int8)
+    :   m_Address(getAddress(path)), m_Size(size), m_Scale(scale), m_Format(format),
+        m_Buffer(sizeof(Header) + (size * size * getCellSize(format))), m_Sequence(0), m_NumSent(0), m_NumDropped(0)
+    {
+        if(size * size > UINT16_MAX) {
+            throw std::runtime_error("Flow field too large to stream");
+        }
+        if(!(scale > 0.0f) || !std::isfinite(scale)) {
+            throw std::runtime_error("Flow stream scale must be positive");
+        }
+
+        m_Socket = socket(AF_UNIX, SOCK_DGRAM, 0);
+        if(m_Socket < 0) {
+            throw std::runtime_error("Cannot create socket: " + std::string(strerror(errno)));
+        }
+    }
+
+    ~Sender()
+    {
+        close(m_Socket);
+    }
+
+    //------------------------------------------------------------------------
+    // Public API
+    //------------------------------------------------------------------------
+    //! Encode and send a flow field stored as size * size cells of (x, y) flow, indexed [x][y]
+    //! Returns false if it was dropped
+    bool send(unsigned int timestep, const float *flow)
+    {
+        return (m_Format == Format::Int8) ? send<int8_t>(timestep, flow) : send<int16_t>(timestep, flow);
+    }
+
+    unsigned long long getNumSent() const{ return m_NumSent; }
+    unsigned long long getNumDropped() const{ return m_NumDropped; }
+
+private:
+    //------------------------------------------------------------------------
+    // Private methods
+    //------------------------------------------------------------------------
+    template<typename T>
+    bool send(unsigned int timestep, const float *flow)
+    {
+        const float minValue = (float)std::numeric_limits<T>::min();
+        const float maxValue = (float)std::numeric_limits<T>::max();
+
+        // Quantise all cells with non-zero flow directly into buffer
+        Cell<T> *cells = reinterpret_cast<Cell<T>*>(m_Buffer.data() + sizeof(Header));
+        unsigned int numCells = 0;
+        for(unsigned int y = 0; y < m_Size; y++) {
+            for(unsigned int x = 0; x < m_Size; x++) {
+                const float *cellFlow = &flow[((x * m_Size) + y) * 2];
+                const T dx = (T)std::min(maxValue, std::max(minValue, std::round(cellFlow[0] / m_Scale)));
+                const T dy = (T)std::min(maxValue, std::max(minValue, std::round(cellFlow[1] / m_Scale)));
+                if(dx != 0 || dy != 0) {
+                    cells[numCells].index = (uint16_t)(x + (y * m_Size));
+                    cells[numCells].flow[0] = dx;
+                    cells[numCells].flow[1] = dy;
+                    numCells++;
+                }
+            }
+        }
+
+        // Fill in header
+        Header *header = reinterpret_cast<Header*>(m_Buffer.data());
+        header->magic = magic;
+        header->version = version;
+        header->size = (uint16_t)m_Size;
+        header->sequence = m_Sequence++;
+        header->timestep = timestep;
+        header->sendTime = getMonotonicTime();
+        header->scale = m_Scale;
+        header->numCells = (uint16_t)numCells;
+        header->format = m_Format;
+        header->padding = 0;
+
+        // Send without blocking
+        const size_t length = sizeof(Header) + (numCells * sizeof(Cell<T>));
+        if(sendto(m_Socket, m_Buffer.data(), length, MSG_DONTWAIT,
+                  reinterpret_cast<const sockaddr*>(&m_Address), sizeof(sockaddr_un)) == (ssize_t)length)
+        {
+            m_NumSent++;
+            return true;
+        }
+        else {
+            m_NumDropped++;
+            return false;
+        }
+    }
+
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    const sockaddr_un m_Address;
+    const unsigned int m_Size;
+    const float m_Scale;
+    const Format m_Format;
+
+    int m_Socket;
+
+    // Buffer large enough to hold a datagram with every cell non-zero
+    std::vector<uint8_t> m_Buffer;
+
+    uint32_t m_Sequence;
+    unsigned long long m_NumSent;
+    unsigned long long m_NumDropped;
+};
+
+//----------------------------------------------------------------------------
+// FlowStream::Receiver
+//----------------------------------------------------------------------------
+//! Binds to a socket path and receives datagrams sent by a Sender
+class Receiver
+{
+public:
+    Receiver(const std::string &path) : m_Path(path), m_Buffer(65536)
+    {
+        m_Socket = socket(AF_UNIX, SOCK_DGRAM, 0);
+        if(m_Socket < 0) {
+            throw std::runtime_error("Cannot create socket: " + std::string(strerror(errno)));
+        }
+
+        // Remove any stale socket and bind
+        unlink(m_Path.c_str());
+        const sockaddr_un address = getAddress(m_Path);
+        if(bind(m_Socket, reinterpret_cast<const sockaddr*>(&address), sizeof(sockaddr_un)) != 0) {
+            close(m_Socket);
+            throw std::runtime_error("Cannot bind socket '" + m_Path + "': " + std::string(strerror(errno)));
+        }
+    }
+
+    ~Receiver()
+    {
+        close(m_Socket);
+        unlink(m_Path.c_str());
+    }
+
+    //------------------------------------------------------------------------
+    // Public API
+    //------------------------------------------------------------------------
+    //! Wait up to timeoutMs for a datagram and validate its header. Returns the header,
+    //! with cells following it in memory, or nullptr if nothing valid was received
+    const Header *receive(int timeoutMs)
+    {
+        timeval timeout{timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+        setsockopt(m_Socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeval));
+
+        const ssize_t length = recv(m_Socket, m_Buffer.data(), m_Buffer.size(), 0);
+        if(length < (ssize_t)sizeof(Header)) {
+            return nullptr;
+        }
+
+        // Check header matches and datagram contains the cells it claims
+        const Header *header = reinterpret_cast<const Header*>(m_Buffer.data());
+        if(header->magic != magic || header->version != version
+            || (header->format != Format::Int8 && header->format != Format::Int16)
+            || (size_t)length != (sizeof(Header) + (header->numCells * getCellSize(header->format))))
+        {
+            throw std::runtime_error("Malformed flow datagram");
+        }
+        return header;
+    }
+
+    //! Get cells following header returned by receive
+    template<typename T>
+    const Cell<T> *getCells(const Header *header) const
+    {
+        return reinterpret_cast<const Cell<T>*>(reinterpret_cast<const uint8_t*>(header) + sizeof(Header));
+    }
+
+private:
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    const std::string m_Path;
+    int m_Socket;
+    std::vector<uint8_t> m_Buffer;
+};
+}   // namespace FlowStream
@@ -1,4 +1,5 @@
 #include <cmath>
+#include <string>
 #include <vector>
 
 // GeNN includes
@@ -61,36 +62,47 @@ void modelDefinition(NNmodel &model)
     // Create IF_curr neuron
     auto *dvs = model.addNeuronPopulation<NeuronModels::SpikeSource>("DVS", Parameters::inputSize * Parameters::inputSize,
                                                          {}, {});
-    model.addNeuronPopulation<LIF>("MacroPixel", Parameters::macroPixelSize * Parameters::macroPixelSize,
-                                   lifParams, lifInit);
 
-    auto *output = model.addNeuronPopulation<LIF>("Output", Parameters::detectorSize * Parameters::detectorSize * Parameters::DetectorMax,
-                                   lifParams, lifInit);
-
-    //------------------------------------------------------------------------
-    // Synapse populations
-    //------------------------------------------------------------------------
-    model.addSynapsePopulation<WeightUpdateModels::StaticPulse, ExpCurr>(
-        "DVS_MacroPixel", SynapseMatrixType::SPARSE_GLOBALG, NO_DELAY,
-        "DVS", "MacroPixel",
-        {}, dvsMacroPixelWeightUpdateInit,
-        macroPixelPostSynParams, {});
-
-    model.addSynapsePopulation<WeightUpdateModels::StaticPulse, ExpCurr>(
-        "MacroPixel_Output_Excitatory", SynapseMatrixType::SPARSE_GLOBALG, NO_DELAY,
-        "MacroPixel", "Output",
-        {}, macroPixelOutputExcitatoryWeightUpdateInit,
-        outputExcitatoryPostSynParams, {});
-
-    model.addSynapsePopulation<WeightUpdateModels::StaticPulse, ExpCurr>(
-        "MacroPixel_Output_Inhibitory", SynapseMatrixType::SPARSE_GLOBALG, NO_DELAY,
-        "MacroPixel", "Output",
-        {}, macroPixelOutputInhibitoryWeightUpdateInit,
-        outputInhibitoryPostSynParams, {});
-
-    // Use zero-copy for spikes and weights as we want to record them every timestep
+    // Loop through scales of detectors
+    // **NOTE** populations of finest scale are unsuffixed and those of coarser scales suffixed with scale index
+    for(unsigned int s = 0; s < Parameters::numScales; s++) {
+        const std::string suffix = (s == 0) ? "" : std::to_string(s);
+        const unsigned int macroPixelSize = Parameters::getMacroPixelSize(s);
+        const unsigned int detectorSize = Parameters::getDetectorSize(s);
+
+        model.addNeuronPopulation<LIF>("MacroPixel" + suffix, macroPixelSize * macroPixelSize,
+                                       lifParams, lifInit);
+
+        auto *output = model.addNeuronPopulation<LIF>("Output" + suffix, detectorSize * detectorSize * Parameters::DetectorMax,
+                                                      lifParams, lifInit);
+
+        //------------------------------------------------------------------------
+        // Synapse populations
+        //------------------------------------------------------------------------
+        model.addSynapsePopulation<WeightUpdateModels::StaticPulse, ExpCurr>(
+            "DVS_MacroPixel" + suffix, SynapseMatrixType::SPARSE_GLOBALG, NO_DELAY,
+            "DVS", "MacroPixel" + suffix,
+            {}, dvsMacroPixelWeightUpdateInit,
+            macroPixelPostSynParams, {});
+
+        model.addSynapsePopulation<WeightUpdateModels::StaticPulse, ExpCurr>(
+            "MacroPixel_Output_Excitatory" + suffix, SynapseMatrixType::SPARSE_GLOBALG, NO_DELAY,
+            "MacroPixel" + suffix, "Output" + suffix,
+            {}, macroPixelOutputExcitatoryWeightUpdateInit,
+            outputExcitatoryPostSynParams, {});
+
+        model.addSynapsePopulation<WeightUpdateModels::StaticPulse, ExpCurr>(
+            "MacroPixel_Output_Inhibitory" + suffix, SynapseMatrixType::SPARSE_GLOBALG, NO_DELAY,
+            "MacroPixel" + suffix, "Output" + suffix,
+            {}, macroPixelOutputInhibitoryWeightUpdateInit,
+            outputInhibitoryPostSynParams, {});
+
+        // Use zero-copy for output spikes as we want to record them every timestep
+        output->setSpikeZeroCopyEnabled(true);
+    }
+
+    // Use zero-copy for input spikes as they are provided every timestep
     dvs->setSpikeZeroCopyEnabled(true);
-    output->setSpikeZeroCopyEnabled(true);
 
     model.finalize();
 }
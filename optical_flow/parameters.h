@@ -18,12 +18,32 @@ namespace Parameters
     const double timestep = 1.0;
 
     const unsigned int inputSize = 128;
-    const unsigned int kernelSize = 5;
-    const unsigned int centreSize = 125;
 
-    const unsigned int macroPixelSize = centreSize / kernelSize;
+    // Number of scales of detectors - when built with PYRAMID=N, N scales
+    // of detectors with increasingly large macropixels are driven by the same input
+#ifdef PYRAMID
+    const unsigned int numScales = PYRAMID;
+#else
+    const unsigned int numScales = 1;
+#endif
 
-    const unsigned int detectorSize = macroPixelSize - 2;
+    // Size of macropixels [pixels] at each scale, finest first
+    constexpr unsigned int kernelSizes[] = {5, 10, 20};
+    static_assert(numScales >= 1 && numScales <= (sizeof(kernelSizes) / sizeof(kernelSizes[0])),
+                  "Unsupported number of pyramid scales");
+
+    // Each scale divides as much of the input as possible into whole macropixels
+    constexpr unsigned int getMacroPixelSize(unsigned int scale){ return inputSize / kernelSizes[scale]; }
+    constexpr unsigned int getCentreSize(unsigned int scale){ return getMacroPixelSize(scale) * kernelSizes[scale]; }
+    constexpr unsigned int getDetectorSize(unsigned int scale){ return getMacroPixelSize(scale) - 2; }
+
+    // Geometry of finest scale, onto which the flow of all scales is fused
+    const unsigned int kernelSize = kernelSizes[0];
+    const unsigned int centreSize = getCentreSize(0);
+
+    const unsigned int macroPixelSize = getMacroPixelSize(0);
+
+    const unsigned int detectorSize = getDetectorSize(0);
 
     const unsigned int outputScale = 25;
     const unsigned int inputScale = 4;
@@ -31,4 +51,10 @@ namespace Parameters
     const float spikePersistence = 0.995f;
 
     const float outputVectorScale = 2.0f;
+
+    // How often are the input image and flow field published to the display thread
+    const unsigned int displayPublishTimesteps = 10;
+
+    // Flow represented by one step of the quantised flow field sent by --stream
+    const float streamQuantisationStep = 0.25f;
 }
\ No newline at end of file
@@ -0,0 +1,209 @@
+#pragma once
+
+// Standard C++ includes
+#include <iostream>
+#include <vector>
+
+// Standard C includes
+#include <cstdlib>
+
+// Optical flow includes
+#include "flow_field.h"
+#include "parameters.h"
+
+//----------------------------------------------------------------------------
+// PyramidFlow
+//----------------------------------------------------------------------------
+//! Decodes the output spikes of the detectors at each scale and fuses them onto
+//! the finest scale's grid. A spike from a coarser detector is added to every finest
+//! cell whose centre lies within its macropixel, scaled by the ratio of kernel sizes
+//! as coarser detectors respond to proportionally faster motion. The flow of each
+//! scale is also accumulated on its own grid so its coherence can be measured.
+class PyramidFlow
+{
+public:
+    PyramidFlow()
+    {
+        for(unsigned int s = 0; s < Parameters::numScales; s++) {
+            m_Scales.emplace_back(s);
+        }
+    }
+
+    //------------------------------------------------------------------------
+    // Public API
+    //------------------------------------------------------------------------
+    //! Apply one timestep's output spikes from the detectors of one scale
+    void apply(unsigned int scale, unsigned int outputSpikeCount, const unsigned int *outputSpikes)
+    {
+        Scale &s = m_Scales[scale];
+        s.numSpikes += outputSpikeCount;
+
+        // Loop through output spikes
+        const unsigned int detectorSize = Parameters::getDetectorSize(scale);
+        for(unsigned int i = 0; i < outputSpikeCount; i++)
+        {
+            // Convert spike ID to x, y, detector
+            const unsigned int spike = outputSpikes[i];
+            const auto spikeCoord = std::div((int)spike, (int)detectorSize * Parameters::DetectorMax);
+            const int spikeY = spikeCoord.quot;
+            const auto xCoord = std::div(spikeCoord.rem, (int)Parameters::DetectorMax);
+            const int spikeX =  xCoord.quot;
+
+            // Get direction of detector spike was emitted by
+            float dx = 0.0f;
+            float dy = 0.0f;
+            switch(xCoord.rem)
+            {
+                case Parameters::DetectorLeft:
+                    dx = -1.0f;
+                    break;
+
+                case Parameters::DetectorRight:
+                    dx = 1.0f;
+                    break;
+
+                case Parameters::DetectorUp:
+                    dy = -1.0f;
+                    break;
+
+                case Parameters::DetectorDown:
+                    dy = 1.0f;
+                    break;
+            }
+
+            // Add to this scale's flow field
+            s.flowField.add(spikeX, spikeY, dx, dy);
+
+            // Add scaled vector to all finest cells covered by detector
+            dx *= s.weight;
+            dy *= s.weight;
+            for(unsigned int y = s.fineBegin[spikeY]; y < s.fineEnd[spikeY]; y++) {
+                for(unsigned int x = s.fineBegin[spikeX]; x < s.fineEnd[spikeX]; x++) {
+                    m_FlowField.add(x, y, dx, dy);
+                }
+            }
+        }
+    }
+
+    //! Advance to next timestep - should be called once every timestep after all scales are applied
+    void advance()
+    {
+        m_FlowField.advance();
+        for(auto &s : m_Scales) {
+            s.flowField.advance();
+        }
+    }
+
+    //! Render decayed, fused flow into output
+    void render(FlowArray &output) const
+    {
+        m_FlowField.render(output);
+    }
+
+    //! Sample coherence of fused and per-scale flow for statistics
+    void sampleCoherence()
+    {
+        m_Coherence.sample(m_FlowField.getCoherence());
+        for(auto &s : m_Scales) {
+            s.coherence.sample(s.flowField.getCoherence());
+        }
+    }
+
+    void printStats(unsigned int numTimesteps, std::ostream &stream = std::cout) const
+    {
+        for(unsigned int i = 0; i < m_Scales.size(); i++) {
+            const Scale &s = m_Scales[i];
+            const unsigned int detectorSize = Parameters::getDetectorSize(i);
+            stream << "Scale " << i << ": " << Parameters::kernelSizes[i] << " pixel macropixels, "
+                << detectorSize << "x" << detectorSize << " detectors, " << s.numSpikes << " spikes, "
+                << (double)s.numSpikes / (double)numTimesteps << " spikes/step, coherence " << s.coherence.getMean() << std::endl;
+        }
+        stream << "Fused coherence " << m_Coherence.getMean() << std::endl;
+    }
+
+private:
+    //------------------------------------------------------------------------
+    // MeanAccumulator
+    //------------------------------------------------------------------------
+    //! Mean of samples, ignoring those where there is no flow
+    class MeanAccumulator
+    {
+    public:
+        MeanAccumulator() : m_Sum(0.0), m_Count(0)
+        {
+        }
+
+        void sample(float value)
+        {
+            if(value > 0.0f) {
+                m_Sum += value;
+                m_Count++;
+            }
+        }
+
+        double getMean() const{ return (m_Count == 0) ? 0.0 : (m_Sum / (double)m_Count); }
+
+    private:
+        double m_Sum;
+        unsigned int m_Count;
+    };
+
+    //------------------------------------------------------------------------
+    // Scale
+    //------------------------------------------------------------------------
+    struct Scale
+    {
+        Scale(unsigned int scale)
+        :   weight((float)Parameters::kernelSizes[scale] / (float)Parameters::kernelSize),
+            flowField(Parameters::getDetectorSize(scale)), numSpikes(0)
+        {
+            // Calculate borders of both scales
+            const unsigned int nearBorder = (Parameters::inputSize - Parameters::getCentreSize(scale)) / 2;
+            const unsigned int fineNearBorder = (Parameters::inputSize - Parameters::centreSize) / 2;
+
+            // Loop through detectors along each axis
+            const unsigned int kernelSize = Parameters::kernelSizes[scale];
+            for(unsigned int d = 0; d < Parameters::getDetectorSize(scale); d++) {
+                // Calculate range of pixels covered by detector's macropixel
+                const unsigned int begin = nearBorder + ((d + 1) * kernelSize);
+                const unsigned int end = begin + kernelSize;
+
+                // Find finest detectors with centres in this range
+                unsigned int f = 0;
+                while(f < Parameters::detectorSize && getFineCentre(fineNearBorder, f) < begin) {
+                    f++;
+                }
+                fineBegin.push_back(f);
+                while(f < Parameters::detectorSize && getFineCentre(fineNearBorder, f) < end) {
+                    f++;
+                }
+                fineEnd.push_back(f);
+            }
+        }
+
+        static unsigned int getFineCentre(unsigned int fineNearBorder, unsigned int f)
+        {
+            return fineNearBorder + ((f + 1) * Parameters::kernelSize) + (Parameters::kernelSize / 2);
+        }
+
+        // Scale applied to vectors fused onto finest grid
+        const float weight;
+
+        // Range of finest detectors covered by each detector along each axis
+        std::vector<unsigned int> fineBegin;
+        std::vector<unsigned int> fineEnd;
+
+        FlowField flowField;
+        MeanAccumulator coherence;
+        unsigned long long numSpikes;
+    };
+
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    // Fused flow field on finest grid
+    FlowField m_FlowField;
+    MeanAccumulator m_Coherence;
+
+    std::vector<Scale> m_Scales;
+};
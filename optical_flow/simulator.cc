@@ -3,36 +3,39 @@
 #include <fstream>
 #include <iostream>
 #include <limits>
-#include <mutex>
+#include <memory>
 #include <random>
 #include <set>
 #include <sstream>
+#include <stdexcept>
+#include <string>
 #include <thread>
 #include <vector>
 
 // Standard C includes
 #include <cassert>
+#include <cmath>
 #include <csignal>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 
 // OpenCV includes
 #include <opencv2/highgui/highgui.hpp>
 
 // Common example includes
+#include "../common/event_source.h"
+#include "../common/realtime.h"
+#include "../common/realtime_scheduler.h"
 #include "../common/spike_image_renderer.h"
 #include "../common/timer.h"
-
-#ifdef DVS
-    #include "../common/dvs_128.h"
-#elif CSV
-    #include "../common/dvs_pre_recorded.h"
-#else
-    #include "../common/dvs_pre_recorded_ms.h"
-#endif
-
+#include "../common/triple_buffer.h"
 
 // Optical flow includes
+#include "flow_field.h"
+#include "flow_stream.h"
 #include "parameters.h"
+#include "pyramid_flow.h"
 
 // Auto-generated simulation code
 #include "optical_flow_CODE/definitions.h"
@@ -52,6 +55,55 @@ void signalHandler(int status)
 }
 
 
+//----------------------------------------------------------------------------
+// Scale
+//----------------------------------------------------------------------------
+//! Generated symbols of the populations making up one scale of detectors
+struct Scale
+{
+    SparseProjection &dvsMacroPixel;
+    allocateFn allocateDVSMacroPixel;
+
+    SparseProjection &excitatory;
+    allocateFn allocateExcitatory;
+
+    SparseProjection &inhibitory;
+    allocateFn allocateInhibitory;
+
+    // Output spike count and spikes
+    unsigned int *&outputSpikeCount;
+    unsigned int *&outputSpikes;
+
+#ifndef CPU_ONLY
+    void (*pullOutputSpikes)();
+#endif
+};
+
+#ifndef CPU_ONLY
+    #define SCALE(SUFFIX) {CDVS_MacroPixel##SUFFIX, &allocateDVS_MacroPixel##SUFFIX,                    \
+        CMacroPixel_Output_Excitatory##SUFFIX, &allocateMacroPixel_Output_Excitatory##SUFFIX,           \
+        CMacroPixel_Output_Inhibitory##SUFFIX, &allocateMacroPixel_Output_Inhibitory##SUFFIX,           \
+        glbSpkCntOutput##SUFFIX, glbSpkOutput##SUFFIX, &pullOutput##SUFFIX##CurrentSpikesFromDevice}
+#else
+    #define SCALE(SUFFIX) {CDVS_MacroPixel##SUFFIX, &allocateDVS_MacroPixel##SUFFIX,                    \
+        CMacroPixel_Output_Excitatory##SUFFIX, &allocateMacroPixel_Output_Excitatory##SUFFIX,           \
+        CMacroPixel_Output_Inhibitory##SUFFIX, &allocateMacroPixel_Output_Inhibitory##SUFFIX,           \
+        glbSpkCntOutput##SUFFIX, glbSpkOutput##SUFFIX}
+#endif
+
+//! Symbols of each scale, indexed in the same order as Parameters::kernelSizes
+Scale g_Scales[Parameters::numScales] = {
+    SCALE(),
+#if PYRAMID >= 2
+    SCALE(1),
+#endif
+#if PYRAMID >= 3
+    SCALE(2),
+#endif
+};
+
+#undef SCALE
+
 unsigned int getNeuronIndex(unsigned int resolution, unsigned int x, unsigned int y)
 {
     return x + (y * resolution);
@@ -73,14 +125,18 @@ void print_sparse_matrix(unsigned int pre_resolution, const SparseProjection &pr
     }
 }
 
-void buildCentreToMacroConnection(SparseProjection &projection, allocateFn allocate)
+void buildCentreToMacroConnection(unsigned int scale, SparseProjection &projection, allocateFn allocate)
 {
+    const unsigned int kernelSize = Parameters::kernelSizes[scale];
+    const unsigned int centreSize = Parameters::getCentreSize(scale);
+    const unsigned int macroPixelSize = Parameters::getMacroPixelSize(scale);
+
     // Allocate centre_size * centre_size connections
-    allocate(Parameters::centreSize * Parameters::centreSize);
+    allocate(centreSize * centreSize);
 
     // Calculate start and end of border on each row
-    const unsigned int near_border = (Parameters::inputSize - Parameters::centreSize) / 2;
-    const unsigned int far_border = near_border + Parameters::centreSize;
+    const unsigned int near_border = (Parameters::inputSize - centreSize) / 2;
+    const unsigned int far_border = near_border + centreSize;
 
     // Loop through rows of pixels in centre
     unsigned int s = 0;
@@ -93,9 +149,9 @@ void buildCentreToMacroConnection(SparseProjection &projection, allocateFn alloc
 
             // If we're in the centre
             if(xi >= near_border && xi < far_border && yi >= near_border && yi < far_border) {
-                const unsigned int yj = (yi - near_border) / Parameters::kernelSize;
-                const unsigned int xj = (xi - near_border) / Parameters::kernelSize;
-                projection.ind[s++] = getNeuronIndex(Parameters::macroPixelSize, xj, yj);
+                const unsigned int yj = (yi - near_border) / kernelSize;
+                const unsigned int xj = (xi - near_border) / kernelSize;
+                projection.ind[s++] = getNeuronIndex(macroPixelSize, xj, yj);
             }
         }
     }
@@ -104,85 +160,88 @@ void buildCentreToMacroConnection(SparseProjection &projection, allocateFn alloc
     projection.indInG[i] = s;
 
     // Check
-    assert(s == (Parameters::centreSize * Parameters::centreSize));
+    assert(s == (centreSize * centreSize));
     assert(i == (Parameters::inputSize * Parameters::inputSize));
 }
 
-void buildDetectors(SparseProjection &excitatoryProjection, SparseProjection &inhibitoryProjection,
+void buildDetectors(unsigned int scale, SparseProjection &excitatoryProjection, SparseProjection &inhibitoryProjection,
                     allocateFn allocateExcitatory, allocateFn allocateInhibitory)
 {
-    allocateExcitatory(Parameters::detectorSize * Parameters::detectorSize * Parameters::DetectorMax);
-    allocateInhibitory(Parameters::detectorSize * Parameters::detectorSize * Parameters::DetectorMax);
+    const unsigned int macroPixelSize = Parameters::getMacroPixelSize(scale);
+    const unsigned int detectorSize = Parameters::getDetectorSize(scale);
+
+    allocateExcitatory(detectorSize * detectorSize * Parameters::DetectorMax);
+    allocateInhibitory(detectorSize * detectorSize * Parameters::DetectorMax);
 
     // Loop through macro cells
     unsigned int sExcitatory = 0;
     unsigned int iExcitatory = 0;
     unsigned int sInhibitory = 0;
     unsigned int iInhibitory = 0;
-    for(unsigned int yi = 0; yi < Parameters::macroPixelSize; yi++)
+    for(unsigned int yi = 0; yi < macroPixelSize; yi++)
     {
-        for(unsigned int xi = 0; xi < Parameters::macroPixelSize; xi++)
+        for(unsigned int xi = 0; xi < macroPixelSize; xi++)
         {
             // Mark start of 'synaptic row'
             excitatoryProjection.indInG[iExcitatory++] = sExcitatory;
             inhibitoryProjection.indInG[iInhibitory++] = sInhibitory;
 
             // If we're not in border region
-            if(xi >= 1 && xi < (Parameters::macroPixelSize - 1)
-                && yi >= 1 && yi < (Parameters::macroPixelSize - 1))
+            if(xi >= 1 && xi < (macroPixelSize - 1)
+                && yi >= 1 && yi < (macroPixelSize - 1))
             {
                 const unsigned int xj = (xi - 1) * Parameters::DetectorMax;
                 const unsigned int yj = yi - 1;
 
                 // Add excitatory synapses to all detectors
-                excitatoryProjection.ind[sExcitatory++] = getNeuronIndex(Parameters::detectorSize * Parameters::DetectorMax,
+                excitatoryProjection.ind[sExcitatory++] = getNeuronIndex(detectorSize * Parameters::DetectorMax,
                                                                          xj + Parameters::DetectorLeft, yj);
-                excitatoryProjection.ind[sExcitatory++] = getNeuronIndex(Parameters::detectorSize * Parameters::DetectorMax,
+                excitatoryProjection.ind[sExcitatory++] = getNeuronIndex(detectorSize * Parameters::DetectorMax,
                                                                          xj + Parameters::DetectorRight, yj);
-                excitatoryProjection.ind[sExcitatory++] = getNeuronIndex(Parameters::detectorSize * Parameters::DetectorMax,
+                excitatoryProjection.ind[sExcitatory++] = getNeuronIndex(detectorSize * Parameters::DetectorMax,
                                                                          xj + Parameters::DetectorUp, yj);
-                excitatoryProjection.ind[sExcitatory++] = getNeuronIndex(Parameters::detectorSize * Parameters::DetectorMax,
+                excitatoryProjection.ind[sExcitatory++] = getNeuronIndex(detectorSize * Parameters::DetectorMax,
                                                                          xj + Parameters::DetectorDown, yj);
             }
 
 
             // Create inhibitory connection to 'left' detector associated with macropixel one to right
-            if(xi < (Parameters::macroPixelSize - 2)
-                && yi >= 1 && yi < (Parameters::macroPixelSize - 1))
+            if(xi < (macroPixelSize - 2)
+                && yi >= 1 && yi < (macroPixelSize - 1))
             {
                 const unsigned int xj = (xi - 1 + 1) * Parameters::DetectorMax;
                 const unsigned int yj = yi - 1;
-                inhibitoryProjection.ind[sInhibitory++] = getNeuronIndex(Parameters::detectorSize * Parameters::DetectorMax,
+                inhibitoryProjection.ind[sInhibitory++] = getNeuronIndex(detectorSize * Parameters::DetectorMax,
                                                                          xj + Parameters::DetectorLeft, yj);
             }
 
             // Create inhibitory connection to 'right' detector associated with macropixel one to right
             if(xi >= 2
-                && yi >= 1 && yi < (Parameters::macroPixelSize - 1))
+                && yi >= 1 && yi < (macroPixelSize - 1))
             {
                 const unsigned int xj = (xi - 1 - 1) * Parameters::DetectorMax;
                 const unsigned int yj = yi - 1;
-                inhibitoryProjection.ind[sInhibitory++] = getNeuronIndex(Parameters::detectorSize * Parameters::DetectorMax,
+                inhibitoryProjection.ind[sInhibitory++] = getNeuronIndex(detectorSize * Parameters::DetectorMax,
                                                                          xj + Parameters::DetectorRight, yj);
             }
 
             // Create inhibitory connection to 'up' detector associated with macropixel one below
-            if(xi >= 1 && xi < (Parameters::macroPixelSize - 1)
-                && yi < (Parameters::macroPixelSize - 2))
+            if(xi >= 1 && xi < (macroPixelSize - 1)
+                && yi < (macroPixelSize - 2))
             {
                 const unsigned int xj = (xi - 1) * Parameters::DetectorMax;
                 const unsigned int yj = yi - 1 + 1;
-                inhibitoryProjection.ind[sInhibitory++] = getNeuronIndex(Parameters::detectorSize * Parameters::DetectorMax,
+                inhibitoryProjection.ind[sInhibitory++] = getNeuronIndex(detectorSize * Parameters::DetectorMax,
                                                                          xj + Parameters::DetectorUp, yj);
             }
 
             // Create inhibitory connection to 'down' detector associated with macropixel one above
-            if(xi >= 1 && xi < (Parameters::macroPixelSize - 1)
+            if(xi >= 1 && xi < (macroPixelSize - 1)
                 && yi >= 2)
             {
                 const unsigned int xj = (xi - 1) * Parameters::DetectorMax;
                 const unsigned int yj = yi - 1 - 1;
-                inhibitoryProjection.ind[sInhibitory++] = getNeuronIndex(Parameters::detectorSize * Parameters::DetectorMax,
+                inhibitoryProjection.ind[sInhibitory++] = getNeuronIndex(detectorSize * Parameters::DetectorMax,
                                                                          xj + Parameters::DetectorDown, yj);
             }
 
@@ -194,14 +253,13 @@ void buildDetectors(SparseProjection &excitatoryProjection, SparseProjection &in
     inhibitoryProjection.indInG[iInhibitory] = sInhibitory;
 
     // Check
-    assert(sExcitatory == (Parameters::detectorSize * Parameters::detectorSize * Parameters::DetectorMax));
-    assert(iExcitatory == (Parameters::macroPixelSize * Parameters::macroPixelSize));
-    assert(sInhibitory == (Parameters::detectorSize * Parameters::detectorSize * Parameters::DetectorMax));
-    assert(iInhibitory == (Parameters::macroPixelSize * Parameters::macroPixelSize));
+    assert(sExcitatory == (detectorSize * detectorSize * Parameters::DetectorMax));
+    assert(iExcitatory == (macroPixelSize * macroPixelSize));
+    assert(sInhibitory == (detectorSize * detectorSize * Parameters::DetectorMax));
+    assert(iInhibitory == (macroPixelSize * macroPixelSize));
 }
 
-void displayThreadHandler(std::mutex &inputMutex, const cv::Mat &inputImage,
-                          std::mutex &outputMutex, const float (&output)[Parameters::detectorSize][Parameters::detectorSize][2])
+void displayThreadHandler(TripleBuffer<cv::Mat> &inputBuffer, TripleBuffer<FlowArray> &outputBuffer)
 {
     cv::namedWindow("Input", CV_WINDOW_NORMAL);
     cv::resizeWindow("Input", Parameters::inputSize * Parameters::inputScale,
@@ -222,21 +280,21 @@ void displayThreadHandler(std::mutex &inputMutex, const cv::Mat &inputImage,
         // Clear background
         outputImage.setTo(cv::Scalar::all(0));
 
-        {
-            std::lock_guard<std::mutex> lock(outputMutex);
+        // Take most recently published flow field
+        outputBuffer.consume();
+        const FlowArray &output = outputBuffer.getReadBuffer();
 
-            // Loop through output coordinates
-            for(unsigned int x = 0; x < Parameters::detectorSize; x++)
+        // Loop through output coordinates
+        for(unsigned int x = 0; x < Parameters::detectorSize; x++)
+        {
+            for(unsigned int y = 0; y < Parameters::detectorSize; y++)
             {
-                for(unsigned int y = 0; y < Parameters::detectorSize; y++)
-                {
-                    const cv::Point start(x * Parameters::outputScale, y * Parameters::outputScale);
-                    const cv::Point end = start + cv::Point(Parameters::outputVectorScale * output[x][y][0],
-                                                            Parameters::outputVectorScale * output[x][y][1]);
-
-                    cv::line(outputImage, start, end,
-                             CV_RGB(0xFF, 0xFF, 0xFF));
-                }
+                const cv::Point start(x * Parameters::outputScale, y * Parameters::outputScale);
+                const cv::Point end = start + cv::Point(Parameters::outputVectorScale * output[x][y][0],
+                                                        Parameters::outputVectorScale * output[x][y][1]);
+
+                cv::line(outputImage, start, end,
+                         CV_RGB(0xFF, 0xFF, 0xFF));
             }
         }
 
@@ -264,9 +322,9 @@ void displayThreadHandler(std::mutex &inputMutex, const cv::Mat &inputImage,
 
         cv::imshow("Output", outputImage);
 
-        {
-            std::lock_guard<std::mutex> lock(inputMutex);
-            cv::imshow("Input", inputImage);
+        // If a new input image has been published, show it
+        if(inputBuffer.consume()) {
+            cv::imshow("Input", inputBuffer.getReadBuffer());
         }
 
 
@@ -274,165 +332,355 @@ void displayThreadHandler(std::mutex &inputMutex, const cv::Mat &inputImage,
     }
 }
 
-void applyOutputSpikes(unsigned int outputSpikeCount, const unsigned int *outputSpikes, float (&output)[Parameters::detectorSize][Parameters::detectorSize][2])
+void applyOutputSpikes(PyramidFlow &pyramidFlow)
 {
-    // Loop through output spikes
-    for(unsigned int s = 0; s < outputSpikeCount; s++)
-    {
-        // Convert spike ID to x, y, detector
-        const unsigned int spike = outputSpikes[s];
-        const auto spikeCoord = std::div((int)spike, (int)Parameters::detectorSize * Parameters::DetectorMax);
-        const int spikeY = spikeCoord.quot;
-        const auto xCoord = std::div(spikeCoord.rem, (int)Parameters::DetectorMax);
-        const int spikeX =  xCoord.quot;
-
-        // Apply spike to correct axis of output pixel based on detector it was emitted by
-        switch(xCoord.rem)
-        {
-            case Parameters::DetectorLeft:
-                output[spikeX][spikeY][0] -= 1.0f;
-                break;
+    // Apply output spikes from each scale
+    for(unsigned int i = 0; i < Parameters::numScales; i++) {
+        const Scale &scale = g_Scales[i];
+#ifndef CPU_ONLY
+        scale.pullOutputSpikes();
+#endif
+        pyramidFlow.apply(i, scale.outputSpikeCount[0], scale.outputSpikes);
+    }
 
-            case Parameters::DetectorRight:
-                output[spikeX][spikeY][0] += 1.0f;
-                break;
+    // Advance flow fields to next timestep - decay is applied lazily
+    pyramidFlow.advance();
+}
 
-            case Parameters::DetectorUp:
-                output[spikeX][spikeY][1] -= 1.0f;
-                break;
+//! If flow is being streamed and it's time, render decayed flow field into output and send it
+void streamFlow(FlowStream::Sender *flowStream, unsigned int streamInterval, unsigned int timestep,
+                const PyramidFlow &pyramidFlow, FlowArray &output)
+{
+    if(flowStream != nullptr && (timestep % streamInterval) == 0) {
+        pyramidFlow.render(output);
+        flowStream->send(timestep, &output[0][0][0]);
+    }
+}
 
-            case Parameters::DetectorDown:
-                output[spikeX][spikeY][1] += 1.0f;
-                break;
+void printStreamStats(const FlowStream::Sender *flowStream)
+{
+    if(flowStream != nullptr) {
+        std::cout << "Stream: " << flowStream->getNumSent() << " flow fields sent, " << flowStream->getNumDropped() << " dropped" << std::endl;
+    }
+}
 
-        }
+//----------------------------------------------------------------------------
+// SimulationLoop
+//----------------------------------------------------------------------------
+//! Main simulation loop, instantiated for each type of event source by EventSource::run
+class SimulationLoop
+{
+public:
+    SimulationLoop(TripleBuffer<cv::Mat> &inputBuffer, TripleBuffer<FlowArray> &outputBuffer,
+                   RealtimeScheduler::OverrunPolicy overrunPolicy,
+                   FlowStream::Sender *flowStream = nullptr, unsigned int streamInterval = 1)
+    :   m_InputBuffer(inputBuffer), m_OutputBuffer(outputBuffer), m_Scheduler(DT, overrunPolicy),
+        m_FlowStream(flowStream), m_StreamInterval(streamInterval),
+        m_InputRenderer(Parameters::inputSize, Parameters::inputSize, Parameters::spikePersistence),
+        m_DVSGet(0.0), m_Step(0.0), m_Render(0.0), m_NumTimesteps(0)
+    {
     }
 
-    // Decay output
-    for(unsigned int x = 0; x < Parameters::detectorSize; x++)
+    template<typename Source>
+    void operator()(Source &dvs)
     {
-        for(unsigned int y = 0; y < Parameters::detectorSize; y++)
-        {
-            output[x][y][0] *= Parameters::spikePersistence;
-            output[x][y][1] *= Parameters::spikePersistence;
+        if(dvs.getWidth() != Parameters::inputSize || dvs.getHeight() != Parameters::inputSize) {
+            throw std::runtime_error("Event source resolution does not match model input size");
         }
-    }
-}
-}
 
-int main(int argc, char *argv[])
-{
-    allocateMem();
-    initialize();
+        m_Scheduler.start();
+        for(m_NumTimesteps = 0; g_SignalStatus == 0 && !dvs.isFinished(); m_NumTimesteps++)
+        {
+            // Wait for this tick's deadline
+            const auto tick = m_Scheduler.waitForNextTick();
 
-    buildCentreToMacroConnection(CDVS_MacroPixel, &allocateDVS_MacroPixel);
-    buildDetectors(CMacroPixel_Output_Excitatory, CMacroPixel_Output_Inhibitory,
-                   &allocateMacroPixel_Output_Excitatory, &allocateMacroPixel_Output_Inhibitory);
-    //print_sparse_matrix(Parameters::inputSize, CDVS_MacroPixel);
-    initoptical_flow();
+            {
+                TimerAccumulate<std::milli> timer(m_DVSGet);
+                dvs.readEvents(spikeCount_DVS, spike_DVS);
 
-#ifdef DVS
-     // Create DVS 128 device
-    DVS128 dvs(DVS128::Polarity::On);
-#elif CSV
-    assert(argc > 1);
-    DVSPreRecorded dvs(argv[1], DVSPreRecorded::Polarity::On, DT, true);
-#else
-    assert(argc > 1);
-    DVSPreRecordedMs dvs(argv[1]);
+#ifndef CPU_ONLY
+                // Copy to GPU
+                pushDVSCurrentSpikesToDevice();
 #endif
+            }
 
-    double dvsGet = 0.0;
-    double step = 0.0;
-    double render = 0.0;
+            {
+                TimerAccumulate<std::milli> timer(m_Render);
+                m_InputRenderer.update(spikeCount_DVS, spike_DVS);
+            }
 
+            {
+                TimerAccumulate<std::milli> timer(m_Step);
 
-    std::mutex inputMutex;
-    cv::Mat inputImage(Parameters::inputSize, Parameters::inputSize, CV_32F);
+                // Simulate
+#ifndef CPU_ONLY
+                stepTimeGPU();
+#else
+                stepTimeCPU();
+#endif
+            }
 
-    std::mutex outputMutex;
-    float output[Parameters::detectorSize][Parameters::detectorSize][2] = {0};
-    std::thread displayThread(displayThreadHandler,
-                              std::ref(inputMutex), std::ref(inputImage),
-                              std::ref(outputMutex), std::ref(output));
+            {
+                TimerAccumulate<std::milli> timer(m_Render);
+                applyOutputSpikes(m_PyramidFlow);
 
-    // Convert timestep to a duration
-    const auto dtDuration = std::chrono::duration<double, std::milli>{DT};
+                // If it's time and we're not behind schedule, render decayed
+                // input and flow field and publish them to display thread
+                if(!tick.degrade && (m_NumTimesteps % Parameters::displayPublishTimesteps) == 0) {
+                    m_InputRenderer.render(m_InputBuffer.getWriteBuffer());
+                    m_InputBuffer.publish();
 
-    // Duration counters
-    std::chrono::duration<double, std::milli> sleepTime{0};
-    std::chrono::duration<double, std::milli> overrunTime{0};
-    unsigned int i = 0;
+                    m_PyramidFlow.render(m_OutputBuffer.getWriteBuffer());
+                    m_OutputBuffer.publish();
+                }
 
-     // Catch interrupt (ctrl-c) signals
-    std::signal(SIGINT, signalHandler);
+                // Stream flow field to any consumer - this never blocks so is done even when behind schedule
+                streamFlow(m_FlowStream, m_StreamInterval, m_NumTimesteps, m_PyramidFlow, m_StreamOutput);
+            }
+        }
+    }
 
-    for(i = 0; g_SignalStatus == 0; i++)
+    void printStats() const
     {
-        auto tickStart = std::chrono::high_resolution_clock::now();
+        std::cout << "Ran for " << m_NumTimesteps << " " << DT << "ms timesteps" << std::endl;
+        m_Scheduler.printStats();
+        std::cout << "DVS:" << m_DVSGet << "ms, Step:" << m_Step << "ms, Render:" << m_Render << std::endl;
+    }
 
-        {
-            TimerAccumulate<std::milli> timer(dvsGet);
-            dvs.readEvents(spikeCount_DVS, spike_DVS);
+private:
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    // Buffers used to publish input image and flow field to display thread
+    TripleBuffer<cv::Mat> &m_InputBuffer;
+    TripleBuffer<FlowArray> &m_OutputBuffer;
 
-#ifndef CPU_ONLY
-            // Copy to GPU
-            pushDVSCurrentSpikesToDevice();
-#endif
+    // Paces simulation to real-time
+    RealtimeScheduler m_Scheduler;
+
+    // Optional sink for flow field and how many timesteps between sending it
+    FlowStream::Sender *m_FlowStream;
+    const unsigned int m_StreamInterval;
+    FlowArray m_StreamOutput;
+
+    TimeSurfaceRenderer m_InputRenderer;
+    PyramidFlow m_PyramidFlow;
+
+    // Duration counters
+    double m_DVSGet;
+    double m_Step;
+    double m_Render;
+    unsigned int m_NumTimesteps;
+};
+
+//----------------------------------------------------------------------------
+// BatchLoop
+//----------------------------------------------------------------------------
+//! Headless simulation loop which runs as fast as possible until the event source is
+//! exhausted, periodically sampling the coherence of the flow at each scale and
+//! writing the decayed, fused flow field to a binary file.
+//! The file starts with the detector size as a uint32 followed, for each output, by the
+//! uint32 timestep and the detectorSize * detectorSize * 2 floats of the output array
+class BatchLoop
+{
+public:
+    BatchLoop(const std::string &outputFilename, unsigned int outputInterval,
+              FlowStream::Sender *flowStream = nullptr, unsigned int streamInterval = 1)
+    :   m_OutputFilename(outputFilename), m_OutputInterval(outputInterval),
+        m_FlowStream(flowStream), m_StreamInterval(streamInterval), m_NumTimesteps(0), m_NumEvents(0), m_Duration(0)
+    {
+    }
+
+    template<typename Source>
+    void operator()(Source &dvs)
+    {
+        if(dvs.getWidth() != Parameters::inputSize || dvs.getHeight() != Parameters::inputSize) {
+            throw std::runtime_error("Event source resolution does not match model input size");
         }
 
-        {
-            TimerAccumulate<std::milli> timer(render);
-            {
-                std::lock_guard<std::mutex> lock(inputMutex);
-                renderSpikeImage(spikeCount_DVS, spike_DVS, Parameters::inputSize,
-                                 Parameters::spikePersistence, inputImage);
+        // If an output file is specified, open it and write header
+        std::ofstream outputStream;
+        if(!m_OutputFilename.empty()) {
+            outputStream.open(m_OutputFilename, std::ios::binary);
+            if(!outputStream.good()) {
+                throw std::runtime_error("Cannot open output file '" + m_OutputFilename + "'");
             }
+
+            const uint32_t detectorSize = Parameters::detectorSize;
+            outputStream.write(reinterpret_cast<const char*>(&detectorSize), sizeof(uint32_t));
         }
 
+        const auto start = std::chrono::high_resolution_clock::now();
+        for(m_NumTimesteps = 0; g_SignalStatus == 0 && !dvs.isFinished(); m_NumTimesteps++)
         {
-            TimerAccumulate<std::milli> timer(step);
+            dvs.readEvents(spikeCount_DVS, spike_DVS);
+            m_NumEvents += spikeCount_DVS;
 
             // Simulate
 #ifndef CPU_ONLY
+            pushDVSCurrentSpikesToDevice();
             stepTimeGPU();
-            pullOutputCurrentSpikesFromDevice();
 #else
             stepTimeCPU();
 #endif
-        }
 
-        {
-            TimerAccumulate<std::milli> timer(render);
-            {
-                std::lock_guard<std::mutex> lock(outputMutex);
-                applyOutputSpikes(spikeCount_Output, spike_Output, output);
+            applyOutputSpikes(m_PyramidFlow);
+
+            // If it's time, sample flow coherence and write timestep and decayed output array to file
+            if(((m_NumTimesteps + 1) % m_OutputInterval) == 0) {
+                m_PyramidFlow.sampleCoherence();
+
+                if(outputStream.is_open()) {
+                    m_PyramidFlow.render(m_Output);
+
+                    const uint32_t timestep = m_NumTimesteps;
+                    outputStream.write(reinterpret_cast<const char*>(&timestep), sizeof(uint32_t));
+                    outputStream.write(reinterpret_cast<const char*>(m_Output), sizeof(FlowArray));
+                }
             }
+
+            streamFlow(m_FlowStream, m_StreamInterval, m_NumTimesteps, m_PyramidFlow, m_Output);
         }
+        m_Duration = std::chrono::high_resolution_clock::now() - start;
+    }
+
+    void printStats() const
+    {
+        const double seconds = m_Duration.count();
+        m_PyramidFlow.printStats(m_NumTimesteps);
+        std::cout << "Batch: " << m_NumTimesteps << " steps, " << m_NumEvents << " events, " << seconds << " s, "
+            << (double)m_NumTimesteps / seconds << " steps/s, " << (double)m_NumEvents / seconds << " events/s" << std::endl;
+    }
+
+private:
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    const std::string m_OutputFilename;
+    const unsigned int m_OutputInterval;
 
-        // Get time of tick start
-        auto tickEnd = std::chrono::high_resolution_clock::now();
+    FlowStream::Sender *m_FlowStream;
+    const unsigned int m_StreamInterval;
 
-        // If there we're ahead of real-time pause
-        auto tickDuration = tickEnd - tickStart;
-        if(tickDuration < dtDuration) {
-            auto tickSleep = dtDuration - tickDuration;
-            sleepTime += tickSleep;
-            std::this_thread::sleep_for(tickSleep);
+    PyramidFlow m_PyramidFlow;
+    FlowArray m_Output;
+
+    unsigned int m_NumTimesteps;
+    unsigned long long m_NumEvents;
+    std::chrono::duration<double> m_Duration;
+};
+}
+
+int main(int argc, char *argv[])
+{
+    // Parse event source options
+    EventSource::Config eventSourceConfig;
+    eventSourceConfig.dt = DT;
+    eventSourceConfig.flipY = true;
+    bool batch = false;
+    std::string batchOutputFilename;
+    unsigned int batchOutputInterval = 10;
+    std::string streamPath;
+    unsigned int streamInterval = 1;
+    float streamScale = Parameters::streamQuantisationStep;
+    FlowStream::Format streamFormat = FlowStream::Format::Int8;
+    RealtimeScheduler::OverrunPolicy overrunPolicy = RealtimeScheduler::OverrunPolicy::Skip;
+    Realtime::Config realtimeConfig;
+    for(int a = 1; a < argc; a++) {
+        if(strcmp(argv[a], "--batch") == 0) {
+            batch = true;
         }
-        else {
-            overrunTime += (tickDuration - dtDuration);
+        else if(strcmp(argv[a], "--overrun") == 0 && (a + 1) < argc) {
+            overrunPolicy = RealtimeScheduler::parsePolicy(argv[++a]);
+        }
+        else if(strcmp(argv[a], "--output") == 0 && (a + 1) < argc) {
+            batchOutputFilename = argv[++a];
+        }
+        else if(strcmp(argv[a], "--output-interval") == 0 && (a + 1) < argc) {
+            batchOutputInterval = std::max(1, std::atoi(argv[++a]));
+        }
+        else if(strcmp(argv[a], "--stream") == 0 && (a + 1) < argc) {
+            streamPath = argv[++a];
+        }
+        else if(strcmp(argv[a], "--stream-interval") == 0 && (a + 1) < argc) {
+            streamInterval = std::max(1, std::atoi(argv[++a]));
+        }
+        else if(strcmp(argv[a], "--stream-scale") == 0 && (a + 1) < argc) {
+            streamScale = (float)std::atof(argv[++a]);
+            if(!(streamScale > 0.0f) || !std::isfinite(streamScale)) {
+                std::cerr << "--stream-scale must be a positive number" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if(strcmp(argv[a], "--stream-int16") == 0) {
+            streamFormat = FlowStream::Format::Int16;
+        }
+        else if(!Realtime::parseArg(realtimeConfig, a, argc, argv)
+                && !EventSource::parseArg(eventSourceConfig, a, argc, argv))
+        {
+            std::cerr << "Unknown argument '" << argv[a] << "'" << std::endl;
+            return EXIT_FAILURE;
         }
     }
 
+    allocateMem();
+    initialize();
+
+    // Build connectivity of each scale of detectors
+    for(unsigned int i = 0; i < Parameters::numScales; i++) {
+        const Scale &scale = g_Scales[i];
+        buildCentreToMacroConnection(i, scale.dvsMacroPixel, scale.allocateDVSMacroPixel);
+        buildDetectors(i, scale.excitatory, scale.inhibitory,
+                       scale.allocateExcitatory, scale.allocateInhibitory);
+    }
+    //print_sparse_matrix(Parameters::inputSize, CDVS_MacroPixel);
+    initoptical_flow();
+
+    // If a socket path is specified, stream flow field to it
+    std::unique_ptr<FlowStream::Sender> flowStream;
+    if(!streamPath.empty()) {
+        flowStream.reset(new FlowStream::Sender(streamPath, Parameters::detectorSize, streamScale, streamFormat));
+    }
+
+    // In batch mode, run headless as fast as possible until events are exhausted
+    if(batch) {
+        std::signal(SIGINT, signalHandler);
+
+        BatchLoop batchLoop(batchOutputFilename, batchOutputInterval, flowStream.get(), streamInterval);
+        EventSource::run(eventSourceConfig, batchLoop);
+
+        batchLoop.printStats();
+        printStreamStats(flowStream.get());
+        return 0;
+    }
+
+    // Create buffers to publish input image and flow field to display thread without locking
+    TripleBuffer<cv::Mat> inputBuffer;
+    TripleBuffer<FlowArray> outputBuffer;
+    std::thread displayThread(displayThreadHandler,
+                              std::ref(inputBuffer), std::ref(outputBuffer));
+
+    // Apply any requested realtime configuration to display, input and simulation threads
+    Realtime::configureDisplayThread(realtimeConfig, displayThread.native_handle());
+    eventSourceConfig.inputCore = realtimeConfig.inputCore;
+    eventSourceConfig.inputPriority = realtimeConfig.priority;
+    Realtime::configureSimulationThread(realtimeConfig);
+
+     // Catch interrupt (ctrl-c) signals
+    std::signal(SIGINT, signalHandler);
+
+    // Run simulation loop using selected event source
+    SimulationLoop simulationLoop(inputBuffer, outputBuffer, overrunPolicy, flowStream.get(), streamInterval);
+    EventSource::run(eventSourceConfig, simulationLoop);
+
+    // If event source ran out of events, signal display thread to stop
+    g_SignalStatus = SIGINT;
+
     // Wait for display thread to die
     displayThread.join();
 
-    // Stop DVS
-    dvs.stop();
-
-    std::cout << "Ran for " << i << " " << DT << "ms timesteps, overan for " << overrunTime.count() << "ms, slept for " << sleepTime.count() << "ms" << std::endl;
-    std::cout << "DVS:" << dvsGet << "ms, Step:" << step << "ms, Render:" << render << std::endl;
+    simulationLoop.printStats();
+    printStreamStats(flowStream.get());
 
     return 0;
-}
\ No newline at end of file
+}